@@ -19,18 +19,27 @@
  * limitations under the License.
  */
 
+#include <chrono>
 #include <memory>
 #include <iostream>
 
 #include "Cache.h"
+#include "Digest.h"
 #include "Environment.h"
+#include "Fingerprint.h"
+#include "FlagCanonicalizer.h"
+#include "Identity.h"
+#include "LintResult.h"
 #include "Logging.h"
+#include "Metrics.h"
 #include "Subprocess.h"
 #include "TemporaryFile.h"
 #include "Util.h"
+#include "Trace.h"
 #include "CompileCommands.h"
 
 static constexpr char kEnvCcache[] = "CCACHE";
+static constexpr char kEnvIdentityVersion[] = "LINTER_CACHE_IDENTITY_VERSION";
 #ifdef MZ_WINDOWS
 static constexpr char kPathSep[] = ";";
 #else
@@ -46,25 +55,177 @@ Cache::Cache(const std::string& ccache, const Environment& env)
     LOG(TRACE) << "Using ccache from '" << _ccache << "'";
 }
 
+const char* Cache::kEnvMissFile = "LINTER_CACHE_MISS_FILE";
+
+static void
+count(const History::Entry& entry)
+{
+    Metrics metrics;
+    metrics.add(Metrics::Counter::RUNS);
+    metrics.add(entry.hit ? Metrics::Counter::HITS : Metrics::Counter::MISSES);
+    if (0 != entry.exitCode) {
+        metrics.add(Metrics::Counter::FAILURES);
+    }
+    metrics.addSeconds(Metrics::Counter::RUN_MICROS, entry.seconds);
+}
+
 void
 Cache::execute(const CommandlineArguments& args,
                const Linter& linter,
                const std::string& objectfile,
-               const std::string& sourcefile) const
+               const std::string& sourcefile,
+               const Environment& env) const
+{
+    History::Entry entry;
+    entry.sourcefile = sourcefile;
+    const auto start = std::chrono::steady_clock::now();
+    const auto elapsed = [&start] {
+        return std::chrono::duration<double>(
+                 std::chrono::steady_clock::now() - start)
+          .count();
+    };
+
+    try {
+        run(args, linter, objectfile, sourcefile, env, entry);
+    } catch (ProcessError& error) {
+        entry.seconds = elapsed();
+        entry.exitCode = error.exitCode() > 0 ? error.exitCode() : 1;
+        History().record(entry);
+        count(entry);
+        throw;
+    }
+    entry.seconds = elapsed();
+    History().record(entry);
+    count(entry);
+}
+
+// the inputs known before invoking ccache
+static Fingerprint
+fingerprintOf(const CommandlineArguments& args,
+              const Linter& linter,
+              const CompileCommands::Flags& flags,
+              const std::string& sourcefile,
+              const Fingerprint& previous)
 {
-    Environment env;
+    Fingerprint fingerprint;
+    StringList executable = { Util::find_program(linter.executable()) };
+    Util::FileInfo info;
+    if (Util::file_info(executable.front(), info)) {
+        executable.push_back("size " + std::to_string(info.size));
+        executable.push_back("mtime " + std::to_string(info.mtime));
+    }
+    fingerprint.setList("linter", executable);
+    fingerprint.setList("flags", flags.compiler + flags.options);
+    fingerprint.setList("args", args.remainingArgs);
+    fingerprint.setFiles("source", { sourcefile }, &previous);
+    return fingerprint;
+}
+
+static void
+explain(const std::string& sourcefile,
+        const Fingerprint& current,
+        const Fingerprint* previous)
+{
+    std::cerr << "linter-cache: " << sourcefile << ": Missed the cache";
+    if (!previous) {
+        std::cerr << ", no previous run is known" << std::endl;
+        return;
+    }
+    const auto differences = current.differences(*previous);
+    if (differences.empty()) {
+        std::cerr << " although no input changed since the previous run, "
+                     "its result was not cached or got evicted"
+                  << std::endl;
+        return;
+    }
+    std::cerr << ", changed since the previous run:" << std::endl;
+    for (const auto& difference : differences) {
+        std::cerr << "    " << difference << std::endl;
+    }
+}
+
+void
+Cache::markMiss()
+{
+    const auto filename = Environment::get(kEnvMissFile);
+    if (!filename.empty()) {
+        NamedFile(filename).writeText("miss");
+    }
+}
+
+void
+Cache::run(const CommandlineArguments& args,
+           const Linter& linter,
+           const std::string& objectfile,
+           const std::string& sourcefile,
+           const Environment& environment,
+           History::Entry& entry) const
+{
+    // passed on to ccache only, never modifying our own environment
+    Environment env(environment);
+
+    CompileCommands::Flags flags;
+    if (!args.compilerDatabase.empty()) {
+        CompileCommands compilerDatabase(args.compilerDatabase);
+        flags = compilerDatabase.flagsForFile(sourcefile);
+        // applies to everything hashed, see LinterClangTidy::preprocess()
+        flags.options = FlagCanonicalizer::fromEnvironment().apply(flags.options);
+    }
+
+    // a failure found in the cache gets linted again instead of replayed
+    const bool rerunFailures = env.get(LintResult::kEnvNoCaching, false);
+    LintResult failure;
+
+    // try to serve the result without spawning any processes at all
+    std::string directKey;
+    std::string recorded;
+    std::unique_ptr<NamedFile> dependencies;
+    if (DirectCache::enabled()) {
+        directKey = this->directKey(args, linter, flags, sourcefile);
+    }
+    if (!directKey.empty()) {
+        DirectCache::Result cached;
+        if (_direct.lookup(directKey, cached) &&
+            !(rerunFailures &&
+              LintResult::parse(cached.objectContents, failure))) {
+            LOG(TRACE) << "Cache: Direct hit for '" << sourcefile << "'";
+            entry.hit = true;
+            if (!args.quiet) {
+                std::cerr << cached.errorOutput;
+                std::cout << cached.output;
+            }
+            NamedFile file(objectfile);
+            if (file) {
+                file.writeText(cached.objectContents);
+            }
+            replay(cached.objectContents, file, sourcefile);
+            return;
+        }
+
+        // the source gets recorded up front so that edits during the
+        // lint will invalidate the manifest, the preprocessing stage will
+        // create the dependencies file listing any other files it read
+        if (DirectCache::addDependency(recorded, sourcefile)) {
+            dependencies = std::make_unique<TemporaryFile>();
+            dependencies->unlink();
+            env.set(DirectCache::kEnvDependencies, dependencies->filename());
+        }
+    }
 
     // in order to work reliably we disable nodepend mode
-    if(env.get("CCACHE_NODEPEND").empty() && env.get("CCACHE_DEPEND").empty()) {
+    if(env.value("CCACHE_NODEPEND").empty() && env.value("CCACHE_DEPEND").empty()) {
         env.set("CCACHE_NODEPEND", "1");
     }
 
-    if (Util::is_file(linter.executable())) {
-        auto extraFiles = env.get("CCACHE_EXTRAFILES");
+    // let ccache hash a small identity instead of the whole linter binary
+    const auto identity = Identity().fileFor(
+      linter.executable(), env.get(kEnvIdentityVersion, false));
+    if (!identity.empty()) {
+        auto extraFiles = env.value("CCACHE_EXTRAFILES");
         if(!extraFiles.empty()) {
             extraFiles += kPathSep;
         }
-        extraFiles += linter.executable();
+        extraFiles += identity;
         env.set("CCACHE_EXTRAFILES", extraFiles);
     }
 
@@ -81,45 +242,175 @@ Cache::execute(const CommandlineArguments& args,
     // the linter will be restored later when ccache is invoking us again in
     // turn
     StringList ccacheArgs = { args.self };
-    bool isMsvc = false;
-    if (!args.compilerDatabase.empty()) {
-        CompileCommands compilerDatabase(args.compilerDatabase);
-        const auto flags = compilerDatabase.flagsForFile(sourcefile);
-        ccacheArgs.insert(
-          ccacheArgs.end(), flags.options.begin(), flags.options.end());
-
-        isMsvc = (flags.compiler.find( "cl" ) != std::string::npos);
-    }
+    ccacheArgs.insert(
+      ccacheArgs.end(), flags.options.begin(), flags.options.end());
+    const bool isMsvc = (flags.compiler.find("cl") != std::string::npos);
     ccacheArgs.insert(ccacheArgs.end(),
                       { "-o", temporary->filename(), "-c", sourcefile });
 
     // we work like clang, force it unless overridden
-    if(env.get("CCACHE_COMPILERTYPE").empty()) {
+    if(env.value("CCACHE_COMPILERTYPE").empty()) {
         env.set("CCACHE_COMPILERTYPE", isMsvc ? "clang-cl" : "clang");
     }
 
-    try {
-        invoke(ccacheArgs, args.quiet);
-    } catch (ProcessError& error) {
-        temporary->unlink();
-        throw error;
+    // the preprocessing stage adds the configuration and the headers
+    const auto fingerprintPath = Fingerprint::pathFor(sourcefile);
+    Fingerprint previous;
+    const bool known = previous.load(fingerprintPath);
+    auto fingerprint = fingerprintOf(args, linter, flags, sourcefile, previous);
+    TemporaryFile preprocessed;
+    preprocessed.unlink();
+    env.set(Fingerprint::kEnvFile, preprocessed.filename());
+
+    // ccache only invokes the linter on a miss, it will leave a mark then
+    TemporaryFile missFile;
+    missFile.unlink();
+    env.set(kEnvMissFile, missFile.filename());
+    Process::Usage usage;
+    const auto classify = [&] {
+        entry.hit = !Util::is_file(missFile.filename());
+        if (!entry.hit) {
+            // covers ccache and everything it waited for, mostly the linter
+            entry.peakRssKb = usage.maxResidentKb;
+        }
+
+        Fingerprint added;
+        if (added.load(preprocessed.filename())) {
+            fingerprint.add(added);
+        }
+        // keep what ccache did not preprocess again as known before
+        fingerprint.add(previous);
+        if (args.explainMiss && !entry.hit) {
+            explain(sourcefile, fingerprint, known ? &previous : nullptr);
+        }
+        fingerprint.save(fingerprintPath);
+    };
+
+    DirectCache::Result result;
+    const auto invokeCcache = [&] {
+        try {
+            invoke(ccacheArgs,
+                   env,
+                   args.quiet,
+                   dependencies ? &result : nullptr,
+                   usage);
+        } catch (ProcessError& error) {
+            classify();
+            temporary->unlink();
+            throw error;
+        }
+        classify();
+        result.objectContents = temporary->readText();
+    };
+    invokeCcache();
+    if (rerunFailures && entry.hit &&
+        LintResult::parse(result.objectContents, failure)) {
+        // the setting is not hashed, make ccache run the linter anyway
+        LOG(TRACE) << "Cache: Linting '" << sourcefile
+                   << "' again instead of replaying failure "
+                   << failure.exitCode;
+        env.set("CCACHE_RECACHE", "1");
+        invokeCcache();
+    }
+    if (dependencies) {
+        // ccache will not preprocess again when it hit in its direct mode
+        if (Util::is_file(dependencies->filename())) {
+            recorded += dependencies->readText();
+            dependencies->unlink();
+            _direct.store(directKey, recorded, result);
+        } else {
+            LOG(TRACE) << "Cache: No dependencies recorded for '"
+                       << sourcefile << "'";
+        }
+    }
+    replay(result.objectContents, *temporary, sourcefile);
+}
+
+std::string
+Cache::directKey(const CommandlineArguments& args,
+                 const Linter& linter,
+                 const CompileCommands::Flags& flags,
+                 const std::string& sourcefile) const
+{
+    // without knowing the exact linter binary a hit cannot be trusted
+    const auto executable = Util::find_program(linter.executable());
+    Util::FileInfo info;
+    if (executable.empty() || !Util::file_info(executable, info)) {
+        LOG(TRACE) << "Cache: Direct mode needs a linter executable, '"
+                   << linter.executable() << "' not found";
+        return std::string();
+    }
+
+    Digest key;
+    key.update(modeToString(args.mode));
+    key.update(Util::normalize_path(executable));
+    key.update(&info.size, sizeof(info.size));
+    key.update(&info.mtime, sizeof(info.mtime));
+    // relative include paths are resolved against the working directory
+    key.update(Util::normalize_path("."));
+    key.update(Util::normalize_path(sourcefile));
+    key.update(flags.compiler);
+    for (const auto& option : flags.options) {
+        key.update(option);
+    }
+    for (const auto& arg : args.remainingArgs) {
+        key.update(arg);
+    }
+    // the config files found last time do not tell about new ones added
+    // closer to the source, resolving them again is memoized and cheap
+    key.update(linter.configDigest(sourcefile, args));
+    return key.hex();
+}
+
+void
+Cache::replay(const std::string& objectContents,
+              NamedFile& objectfile,
+              const std::string& sourcefile) const
+{
+    // failures get cached as well, replay them no matter if hit or miss
+    LintResult result;
+    if (LintResult::parse(objectContents, result)) {
+        LOG(TRACE) << "Cache: Replaying failure " << result.exitCode
+                   << " for '" << sourcefile << "'";
+        objectfile.unlink();
+        std::cout << result.output;
+        std::cerr << result.errorOutput;
+        throw ProcessError(sourcefile, result.exitCode);
     }
 }
 
 void
-Cache::invoke(const StringList& args, bool quiet) const
+Cache::invoke(const StringList& args,
+              const Environment& env,
+              bool quiet,
+              DirectCache::Result* captured,
+              Process::Usage& usage) const
 {
     int flags = 0;
-    if (quiet) {
+    if (quiet || captured) {
         flags |= Process::CAPTURE_STDERR | Process::CAPTURE_STDOUT;
     }
-    Process proc(_ccache + args, flags);
+    Process proc(_ccache + args, flags, env);
     LOG(TRACE) << "Cache: Running " << proc.cmd();
+    TraceSpan span("wait for ccache");
     try {
         proc.run();
     } catch (ProcessError& error) {
+        usage = proc.usage();
+        LOG(INFO) << "Cache: Failed with " << error.exitCode() << ", "
+                  << proc.usage();
         std::cerr << proc.errorOutput();
         std::cout << proc.output();
         throw error;
     }
+    usage = proc.usage();
+    LOG(INFO) << "Cache: Finished, " << proc.usage();
+    if (captured) {
+        captured->output = proc.output();
+        captured->errorOutput = proc.errorOutput();
+        if (!quiet) {
+            std::cerr << proc.errorOutput();
+            std::cout << proc.output();
+        }
+    }
 }
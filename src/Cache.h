@@ -26,6 +26,11 @@
 
 #include "Linter.h"
 #include "CommandlineArguments.h"
+#include "CompileCommands.h"
+#include "DirectCache.h"
+#include "History.h"
+#include "NamedFile.h"
+#include "Subprocess.h"
 
 class Cache
 {
@@ -34,15 +39,49 @@ public:
 
     std::string executable() const { return _ccache; }
 
+    // runs ccache with the variables of `env` on top of our environment
+    // and records the outcome in the History
     void execute(const CommandlineArguments& args,
                  const Linter& linter,
                  const std::string& objectfile,
-                 const std::string& sourcefile) const;
+                 const std::string& sourcefile,
+                 const Environment& env) const;
+
+    // to be called when ccache invoked us to actually run the linter,
+    // tells execute() that this was a miss
+    static void markMiss();
 
 private:
-    void invoke(const StringList& args, bool quiet) const;
+    // names the file created by markMiss()
+    static const char* kEnvMissFile;
+
+    void run(const CommandlineArguments& args,
+             const Linter& linter,
+             const std::string& objectfile,
+             const std::string& sourcefile,
+             const Environment& env,
+             History::Entry& entry) const;
+
+    // fingerprint of everything but the files touched during preprocessing,
+    // empty when the direct mode cannot be used
+    std::string directKey(const CommandlineArguments& args,
+                          const Linter& linter,
+                          const CompileCommands::Flags& flags,
+                          const std::string& sourcefile) const;
+
+    // reports failures encoded into the object contents
+    void replay(const std::string& objectContents,
+                NamedFile& objectfile,
+                const std::string& sourcefile) const;
+
+    void invoke(const StringList& args,
+                const Environment& env,
+                bool quiet,
+                DirectCache::Result* captured,
+                Process::Usage& usage) const;
 
     std::string _ccache;
+    DirectCache _direct;
 };
 
 #endif // CACHE_H_
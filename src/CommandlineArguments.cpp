@@ -22,6 +22,8 @@
 #include <iostream>
 #include <algorithm>
 #include <cassert>
+#include <cctype>
+#include <cstdlib>
 
 #include "CommandlineArguments.h"
 
@@ -34,6 +36,25 @@ modeFromString(const std::string& mode)
     throw std::runtime_error("No such Mode: " + mode);
 }
 
+static bool
+isNumber(const std::string& arg)
+{
+    return !arg.empty() &&
+           std::all_of(arg.begin(), arg.end(), [](unsigned char c) {
+               return std::isdigit(c);
+           });
+}
+
+// the number of parallel jobs, 0 for all cores
+static int
+jobsFromString(const std::string& jobs)
+{
+    if (!isNumber(jobs)) {
+        throw std::runtime_error("Invalid number of jobs: '" + jobs + "'");
+    }
+    return std::atoi(jobs.c_str());
+}
+
 const char*
 modeToString(Mode mode)
 {
@@ -65,9 +86,73 @@ CommandlineArguments::printHelp()
               << std::endl;
     std::cout << "   CLANG_TIDY: Sets the clang-tidy executable." << std::endl;
     std::cout << "   CCACHE: Sets the ccache executable." << std::endl;
+    std::cout << "   LINTER_CACHE_JOBS: Number of sources to lint in parallel "
+                 "(0 for all cores)"
+              << std::endl;
+    std::cout << "   LINTER_CACHE_DIR: Directory to keep state like runtime "
+                 "history in (defaults to a subdirectory of the ccache dir)"
+              << std::endl;
+    std::cout << "   LINTER_CACHE_NO_INDEX: Disables the index kept next to "
+                 "the compiler database to speed up lookups"
+              << std::endl;
+    std::cout << "   LINTER_CACHE_PREPROCESS: How to find the headers of a "
+                 "source, `compiler` runs the preprocessor, `scan` "
+                 "resolves includes itself and `depfile` reuses the depfile "
+                 "written by the build"
+              << std::endl;
+    std::cout << "   LINTER_CACHE_DIRECT: Replays results without invoking "
+                 "ccache as long as all files read by the last run are "
+                 "unchanged"
+              << std::endl;
+    std::cout << "   LINTER_CACHE_IDENTITY_VERSION: Includes the output of "
+                 "`--version` when identifying the linter executable"
+              << std::endl;
+    std::cout << "   LINTER_CACHE_NO_FAILURE_CACHING: Always reruns the "
+                 "linter for sources which failed before"
+              << std::endl;
+    std::cout << "   LINTER_CACHE_TIMEOUT: Seconds after which a linter run "
+                 "gets terminated, reported with exit code 124 and never "
+                 "cached"
+              << std::endl;
+    std::cout << "   LINTER_CACHE_KILL_GRACE: Seconds granted to exit after "
+                 "SIGTERM before sending SIGKILL (defaults to 5)"
+              << std::endl;
+    std::cout << "   LINTER_CACHE_MEMORY_LIMIT: Address space limit of a "
+                 "linter run in MiB"
+              << std::endl;
+    std::cout << "   LINTER_CACHE_CPU_LIMIT: CPU time limit of a linter run "
+                 "in seconds"
+              << std::endl;
+    std::cout << "   LINTER_CACHE_SLOTS: Number of linter runs allowed at once "
+                 "across all processes when not run by a make jobserver "
+                 "(defaults to the number of cores, 0 for no limit)"
+              << std::endl;
+    std::cout << "   LINTER_CACHE_MEMORY_BUDGET: Memory in MiB linter runs "
+                 "across all processes may use as estimated from previous "
+                 "runs (defaults to 80% of the physical memory, 0 disables)"
+              << std::endl;
+    std::cout << "   LINTER_CACHE_TRACE: Directory to write trace events "
+                 "of every process to, see `--merge-trace`"
+              << std::endl;
+    std::cout << "   LINTER_CACHE_IGNORE_FLAGS: Patterns of compiler flags "
+                 "to ignore in addition to the ones not affecting the "
+                 "linter like -g, -O2 or -fPIC, separated by spaces"
+              << std::endl;
+    std::cout << "   LINTER_CACHE_KEEP_FLAGS: Patterns of compiler flags "
+                 "to keep although being ignored by default"
+              << std::endl;
+    std::cout << "   LINTER_CACHE_ONLY_FLAGS: Patterns of the only compiler "
+                 "flags to keep, e.g. '-I* -D* -std=*'"
+              << std::endl;
+    std::cout << "   LINTER_CACHE_NO_CANONICAL_FLAGS: Passes all compiler "
+                 "flags as given in the compiler database"
+              << std::endl;
     std::cout << "   LINTER_CACHE_DEBUG: Enables debug messages." << std::endl;
-    std::cout << "   LINTER_CACHE_LOGFILE: Logs to the given file "
-                 "(implies LINTER_CACHE_DEBUG)"
+    std::cout << "   LINTER_CACHE_LOGFILE: Logs to the given file, `%p` "
+                 "gets replaced by the pid (implies LINTER_CACHE_DEBUG)"
+              << std::endl;
+    std::cout << "   LINTER_CACHE_LOG_LEVEL: Lowest level of messages to log, "
+                 "one of trace, info, warning or error (defaults to trace)"
               << std::endl;
     std::cout << std::endl;
     std::cout << "   Special runtime flags supported to override configuration:"
@@ -83,6 +168,35 @@ CommandlineArguments::printHelp()
     std::cout << "   --clang-tidy=<location of the clang-tidy "
                  "executable> when not given via `CLANG_TIDY`"
               << std::endl;
+    std::cout << "   -j [<jobs>], --jobs=<jobs> to lint multiple sources in "
+                 "parallel, all cores when 0 or not given, overrides "
+                 "`LINTER_CACHE_JOBS`"
+              << std::endl;
+    std::cout << "   --all to lint every source listed in the compiler "
+                 "database given via `-p`, runs on all cores unless `-j` "
+                 "is given"
+              << std::endl;
+    std::cout << "   --stats to report the hit rate, the time saved and the "
+                 "slowest and most missed sources recorded so far"
+              << std::endl;
+    std::cout << "   --explain-miss to report which inputs changed since the "
+                 "previous run of a source missing the cache"
+              << std::endl;
+    std::cout << "   --timeout=<seconds>, --memory-limit=<MiB>, "
+                 "--cpu-limit=<seconds> override `LINTER_CACHE_TIMEOUT`, "
+                 "`LINTER_CACHE_MEMORY_LIMIT` and `LINTER_CACHE_CPU_LIMIT`"
+              << std::endl;
+    std::cout << "   --export-metrics <file> to write the counters shared by "
+                 "all runs in the Prometheus text format, e.g. for the "
+                 "textfile collector of the node exporter"
+              << std::endl;
+    std::cout << "   --merge-logs=<pattern> to combine the per process logfiles "
+                 "written to `LINTER_CACHE_LOGFILE` ordered by time"
+              << std::endl;
+    std::cout << "   --merge-trace=<dir> to combine the traces written to "
+                 "`LINTER_CACHE_TRACE` into a single file given via `-o` "
+                 "or printed to stdout"
+              << std::endl;
 }
 
 static bool
@@ -108,6 +222,14 @@ CommandlineArguments::CommandlineArguments(size_t argc, char const* const* argv)
     static constexpr std::string_view kOutputLong{ "--output=" };
     static constexpr std::string_view kCcache{ "--ccache=" };
     static constexpr std::string_view kClangTidy{ "--clang-tidy=" };
+    static constexpr std::string_view kJobsShort{ "-j" };
+    static constexpr std::string_view kJobsLong{ "--jobs=" };
+    static constexpr std::string_view kTimeout{ "--timeout=" };
+    static constexpr std::string_view kMemoryLimit{ "--memory-limit=" };
+    static constexpr std::string_view kCpuLimit{ "--cpu-limit=" };
+    static constexpr std::string_view kMergeTrace{ "--merge-trace=" };
+    static constexpr std::string_view kMergeLogs{ "--merge-logs=" };
+    static constexpr std::string_view kExportMetrics{ "--export-metrics=" };
     static constexpr std::string_view kCppExt{ ".cpp" };
     static constexpr std::string_view kCExt{ ".c" };
 
@@ -128,6 +250,12 @@ CommandlineArguments::CommandlineArguments(size_t argc, char const* const* argv)
         } else if (arg == "--quiet") {
             quiet = true;
             remainingArgs.push_back(arg);
+        } else if (arg == "--all") {
+            all = true;
+        } else if (arg == "--stats") {
+            stats = true;
+        } else if (arg == "--explain-miss") {
+            explainMiss = true;
         } else if (arg == "-c") {
             // drop
         } else if (arg == "-p" && i + 1 < argc) {
@@ -168,6 +296,39 @@ CommandlineArguments::CommandlineArguments(size_t argc, char const* const* argv)
             // clang-tidy binary was overridden
             clangTidy = arg.substr(kClangTidy.size());
             mode = Mode::CLANG_TIDY;
+        } else if (arg == "-j") {
+            // number of parallel jobs, all cores like make when not given
+            jobs = (i + 1 < argc && isNumber(argv[i + 1]))
+                     ? jobsFromString(argv[++i])
+                     : 0;
+        } else if (starts_with(arg, kJobsLong)) {
+            // number of parallel jobs
+            jobs = jobsFromString(arg.substr(kJobsLong.size()));
+        } else if (starts_with(arg, kJobsShort) && arg.size() > 2 &&
+                   std::isdigit(arg[2])) {
+            // number of parallel jobs
+            jobs = jobsFromString(arg.substr(kJobsShort.size()));
+        } else if (starts_with(arg, kTimeout)) {
+            // wall clock limit per linter run
+            timeout = arg.substr(kTimeout.size());
+        } else if (starts_with(arg, kMemoryLimit)) {
+            // address space limit per linter run
+            memoryLimit = arg.substr(kMemoryLimit.size());
+        } else if (starts_with(arg, kCpuLimit)) {
+            // cpu time limit per linter run
+            cpuLimit = arg.substr(kCpuLimit.size());
+        } else if (starts_with(arg, kMergeTrace)) {
+            // directory written to via LINTER_CACHE_TRACE
+            mergeTrace = arg.substr(kMergeTrace.size());
+        } else if (arg == "--export-metrics" && i + 1 < argc) {
+            // textfile for the Prometheus node exporter
+            exportMetrics = argv[++i];
+        } else if (starts_with(arg, kExportMetrics)) {
+            // textfile for the Prometheus node exporter
+            exportMetrics = arg.substr(kExportMetrics.size());
+        } else if (starts_with(arg, kMergeLogs)) {
+            // pattern given via LINTER_CACHE_LOGFILE
+            mergeLogs = arg.substr(kMergeLogs.size());
         } else if (ends_with(arg, kCppExt) || ends_with(arg, kCExt)) {
             // sourcefile
             sources.push_back(arg);
@@ -54,12 +54,31 @@ public:
     // the sources passed for linting
     StringList sources;
 
+    // true when invoked with --all to lint all sources in the compiler
+    // database instead of the ones passed explicitly
+    bool all = false;
+
+    // true when invoked with --stats to report on the history
+    bool stats = false;
+
+    // directory given via --merge-trace to combine its traces into one
+    std::string mergeTrace;
+
+    // logfile pattern given via --merge-logs to combine into one
+    std::string mergeLogs;
+
+    // file given via --export-metrics to write the counters to
+    std::string exportMetrics;
+
     // true when invoked with -E to get preprocessing output
     bool preprocess = false;
 
     // true when invoked with --quiet to silence output
     bool quiet = false;
 
+    // true when invoked with --explain-miss to report what changed
+    bool explainMiss = false;
+
     // any object file specified via -o
     std::string objectfile;
 
@@ -69,6 +88,16 @@ public:
     // the path to ccache as given via `--ccache`
     std::string ccache;
 
+    // the number of sources to process in parallel as given via `-j`,
+    // negative when not given and zero to use all available cores
+    int jobs = -1;
+
+    // limits for every linter child as given via `--timeout`,
+    // `--memory-limit` and `--cpu-limit`, empty when not given
+    std::string timeout;
+    std::string memoryLimit;
+    std::string cpuLimit;
+
     // arguments not matching to any of the above and
     // which hence need to be forwarded to the linter
     StringList remainingArgs;
@@ -19,82 +19,164 @@
  * limitations under the License.
  */
 
-#include <cassert>
-
 #include "CompileCommands.h"
-#include "TemporaryFile.h"
+#include "CompileCommandsIndex.h"
+#include "Environment.h"
+#include "Logging.h"
+#include "MappedFile.h"
+#include "Trace.h"
 #include "Util.h"
 
 CompileCommands::CompileCommands(const std::string& filepath)
   : _filepath(filepath)
 {}
 
-StringList
-CompileCommands::linesForFile(const std::string& sourcefile) const
+CompileCommands::~CompileCommands() = default;
+
+CompileCommands::Flags
+CompileCommands::parseCommand(const std::string& command)
 {
-    assert(Util::is_file(_filepath));
 #if _WIN32
-    const auto sourcefile_backward = Util::replace_all(sourcefile, "/", "\\\\");
+    static constexpr bool kWindowsStyle = true;
+#else
+    static constexpr bool kWindowsStyle = false;
 #endif
+    return parseArguments(
+      CompileCommandsParser::splitCommand(command, kWindowsStyle));
+}
 
-    StringList out;
-    NamedFile input(_filepath);
-    // as a minimal performance tuning just iterate
-    // all lines of the file and spare the overhead
-    // to do a full json parsing
-    for (const auto& line : input.readLines()) {
-        // match any lines with our filename, while
-        // this might cause false positives it is good
-        // enough and avoids more complicated matching logic
-        if (line.find(sourcefile) != std::string::npos) {
-            out.push_back(line);
-        }
-#if _WIN32
-        // Compile db on Windows is using two backslashes
-        if (line.find(sourcefile_backward) != std::string::npos) {
-            out.push_back(line);
+CompileCommands::Flags
+CompileCommands::parseArguments(const StringList& arguments)
+{
+    Flags flags;
+    bool skip = false;
+    bool output = false;
+    for (const auto& item : arguments) {
+        if (skip) {
+            // skip this item but parse the next
+            skip = false;
+            if (output) {
+                flags.output = item;
+                output = false;
+            }
+        } else if ("-o" == item || "-c" == item) {
+            // skip this and the next which is the argument
+            skip = true;
+            output = ("-o" == item);
+        } else if (flags.compiler.empty()) {
+            flags.compiler = item;
+        } else {
+            flags.options.push_back(item);
         }
-#endif
     }
-    return out;
+    return flags;
 }
 
 CompileCommands::Flags
-CompileCommands::flagsForFile(const std::string& sourcefile) const
+CompileCommands::flagsForEntry(const Entry& entry)
 {
-    std::string compiler;
-    StringList flags;
+    auto flags = entry.arguments.empty() ? parseCommand(entry.command)
+                                         : parseArguments(entry.arguments);
+    flags.directory = entry.directory;
+    return flags;
+}
 
-    auto lines = linesForFile(sourcefile);
-    bool skip = false;
-    for (const auto& line : lines) {
-        auto start = line.find("command\": \"");
-        if (start != std::string::npos) {
-            start += 11;
-            auto end = line.find_first_of(" \"", start);
-            while (end != std::string::npos) {
-                const auto len = end - start;
-                if (len > 0) {
-                    const auto item = line.substr(start, len);
-                    if (skip) {
-                        // skip this item but parse the next
-                        skip = false;
-                    } else if ("-o" == item || "-c" == item) {
-                        // skip this and the next which is the argument
-                        skip = true;
-                    } else {
-                        if (compiler.empty()) {
-                            compiler = item;
-                        } else {
-                            flags.push_back(item);
-                        }
-                    }
-                }
-                start = end + 1;
-                end = line.find_first_of(" \"", start);
+std::string
+CompileCommands::relativeSuffix(const std::string& sourcefile)
+{
+    const auto isAbsolute =
+      (!sourcefile.empty() &&
+       ('/' == sourcefile.front() || '\\' == sourcefile.front())) ||
+      (sourcefile.size() > 1 && ':' == sourcefile[1]);
+    if (isAbsolute) {
+        return std::string();
+    }
+    auto suffix = "/" + Util::replace_all(sourcefile, "\\", "/");
+    while (0 == suffix.compare(0, 3, "/./")) {
+        suffix.erase(0, 2);
+    }
+    return suffix;
+}
+
+CompileCommands::Flags
+CompileCommands::flagsForFile(const std::string& sourcefile) const
+{
+    TraceSpan span("compile commands lookup", sourcefile);
+    if (!_index && Environment::get("LINTER_CACHE_NO_INDEX").empty()) {
+        _index = std::make_unique<CompileCommandsIndex>(*this, _filepath);
+    }
+    Flags flags;
+    if (_index && *_index) {
+        const bool found = _index->lookup(sourcefile, flags);
+        if (*_index) {
+            if (!found) {
+                LOG(WARNING) << "No compile command for '" << sourcefile
+                             << "'";
             }
-            break;
+            return flags;
+        }
+        // a corrupted index falls back to parsing
+    }
+
+    // match the normalized paths exactly and only fall back to matching
+    // relative paths as suffix when there was no exact match at all
+    const auto path = Util::normalize_path(sourcefile);
+    const auto suffix = relativeSuffix(sourcefile);
+    const auto filename = path.substr(path.find_last_of('/'));
+    bool suffixMatched = false;
+    bool matched = false;
+    parse([&](const Entry& entry) {
+        // any match will have to end on the same filename
+        const auto& raw = entry.file;
+        if (raw.size() < filename.size() ||
+            (0 != raw.compare(raw.size() - filename.size() + 1,
+                              filename.size() - 1,
+                              filename,
+                              1,
+                              std::string::npos))) {
+            return true;
+        }
+        const auto file = Util::normalize_path(raw);
+        if (file == path) {
+            flags = flagsForEntry(entry);
+            matched = true;
+            return false;
+        }
+        if (!suffixMatched && !suffix.empty() && file.size() > suffix.size() &&
+            0 == file.compare(file.size() - suffix.size(), suffix.size(), suffix)) {
+            flags = flagsForEntry(entry);
+            suffixMatched = true;
         }
+        return true;
+    });
+    if (!matched && !suffixMatched) {
+        LOG(WARNING) << "No compile command for '" << sourcefile << "'";
     }
-    return { compiler, flags };
+    return flags;
+}
+
+bool
+CompileCommands::parse(const CompileCommandsParser::Callback& callback) const
+{
+    MappedFile input(_filepath);
+    if (!input) {
+        LOG(WARNING) << "Failed to read '" << _filepath << "'";
+        return false;
+    }
+    if (!CompileCommandsParser::parse(input.data(), input.size(), callback)) {
+        LOG(WARNING) << "Failed to parse '" << _filepath << "'";
+        return false;
+    }
+    return true;
+}
+
+std::vector<CompileCommands::Entry>
+CompileCommands::entries() const
+{
+    std::vector<Entry> out;
+    parse([&out](const Entry& entry) {
+        out.push_back(entry);
+        return true;
+    });
+    return out;
 }
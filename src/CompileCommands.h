@@ -22,29 +22,57 @@
 #ifndef COMPILE_COMMANDS_H_
 #define COMPILE_COMMANDS_H_
 
+#include <memory>
 #include <string>
+#include <vector>
 
+#include "CompileCommandsParser.h"
 #include "StringList.h"
 
+class CompileCommandsIndex;
+
 class CompileCommands
 {
 public:
     // parses the compile db at the given filepath
     CompileCommands(const std::string& filepath);
+    ~CompileCommands();
 
     struct Flags
     {
         std::string compiler;
         StringList options;
+        // the working directory and the `-o` output of the command
+        std::string directory;
+        std::string output;
     };
 
     // returns the pair of compiler and flags for the given file
     Flags flagsForFile(const std::string& sourcefile) const;
 
+    using Entry = CompileCommandsParser::Entry;
+
+    // splits the given command into the compiler and its flags,
+    // dropping any output or input given via `-o` or `-c`
+    static Flags parseCommand(const std::string& command);
+    static Flags parseArguments(const StringList& arguments);
+    static Flags flagsForEntry(const Entry& entry);
+
+    // returns all entries in the compile db in the order they are listed,
+    // any file is made absolute by resolving it against its directory
+    std::vector<Entry> entries() const;
+
+    // calls back for every entry in the compile db while parsing
+    bool parse(const CompileCommandsParser::Callback& callback) const;
+
+    // the suffix a relative path has to match on a path separator or
+    // an empty string when the given path is absolute
+    static std::string relativeSuffix(const std::string& sourcefile);
+
 private:
-    StringList linesForFile(const std::string& sourcefile) const;
 
     std::string _filepath;
+    mutable std::unique_ptr<CompileCommandsIndex> _index;
 };
 
 #endif // COMPILE_COMMANDS_H_
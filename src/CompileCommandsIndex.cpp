@@ -0,0 +1,328 @@
+/*
+ * CompileCommandsIndex.cpp
+ *
+ * Copyright (c) 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "config.h"
+
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include "CompileCommandsIndex.h"
+#include "Logging.h"
+#include "NamedFile.h"
+#include "Util.h"
+
+namespace {
+
+// bump the version whenever the layout below changes
+constexpr char kMagic[8] = { 'L', 'C', 'I', 'D', 'X', 0, 0, 2 };
+
+struct Header
+{
+    char magic[8];
+    uint64_t databaseSize;
+    int64_t databaseMtime;
+    uint64_t databaseInode;
+    uint64_t databaseDevice;
+    uint32_t slotCount;
+    uint32_t entryCount;
+    uint64_t totalSize;
+};
+
+// a slot with a pathLength of zero is empty, all offsets are given
+// relative to the start of the file. The flags are stored as a sequence
+// of zero terminated strings with directory, output and compiler in front
+struct Slot
+{
+    uint64_t hash;
+    uint32_t order;
+    uint32_t pathOffset;
+    uint32_t pathLength;
+    uint32_t flagsOffset;
+    uint32_t flagsLength;
+    uint32_t reserved;
+};
+
+uint64_t
+hashPath(const char* data, size_t len)
+{
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// true when the range lies within the strings behind the slots
+bool
+inStrings(uint64_t offset, uint64_t length, const Header& header)
+{
+    const auto begin = sizeof(Header) + uint64_t(header.slotCount) * sizeof(Slot);
+    return offset >= begin && offset <= header.totalSize &&
+           length <= header.totalSize - offset;
+}
+
+} // namespace
+
+CompileCommandsIndex::CompileCommandsIndex(const CompileCommands& database,
+                                           const std::string& databasePath)
+  : _indexPath(indexPath(databasePath))
+{
+    Util::FileInfo databaseInfo;
+    if (!Util::file_info(databasePath, databaseInfo)) {
+        return;
+    }
+    if (open(databaseInfo)) {
+        return;
+    }
+
+    LOG(TRACE) << "CompileCommandsIndex: Rebuilding '" << _indexPath << "'";
+    if (build(database, databaseInfo) && open(databaseInfo)) {
+        return;
+    }
+    LOG(WARNING) << "CompileCommandsIndex: Failed to build '" << _indexPath
+                 << "'";
+}
+
+std::string
+CompileCommandsIndex::indexPath(const std::string& databasePath)
+{
+    return databasePath + ".lcindex";
+}
+
+bool
+CompileCommandsIndex::open(const Util::FileInfo& databaseInfo)
+{
+    _mapped = std::make_unique<MappedFile>(_indexPath);
+    if (!*_mapped || _mapped->size() < sizeof(Header)) {
+        _mapped.reset();
+        return false;
+    }
+
+    Header header;
+    std::memcpy(&header, _mapped->data(), sizeof(header));
+    const bool valid =
+      0 == std::memcmp(header.magic, kMagic, sizeof(kMagic)) &&
+      header.totalSize == _mapped->size() &&
+      header.databaseSize == databaseInfo.size &&
+      header.databaseMtime == databaseInfo.mtime &&
+      header.databaseInode == databaseInfo.inode &&
+      header.databaseDevice == databaseInfo.device &&
+      header.slotCount > 0 &&
+      0 == (header.slotCount & (header.slotCount - 1)) &&
+      sizeof(Header) + uint64_t(header.slotCount) * sizeof(Slot) <=
+        header.totalSize;
+    if (!valid) {
+        LOG(TRACE) << "CompileCommandsIndex: '" << _indexPath
+                   << "' is outdated";
+        _mapped.reset();
+        return false;
+    }
+    return true;
+}
+
+bool
+CompileCommandsIndex::build(const CompileCommands& database,
+                            const Util::FileInfo& databaseInfo) const
+{
+    const auto entries = database.entries();
+
+    // keep the load factor at or below 50%
+    uint32_t slotCount = 16;
+    while (slotCount < 2 * entries.size()) {
+        slotCount *= 2;
+    }
+    std::vector<Slot> slots(slotCount);
+    std::memset(slots.data(), 0, slots.size() * sizeof(Slot));
+    std::string strings;
+
+    const auto stringsOffset = sizeof(Header) + slotCount * sizeof(Slot);
+    uint32_t order = 0;
+    for (const auto& entry : entries) {
+        const auto path = Util::normalize_path(entry.file);
+        const auto hash = hashPath(path.data(), path.size());
+
+        auto idx = hash & (slotCount - 1);
+        bool duplicate = false;
+        while (slots[idx].pathLength > 0) {
+            const auto& slot = slots[idx];
+            if (slot.hash == hash &&
+                0 == strings.compare(slot.pathOffset - stringsOffset,
+                                     slot.pathLength,
+                                     path)) {
+                // the first entry for a file wins
+                duplicate = true;
+                break;
+            }
+            idx = (idx + 1) & (slotCount - 1);
+        }
+        if (duplicate) {
+            continue;
+        }
+
+        const auto flags = CompileCommands::flagsForEntry(entry);
+        std::string encoded = flags.directory;
+        encoded.push_back('\0');
+        encoded += flags.output;
+        encoded.push_back('\0');
+        encoded += flags.compiler;
+        encoded.push_back('\0');
+        for (const auto& option : flags.options) {
+            encoded += option;
+            encoded.push_back('\0');
+        }
+
+        auto& slot = slots[idx];
+        slot.hash = hash;
+        slot.order = order++;
+        slot.pathOffset = static_cast<uint32_t>(stringsOffset + strings.size());
+        slot.pathLength = static_cast<uint32_t>(path.size());
+        strings += path;
+        slot.flagsOffset =
+          static_cast<uint32_t>(stringsOffset + strings.size());
+        slot.flagsLength = static_cast<uint32_t>(encoded.size());
+        strings += encoded;
+    }
+    if (stringsOffset + strings.size() > std::numeric_limits<uint32_t>::max()) {
+        return false;
+    }
+
+    Header header;
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.databaseSize = databaseInfo.size;
+    header.databaseMtime = databaseInfo.mtime;
+    header.databaseInode = databaseInfo.inode;
+    header.databaseDevice = databaseInfo.device;
+    header.slotCount = slotCount;
+    header.entryCount = order;
+    header.totalSize = stringsOffset + strings.size();
+
+    // write to a private file first and move it in place atomically so that
+    // concurrent readers will always see a complete index of either version
+    const auto temporary = _indexPath + "." + std::to_string(Util::process_id()) + ".tmp";
+    auto* output = fopen(temporary.c_str(), "wb");
+    if (!output) {
+        return false;
+    }
+    bool written = 1 == fwrite(&header, sizeof(header), 1, output) &&
+                   slots.size() ==
+                     fwrite(slots.data(), sizeof(Slot), slots.size(), output) &&
+                   strings.size() ==
+                     fwrite(strings.data(), 1, strings.size(), output);
+    written = (0 == fclose(output)) && written;
+    if (!written || !Util::rename_file(temporary, _indexPath)) {
+        NamedFile(temporary).unlink();
+        return false;
+    }
+    return true;
+}
+
+bool
+CompileCommandsIndex::lookup(const std::string& sourcefile,
+                             CompileCommands::Flags& flags) const
+{
+    if (!*this) {
+        return false;
+    }
+
+    const auto* base = _mapped->data();
+    Header header;
+    std::memcpy(&header, base, sizeof(header));
+    const auto* slots = reinterpret_cast<const Slot*>(base + sizeof(Header));
+    const auto mask = header.slotCount - 1;
+
+    // only the slots actually looked at get checked so that a corrupted
+    // index never makes us read past the mapping, it gets removed to be
+    // rebuilt by the next process and the compile db is parsed instead
+    auto intact = [&](const Slot& slot) {
+        return inStrings(slot.pathOffset, slot.pathLength, header) &&
+               inStrings(slot.flagsOffset, slot.flagsLength, header);
+    };
+    auto corrupted = [&] {
+        LOG(WARNING) << "CompileCommandsIndex: '" << _indexPath
+                     << "' is corrupted";
+        _corrupted = true;
+        NamedFile(_indexPath).unlink();
+        return false;
+    };
+
+    auto decode = [&](const Slot& slot) {
+        flags = CompileCommands::Flags();
+        const auto* current = base + slot.flagsOffset;
+        const auto* end = current + slot.flagsLength;
+        std::string* fixed[] = { &flags.directory,
+                                 &flags.output,
+                                 &flags.compiler };
+        size_t field = 0;
+        while (current < end) {
+            const auto len = strnlen(current, end - current);
+            if (field < 3) {
+                fixed[field++]->assign(current, len);
+            } else {
+                flags.options.emplace_back(current, len);
+            }
+            current += len + 1;
+        }
+        return true;
+    };
+
+    const auto path = Util::normalize_path(sourcefile);
+    const auto hash = hashPath(path.data(), path.size());
+    auto idx = hash & mask;
+    for (uint32_t probes = 0;
+         probes < header.slotCount && slots[idx].pathLength > 0;
+         ++probes, idx = (idx + 1) & mask) {
+        const auto& slot = slots[idx];
+        if (!intact(slot)) {
+            return corrupted();
+        }
+        if (slot.hash == hash && slot.pathLength == path.size() &&
+            0 == std::memcmp(base + slot.pathOffset, path.data(), path.size())) {
+            return decode(slot);
+        }
+    }
+
+    // relative paths may be given relative to some other directory than the
+    // current one, match them as suffix at a path separator instead
+    const auto suffix = CompileCommands::relativeSuffix(sourcefile);
+    if (suffix.empty()) {
+        return false;
+    }
+    const Slot* match = nullptr;
+    for (uint32_t idx = 0; idx < header.slotCount; ++idx) {
+        const auto& slot = slots[idx];
+        if (slot.pathLength > 0 && !intact(slot)) {
+            return corrupted();
+        }
+        if (slot.pathLength >= suffix.size() &&
+            0 == std::memcmp(base + slot.pathOffset + slot.pathLength -
+                               suffix.size(),
+                             suffix.data(),
+                             suffix.size()) &&
+            (!match || slot.order < match->order)) {
+            match = &slot;
+        }
+    }
+    return match && decode(*match);
+}
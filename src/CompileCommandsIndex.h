@@ -0,0 +1,68 @@
+/*
+ * CompileCommandsIndex.h
+ *
+ * Copyright (c) 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPILE_COMMANDS_INDEX_H_
+#define COMPILE_COMMANDS_INDEX_H_
+
+#include <memory>
+#include <string>
+
+#include "CompileCommands.h"
+#include "MappedFile.h"
+#include "Util.h"
+
+// A hash table from normalized source paths to the already tokenized
+// compiler and flags, persisted next to the compile db and memory mapped
+// to spare parsing the complete db on every lookup. The index gets rebuilt
+// whenever size, modification time or identity of the compile db change
+class CompileCommandsIndex
+{
+public:
+    // opens the index for the given compile db, (re)building it when needed
+    CompileCommandsIndex(const CompileCommands& database,
+                         const std::string& databasePath);
+
+    // true when the index could be opened, matches the compile db
+    // and no lookup found it to be corrupted
+    inline operator bool() const
+    {
+        return _mapped && *_mapped && !_corrupted;
+    }
+
+    // looks up the flags for the given file, matching the normalized path
+    // exactly or, for relative paths, as a suffix of an indexed path
+    bool lookup(const std::string& sourcefile,
+                CompileCommands::Flags& flags) const;
+
+    // the location of the index for the given compile db
+    static std::string indexPath(const std::string& databasePath);
+
+private:
+    bool open(const Util::FileInfo& databaseInfo);
+    bool build(const CompileCommands& database,
+               const Util::FileInfo& databaseInfo) const;
+
+    std::string _indexPath;
+    std::unique_ptr<MappedFile> _mapped;
+    mutable bool _corrupted = false;
+};
+
+#endif // COMPILE_COMMANDS_INDEX_H_
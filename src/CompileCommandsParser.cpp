@@ -0,0 +1,437 @@
+/*
+ * CompileCommandsParser.cpp
+ *
+ * Copyright (c) 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstring>
+#include <string_view>
+
+#include "CompileCommandsParser.h"
+
+namespace {
+
+class Reader
+{
+public:
+    Reader(const char* data, size_t size)
+      : _current(data)
+      , _end(data + size)
+    {}
+
+    bool atEnd() const { return _current >= _end; }
+
+    char peek()
+    {
+        skipWhitespace();
+        return atEnd() ? '\0' : *_current;
+    }
+
+    bool consume(char expected)
+    {
+        if (peek() == expected) {
+            ++_current;
+            return true;
+        }
+        return false;
+    }
+
+    // reads a string into out, spares a copy when no escapes are used
+    bool readString(std::string& out)
+    {
+        out.clear();
+        if (!consume('"')) {
+            return false;
+        }
+        const auto* start = _current;
+        while (_current < _end) {
+            const auto* special = static_cast<const char*>(
+              memchr(_current, '"', static_cast<size_t>(_end - _current)));
+            if (!special) {
+                return false;
+            }
+            const auto* escape = static_cast<const char*>(
+              memchr(_current, '\\', static_cast<size_t>(special - _current)));
+            if (!escape) {
+                out.append(start, special);
+                _current = special + 1;
+                return true;
+            }
+            out.append(start, escape);
+            _current = escape + 1;
+            if (!readEscape(out)) {
+                return false;
+            }
+            start = _current;
+        }
+        return false;
+    }
+
+    // reads a key and returns a view valid until the next read,
+    // keys in a compile db never need unescaping
+    bool readKey(std::string_view& key)
+    {
+        if (!consume('"')) {
+            return false;
+        }
+        const auto* start = _current;
+        while (_current < _end && '"' != *_current) {
+            if ('\\' == *_current) {
+                ++_current;
+            }
+            ++_current;
+        }
+        if (_current >= _end) {
+            return false;
+        }
+        key = std::string_view(start, static_cast<size_t>(_current - start));
+        ++_current;
+        return consume(':');
+    }
+
+    // skips any value including nested objects and arrays
+    bool skipValue()
+    {
+        switch (peek()) {
+            case '"':
+                return skipString();
+            case '{':
+            case '[': {
+                int depth = 0;
+                while (_current < _end) {
+                    const auto character = *_current;
+                    if ('"' == character) {
+                        if (!skipString()) {
+                            return false;
+                        }
+                        continue;
+                    }
+                    if ('{' == character || '[' == character) {
+                        ++depth;
+                    } else if ('}' == character || ']' == character) {
+                        --depth;
+                    }
+                    ++_current;
+                    if (0 == depth) {
+                        return true;
+                    }
+                }
+                return false;
+            }
+            default:
+                // numbers, true, false, null
+                while (_current < _end && nullptr == strchr(",}] \t\r\n", *_current)) {
+                    ++_current;
+                }
+                return true;
+        }
+    }
+
+private:
+    void skipWhitespace()
+    {
+        while (_current < _end && (' ' == *_current || '\n' == *_current ||
+                                   '\r' == *_current || '\t' == *_current)) {
+            ++_current;
+        }
+    }
+
+    bool skipString()
+    {
+        if (!consume('"')) {
+            return false;
+        }
+        while (_current < _end && '"' != *_current) {
+            if ('\\' == *_current) {
+                ++_current;
+            }
+            ++_current;
+        }
+        if (_current >= _end) {
+            return false;
+        }
+        ++_current;
+        return true;
+    }
+
+    bool readHex(unsigned& value)
+    {
+        if (_end - _current < 4) {
+            return false;
+        }
+        value = 0;
+        for (int i = 0; i < 4; ++i) {
+            const auto character = *_current++;
+            value <<= 4;
+            if (character >= '0' && character <= '9') {
+                value |= static_cast<unsigned>(character - '0');
+            } else if (character >= 'a' && character <= 'f') {
+                value |= static_cast<unsigned>(character - 'a' + 10);
+            } else if (character >= 'A' && character <= 'F') {
+                value |= static_cast<unsigned>(character - 'A' + 10);
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool readEscape(std::string& out)
+    {
+        if (_current >= _end) {
+            return false;
+        }
+        switch (*_current++) {
+            case '"':
+                out.push_back('"');
+                return true;
+            case '\\':
+                out.push_back('\\');
+                return true;
+            case '/':
+                out.push_back('/');
+                return true;
+            case 'b':
+                out.push_back('\b');
+                return true;
+            case 'f':
+                out.push_back('\f');
+                return true;
+            case 'n':
+                out.push_back('\n');
+                return true;
+            case 'r':
+                out.push_back('\r');
+                return true;
+            case 't':
+                out.push_back('\t');
+                return true;
+            case 'u': {
+                unsigned codepoint = 0;
+                if (!readHex(codepoint)) {
+                    return false;
+                }
+                if (codepoint >= 0xD800 && codepoint <= 0xDBFF &&
+                    _end - _current >= 6 && '\\' == _current[0] &&
+                    'u' == _current[1]) {
+                    _current += 2;
+                    unsigned low = 0;
+                    if (!readHex(low)) {
+                        return false;
+                    }
+                    codepoint = 0x10000 + ((codepoint - 0xD800) << 10) +
+                                (low - 0xDC00);
+                }
+                appendUtf8(out, codepoint);
+                return true;
+            }
+            default:
+                return false;
+        }
+    }
+
+    static void appendUtf8(std::string& out, unsigned codepoint)
+    {
+        if (codepoint < 0x80) {
+            out.push_back(static_cast<char>(codepoint));
+        } else if (codepoint < 0x800) {
+            out.push_back(static_cast<char>(0xC0 | (codepoint >> 6)));
+            out.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+        } else if (codepoint < 0x10000) {
+            out.push_back(static_cast<char>(0xE0 | (codepoint >> 12)));
+            out.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+        } else {
+            out.push_back(static_cast<char>(0xF0 | (codepoint >> 18)));
+            out.push_back(static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+        }
+    }
+
+    const char* _current;
+    const char* _end;
+};
+
+bool
+isAbsolute(const std::string& path)
+{
+    return (!path.empty() && ('/' == path.front() || '\\' == path.front())) ||
+           (path.size() > 1 && ':' == path[1]);
+}
+
+} // namespace
+
+bool
+CompileCommandsParser::parse(const char* data,
+                             size_t size,
+                             const Callback& callback)
+{
+    Reader reader(data, size);
+    if (!reader.consume('[')) {
+        return false;
+    }
+    if (reader.consume(']')) {
+        return true;
+    }
+
+    Entry entry;
+    std::string value;
+    do {
+        if (!reader.consume('{')) {
+            return false;
+        }
+        entry.directory.clear();
+        entry.file.clear();
+        entry.command.clear();
+        entry.arguments.clear();
+
+        if (!reader.consume('}')) {
+            do {
+                std::string_view key;
+                if (!reader.readKey(key)) {
+                    return false;
+                }
+                if ("directory" == key) {
+                    if (!reader.readString(entry.directory)) {
+                        return false;
+                    }
+                } else if ("file" == key) {
+                    if (!reader.readString(entry.file)) {
+                        return false;
+                    }
+                } else if ("command" == key) {
+                    if (!reader.readString(entry.command)) {
+                        return false;
+                    }
+                } else if ("arguments" == key) {
+                    if (!reader.consume('[')) {
+                        return false;
+                    }
+                    if (!reader.consume(']')) {
+                        do {
+                            if (!reader.readString(value)) {
+                                return false;
+                            }
+                            entry.arguments.push_back(value);
+                        } while (reader.consume(','));
+                        if (!reader.consume(']')) {
+                            return false;
+                        }
+                    }
+                } else if (!reader.skipValue()) {
+                    return false;
+                }
+            } while (reader.consume(','));
+            if (!reader.consume('}')) {
+                return false;
+            }
+        }
+
+        if (!entry.file.empty()) {
+            if (!isAbsolute(entry.file) && !entry.directory.empty()) {
+                entry.file = entry.directory + "/" + entry.file;
+            }
+            if (!callback(entry)) {
+                return true;
+            }
+        }
+    } while (reader.consume(','));
+
+    return reader.consume(']');
+}
+
+StringList
+CompileCommandsParser::splitCommand(const std::string& command,
+                                    bool windowsStyle)
+{
+    StringList out;
+    std::string current;
+    bool inArgument = false;
+    char quote = '\0';
+
+    for (size_t i = 0; i < command.size(); ++i) {
+        const auto character = command[i];
+        if ('\0' == quote && (' ' == character || '\t' == character ||
+                              '\n' == character || '\r' == character)) {
+            if (inArgument) {
+                out.push_back(current);
+                current.clear();
+                inArgument = false;
+            }
+            continue;
+        }
+        inArgument = true;
+
+        if (windowsStyle) {
+            // backslashes are literal unless followed by a quote
+            if ('\\' == character) {
+                size_t count = 0;
+                while (i < command.size() && '\\' == command[i]) {
+                    ++count;
+                    ++i;
+                }
+                if (i < command.size() && '"' == command[i]) {
+                    current.append(count / 2, '\\');
+                    if (count % 2) {
+                        current.push_back('"');
+                    } else {
+                        quote = ('\0' == quote) ? '"' : '\0';
+                    }
+                } else {
+                    current.append(count, '\\');
+                    --i;
+                }
+            } else if ('"' == character) {
+                quote = ('\0' == quote) ? '"' : '\0';
+            } else {
+                current.push_back(character);
+            }
+            continue;
+        }
+
+        if ('\'' == quote) {
+            // everything is literal within single quotes
+            if ('\'' == character) {
+                quote = '\0';
+            } else {
+                current.push_back(character);
+            }
+        } else if ('"' == quote) {
+            if ('"' == character) {
+                quote = '\0';
+            } else if ('\\' == character && i + 1 < command.size() &&
+                       '\0' != command[i + 1] &&
+                       nullptr != strchr("\"\\$`", command[i + 1])) {
+                current.push_back(command[++i]);
+            } else {
+                current.push_back(character);
+            }
+        } else if ('\'' == character || '"' == character) {
+            quote = character;
+        } else if ('\\' == character && i + 1 < command.size()) {
+            current.push_back(command[++i]);
+        } else {
+            current.push_back(character);
+        }
+    }
+    if (inArgument) {
+        out.push_back(current);
+    }
+    return out;
+}
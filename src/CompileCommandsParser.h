@@ -0,0 +1,60 @@
+/*
+ * CompileCommandsParser.h
+ *
+ * Copyright (c) 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPILE_COMMANDS_PARSER_H_
+#define COMPILE_COMMANDS_PARSER_H_
+
+#include <functional>
+#include <string>
+
+#include "StringList.h"
+
+// Single pass parser for the JSON compilation database format, see
+// https://clang.llvm.org/docs/JSONCompilationDatabase.html
+// Entries get reported one by one while parsing, reusing the same
+// storage for all of them to keep allocations at a minimum
+class CompileCommandsParser
+{
+public:
+    struct Entry
+    {
+        std::string directory;
+        // absolute when the database listed a directory
+        std::string file;
+        // either command or arguments will be given
+        std::string command;
+        StringList arguments;
+    };
+
+    // return false to stop parsing after the given entry
+    using Callback = std::function<bool(const Entry&)>;
+
+    // parses the given database contents, returns false on malformed input
+    static bool parse(const char* data, size_t size, const Callback& callback);
+
+    // splits the given command line into single arguments observing the
+    // quoting rules of a shell or, when windowsStyle is set, those of the
+    // windows command line
+    static StringList splitCommand(const std::string& command,
+                                   bool windowsStyle);
+};
+
+#endif // COMPILE_COMMANDS_PARSER_H_
@@ -0,0 +1,287 @@
+/*
+ * ConfigResolver.cpp
+ *
+ * Copyright (c) 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+
+#include "ConfigResolver.h"
+#include "Digest.h"
+#include "Logging.h"
+#include "NamedFile.h"
+#include "Util.h"
+#include "Trace.h"
+
+static constexpr char kConfigFile[] = "--config-file";
+static constexpr char kConfig[] = "--config";
+static constexpr size_t kCompactThreshold = 64;
+
+namespace {
+
+std::string
+parentOf(const std::string& path)
+{
+    const auto slash = path.find_last_of('/');
+    if (std::string::npos == slash || 0 == slash) {
+        return std::string(std::string::npos == slash ? "" : "/");
+    }
+    return path.substr(0, slash);
+}
+
+// the value of `--option=value` or `--option value`
+bool
+optionValue(const StringList& args,
+            const char* option,
+            std::string& value)
+{
+    const std::string prefix = std::string(option) + "=";
+    for (size_t i = 0; i < args.size(); ++i) {
+        // clang-tidy accepts options with a single dash too
+        auto arg = args[i];
+        if (0 == arg.compare(0, 1, "-") && 0 != arg.compare(0, 2, "--")) {
+            arg.insert(0, "-");
+        }
+        if (0 == arg.compare(0, prefix.size(), prefix)) {
+            value = arg.substr(prefix.size());
+            return true;
+        }
+        if (arg == option && i + 1 < args.size()) {
+            value = args[i + 1];
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+std::string
+ConfigResolver::format(const std::string& directory, const Entry& entry)
+{
+    std::string line = directory + "\t" + entry.digest + "\t" +
+                       std::to_string(entry.chain.size());
+    for (const auto& config : entry.chain) {
+        line += "\t" + config;
+    }
+    for (const auto& check : entry.checks) {
+        line += "\t" + check.first + "\t" + std::to_string(check.second);
+    }
+    return line + "\n";
+}
+
+ConfigResolver::ConfigResolver(const std::string& name,
+                               const std::string& memoPath)
+  : _name(name)
+  , _memoPath(memoPath)
+  , _loaded(false)
+{}
+
+std::string
+ConfigResolver::defaultPath()
+{
+    return Util::cache_dir() + "/configs.txt";
+}
+
+bool
+ConfigResolver::inheritsParent(const std::string& contents)
+{
+    static const std::string kKey = "InheritParentConfig";
+    size_t pos = 0;
+    while ((pos = contents.find(kKey, pos)) != std::string::npos) {
+        // only consider the key at the start of a line
+        auto start = pos;
+        while (start > 0 && (' ' == contents[start - 1] ||
+                             '\t' == contents[start - 1])) {
+            --start;
+        }
+        pos += kKey.size();
+        if (start > 0 && '\n' != contents[start - 1]) {
+            continue;
+        }
+        auto i = pos;
+        while (i < contents.size() && (' ' == contents[i] || '\t' == contents[i])) {
+            ++i;
+        }
+        if (i == contents.size() || ':' != contents[i]) {
+            continue;
+        }
+        ++i;
+        while (i < contents.size() && (' ' == contents[i] || '\t' == contents[i])) {
+            ++i;
+        }
+        auto end = contents.find_first_of(" \t\r\n#", i);
+        auto value = contents.substr(i, end - i);
+        for (auto& c : value) {
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+        return "true" == value || "yes" == value || "on" == value;
+    }
+    return false;
+}
+
+ConfigResolver::Entry
+ConfigResolver::walk(const std::string& directory) const
+{
+    Entry entry;
+    Digest digest;
+    Util::FileInfo info;
+    auto dir = directory;
+    while (!dir.empty()) {
+        // the directory changes whenever a config gets added or removed
+        if (Util::file_info(dir, info)) {
+            entry.checks.emplace_back(dir, info.mtime);
+        }
+        const auto candidate = (dir == "/" ? dir : dir + "/") + _name;
+        if (Util::file_info(candidate, info)) {
+            const auto contents = NamedFile(candidate).readText();
+            entry.chain.push_back(candidate);
+            entry.checks.emplace_back(candidate, info.mtime);
+            digest.update(candidate);
+            digest.update(contents);
+            if (!inheritsParent(contents)) {
+                break;
+            }
+        }
+        if ("/" == dir || parentOf(dir) == dir) {
+            break;
+        }
+        dir = parentOf(dir);
+    }
+    entry.digest = digest.hex();
+    return entry;
+}
+
+bool
+ConfigResolver::valid(const Entry& entry) const
+{
+    Util::FileInfo info;
+    for (const auto& check : entry.checks) {
+        if (!Util::file_info(check.first, info) ||
+            info.mtime != check.second) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void
+ConfigResolver::load()
+{
+    if (_loaded) {
+        return;
+    }
+    _loaded = true;
+
+    // every line is a tab separated list of the directory, the digest,
+    // the number of configs in the chain, the chain and the checks done
+    // as pairs of path and time. Later lines override earlier ones
+    const auto lines = NamedFile(_memoPath).readLines();
+    for (const auto& line : lines) {
+        StringList fields;
+        size_t start = 0;
+        while (start <= line.size()) {
+            auto end = line.find('\t', start);
+            if (std::string::npos == end) {
+                end = line.size();
+            }
+            fields.push_back(line.substr(start, end - start));
+            start = end + 1;
+        }
+        if (fields.size() < 3) {
+            continue;
+        }
+        Entry entry;
+        entry.digest = fields[1];
+        const auto chain = static_cast<size_t>(std::atol(fields[2].c_str()));
+        if (fields.size() < 3 + chain || 0 != (fields.size() - 3 - chain) % 2) {
+            continue;
+        }
+        entry.chain.assign(fields.begin() + 3, fields.begin() + 3 + chain);
+        for (auto i = 3 + chain; i < fields.size(); i += 2) {
+            entry.checks.emplace_back(
+              fields[i], std::atoll(fields[i + 1].c_str()));
+        }
+        _memo[fields[0]] = entry;
+    }
+
+    // drop outdated lines once they make up most of the memo
+    if (lines.size() > 2 * _memo.size() + kCompactThreshold) {
+        std::string compacted;
+        for (const auto& item : _memo) {
+            compacted += format(item.first, item.second);
+        }
+        Util::write_file_atomically(_memoPath, compacted);
+    }
+}
+
+void
+ConfigResolver::record(const std::string& directory, const Entry& entry)
+{
+    _memo[directory] = entry;
+
+    const auto line = format(directory, entry);
+
+    // a single short write in append mode will not be interleaved
+    // with writes of other processes recording at the same time
+    Util::make_dirs(parentOf(_memoPath));
+    auto* output = fopen(_memoPath.c_str(), "a");
+    if (output) {
+        fwrite(line.data(), 1, line.size(), output);
+        fclose(output);
+    } else {
+        LOG(WARNING) << "Failed to record configs in '" << _memoPath << "'";
+    }
+}
+
+ConfigResolver::Config
+ConfigResolver::resolve(const std::string& sourcefile, const StringList& args)
+{
+    TraceSpan span("resolve config", sourcefile);
+    Config config;
+    Digest digest;
+    for (const auto& arg : args) {
+        digest.update(arg);
+    }
+
+    std::string value;
+    if (optionValue(args, kConfigFile, value)) {
+        // an explicit config file replaces any lookup
+        const auto path = Util::normalize_path(value);
+        config.chain.push_back(path);
+        digest.update(path);
+        digest.update(NamedFile(path).readText());
+    } else if (!optionValue(args, kConfig, value)) {
+        const auto directory = parentOf(Util::normalize_path(sourcefile));
+        load();
+        auto it = _memo.find(directory);
+        if (it == _memo.end() ||
+            !(it->second.verified || valid(it->second))) {
+            LOG(TRACE) << "ConfigResolver: Walking '" << directory << "'";
+            record(directory, walk(directory));
+            it = _memo.find(directory);
+        }
+        it->second.verified = true;
+        config.chain = it->second.chain;
+        digest.update(it->second.digest);
+    }
+    config.digest = digest.hex();
+    return config;
+}
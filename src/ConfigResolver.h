@@ -0,0 +1,84 @@
+/*
+ * ConfigResolver.h
+ *
+ * Copyright (c) 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CONFIG_RESOLVER_H_
+#define CONFIG_RESOLVER_H_
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "StringList.h"
+
+// finds the configuration files which apply to a source the same way
+// clang-tidy does, following `InheritParentConfig` to parent directories.
+// Results are memoized per directory in memory and across invocations in
+// a file validated by the modification times of everything looked at
+class ConfigResolver
+{
+public:
+    struct Config
+    {
+        // the configuration files in order of precedence
+        StringList chain;
+        // digest of the contents of all files and the linter arguments
+        std::string digest;
+    };
+
+    ConfigResolver(const std::string& name = ".clang-tidy",
+                   const std::string& memoPath = defaultPath());
+
+    // resolves the configuration for the given source and linter arguments
+    // which may name a configuration via `--config-file` or `--config`
+    Config resolve(const std::string& sourcefile, const StringList& args);
+
+    // true when the given configuration asks to inherit its parent's
+    static bool inheritsParent(const std::string& contents);
+
+    // the location used when no explicit memo path is given
+    static std::string defaultPath();
+
+private:
+    struct Entry
+    {
+        StringList chain;
+        std::string digest;
+        // paths looked at together with their modification times
+        std::vector<std::pair<std::string, int64_t>> checks;
+        // true once validated by this process
+        bool verified = false;
+    };
+
+    static std::string format(const std::string& directory, const Entry& entry);
+
+    Entry walk(const std::string& directory) const;
+    bool valid(const Entry& entry) const;
+    void load();
+    void record(const std::string& directory, const Entry& entry);
+
+    std::string _name;
+    std::string _memoPath;
+    bool _loaded;
+    std::map<std::string, Entry> _memo;
+};
+
+#endif // CONFIG_RESOLVER_H_
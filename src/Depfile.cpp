@@ -0,0 +1,222 @@
+/*
+ * Depfile.cpp
+ *
+ * Copyright (c) 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <set>
+
+#include "Depfile.h"
+#include "Logging.h"
+#include "NamedFile.h"
+#include "Util.h"
+
+namespace {
+
+bool
+isAbsolute(const std::string& path)
+{
+    return (!path.empty() && ('/' == path.front() || '\\' == path.front())) ||
+           (path.size() > 1 && ':' == path[1]);
+}
+
+std::string
+resolve(const std::string& path, const std::string& directory)
+{
+    if (path.empty() || isAbsolute(path) || directory.empty()) {
+        return Util::normalize_path(path);
+    }
+    return Util::normalize_path(directory + "/" + path);
+}
+
+} // namespace
+
+bool
+Depfile::msvcStyle(const CompileCommands::Flags& flags)
+{
+    for (const auto& option : flags.options) {
+        if (0 == option.compare(0, 14, "--driver-mode=")) {
+            return "--driver-mode=cl" == option;
+        }
+    }
+    auto name = flags.compiler.substr(flags.compiler.find_last_of("/\\") + 1);
+    std::transform(name.begin(), name.end(), name.begin(), [](char c) {
+        return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    });
+    if (name.size() > 4 && 0 == name.compare(name.size() - 4, 4, ".exe")) {
+        name.resize(name.size() - 4);
+    }
+    return "cl" == name ||
+           (name.size() >= 8 && 0 == name.compare(name.size() - 8, 8, "clang-cl"));
+}
+
+std::string
+Depfile::pathFor(const CompileCommands::Flags& flags)
+{
+    std::string depfile;
+    bool writesDepfile = false;
+    const auto& options = flags.options;
+    for (size_t i = 0; i < options.size(); ++i) {
+        const auto& option = options[i];
+        if ("-MD" == option || "-MMD" == option) {
+            writesDepfile = true;
+        } else if ("-MF" == option && i + 1 < options.size()) {
+            depfile = options[++i];
+        } else if (0 == option.compare(0, 3, "-MF")) {
+            depfile = option.substr(3);
+        } else if (0 == option.compare(0, 8, "-Wp,-MD,") ||
+                   0 == option.compare(0, 9, "-Wp,-MMD,")) {
+            writesDepfile = true;
+            depfile = option.substr(option.find(',', 4) + 1);
+        }
+    }
+    if (!writesDepfile) {
+        return std::string();
+    }
+    if (depfile.empty()) {
+        // without -MF the output is taken with its suffix replaced
+        if (flags.output.empty()) {
+            return std::string();
+        }
+        const auto dot = flags.output.find_last_of('.');
+        const auto slash = flags.output.find_last_of("/\\");
+        depfile = flags.output.substr(
+                    0,
+                    (std::string::npos != dot &&
+                     (std::string::npos == slash || dot > slash))
+                      ? dot
+                      : std::string::npos) +
+                  ".d";
+    }
+    return resolve(depfile, flags.directory);
+}
+
+StringList
+Depfile::withoutDepfileOptions(const StringList& options)
+{
+    StringList filtered;
+    for (size_t i = 0; i < options.size(); ++i) {
+        const auto& option = options[i];
+        if ("-MD" == option || "-MMD" == option || "-MP" == option) {
+            continue;
+        }
+        if ("-MF" == option || "-MT" == option || "-MQ" == option) {
+            ++i;
+            continue;
+        }
+        if (0 == option.compare(0, 3, "-MF") ||
+            0 == option.compare(0, 3, "-MT") ||
+            0 == option.compare(0, 3, "-MQ") ||
+            0 == option.compare(0, 8, "-Wp,-MD,") ||
+            0 == option.compare(0, 9, "-Wp,-MMD,")) {
+            continue;
+        }
+        filtered.push_back(option);
+    }
+    return filtered;
+}
+
+Depfile::Depfile(const std::string& filepath, const std::string& directory)
+  : _filepath(filepath)
+  , _valid(false)
+{
+    if (!Util::is_file(_filepath)) {
+        return;
+    }
+    for (const auto& dependency : parse(NamedFile(_filepath).readText())) {
+        _dependencies.push_back(resolve(dependency, directory));
+    }
+    _valid = true;
+}
+
+bool
+Depfile::fresh() const
+{
+    Util::FileInfo depfile;
+    if (!_valid || !Util::file_info(_filepath, depfile)) {
+        return false;
+    }
+    Util::FileInfo info;
+    for (const auto& dependency : _dependencies) {
+        if (!Util::file_info(dependency, info)) {
+            LOG(TRACE) << "Depfile: '" << dependency << "' is missing";
+            return false;
+        }
+        if (info.mtime > depfile.mtime) {
+            LOG(TRACE) << "Depfile: '" << dependency << "' is newer than '"
+                       << _filepath << "'";
+            return false;
+        }
+    }
+    return true;
+}
+
+StringList
+Depfile::parse(const std::string& contents)
+{
+    StringList dependencies;
+    std::set<std::string> seen;
+    std::string current;
+    bool target = true;
+
+    auto finish = [&] {
+        if (current.empty()) {
+            return;
+        }
+        if (!target && seen.insert(current).second) {
+            dependencies.push_back(current);
+        }
+        current.clear();
+    };
+
+    for (size_t i = 0; i < contents.size(); ++i) {
+        const char c = contents[i];
+        const char next = i + 1 < contents.size() ? contents[i + 1] : '\0';
+        if ('\\' == c && ('\n' == next || '\r' == next)) {
+            // line continuation
+            finish();
+            i += ('\r' == next && i + 2 < contents.size() &&
+                  '\n' == contents[i + 2])
+                   ? 2
+                   : 1;
+        } else if ('\\' == c && (' ' == next || '#' == next)) {
+            current += next;
+            ++i;
+        } else if ('$' == c && '$' == next) {
+            current += '$';
+            ++i;
+        } else if (' ' == c || '\t' == c) {
+            finish();
+        } else if ('\n' == c || '\r' == c) {
+            // a new rule starts with its targets
+            finish();
+            target = true;
+        } else if (':' == c && (' ' == next || '\t' == next || '\n' == next ||
+                                '\r' == next || '\0' == next)) {
+            // the end of the targets, excluding drive letters
+            current.clear();
+            target = false;
+        } else {
+            current += c;
+        }
+    }
+    finish();
+    return dependencies;
+}
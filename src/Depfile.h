@@ -0,0 +1,69 @@
+/*
+ * Depfile.h
+ *
+ * Copyright (c) 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DEPFILE_H_
+#define DEPFILE_H_
+
+#include <string>
+
+#include "CompileCommands.h"
+#include "StringList.h"
+
+// a makefile style dependency file as written by compilers via `-MD`
+class Depfile
+{
+public:
+    // the depfile written by the given compile command,
+    // empty when the command does not write any
+    static std::string pathFor(const CompileCommands::Flags& flags);
+
+    // true for cl style compilers which know neither `-MD` nor `-MF`,
+    // with them `-MD` selects the runtime library instead
+    static bool msvcStyle(const CompileCommands::Flags& flags);
+
+    // removes all options writing a depfile so that running the compiler
+    // again will not overwrite the one written by the build
+    static StringList withoutDepfileOptions(const StringList& options);
+
+    // parses the depfile at the given path, all prerequisites are
+    // made absolute by resolving them against the given directory
+    Depfile(const std::string& filepath, const std::string& directory);
+
+    // true when the depfile was read successfully
+    inline operator bool() const { return _valid; }
+
+    // the prerequisites listed for all targets in the order given
+    inline const StringList& dependencies() const { return _dependencies; }
+
+    // true when neither the depfile nor any of the listed dependencies
+    // are missing and none was modified after the depfile was written
+    bool fresh() const;
+
+    // splits the contents of a depfile into its prerequisites
+    static StringList parse(const std::string& contents);
+
+private:
+    std::string _filepath;
+    StringList _dependencies;
+    bool _valid;
+};
+
+#endif // DEPFILE_H_
@@ -0,0 +1,185 @@
+/*
+ * Digest.cpp
+ *
+ * Copyright (c) 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include "Digest.h"
+#include "MappedFile.h"
+#include "Util.h"
+
+namespace {
+
+constexpr uint64_t kC1 = 0x87c37b91114253d5ULL;
+constexpr uint64_t kC2 = 0x4cf5ad432745937fULL;
+
+inline uint64_t
+rotl(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+inline uint64_t
+fmix(uint64_t k)
+{
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return k;
+}
+
+inline uint64_t
+load(const unsigned char* data)
+{
+    // little endian independent of the host
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; --i) {
+        value = (value << 8) | data[i];
+    }
+    return value;
+}
+
+inline void
+mixBlock(uint64_t& h1, uint64_t& h2, const unsigned char* block)
+{
+    auto k1 = load(block);
+    auto k2 = load(block + 8);
+
+    k1 *= kC1;
+    k1 = rotl(k1, 31);
+    k1 *= kC2;
+    h1 ^= k1;
+    h1 = rotl(h1, 27);
+    h1 += h2;
+    h1 = h1 * 5 + 0x52dce729;
+
+    k2 *= kC2;
+    k2 = rotl(k2, 33);
+    k2 *= kC1;
+    h2 ^= k2;
+    h2 = rotl(h2, 31);
+    h2 += h1;
+    h2 = h2 * 5 + 0x38495ab5;
+}
+
+} // namespace
+
+Digest::Digest()
+  : _h1(0)
+  , _h2(0)
+  , _length(0)
+  , _tail()
+  , _tailSize(0)
+{}
+
+Digest&
+Digest::update(const void* data, size_t size)
+{
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    _length += size;
+
+    if (_tailSize > 0) {
+        const auto missing = std::min(_tail.size() - _tailSize, size);
+        std::memcpy(_tail.data() + _tailSize, bytes, missing);
+        _tailSize += missing;
+        bytes += missing;
+        size -= missing;
+        if (_tailSize < _tail.size()) {
+            return *this;
+        }
+        mixBlock(_h1, _h2, _tail.data());
+        _tailSize = 0;
+    }
+    while (size >= _tail.size()) {
+        mixBlock(_h1, _h2, bytes);
+        bytes += _tail.size();
+        size -= _tail.size();
+    }
+    if (size > 0) {
+        std::memcpy(_tail.data(), bytes, size);
+        _tailSize = size;
+    }
+    return *this;
+}
+
+std::string
+Digest::hex() const
+{
+    auto h1 = _h1;
+    auto h2 = _h2;
+
+    uint64_t k1 = 0;
+    uint64_t k2 = 0;
+    for (auto i = _tailSize; i > 8; --i) {
+        k2 = (k2 << 8) | _tail[i - 1];
+    }
+    for (auto i = std::min<size_t>(_tailSize, 8); i > 0; --i) {
+        k1 = (k1 << 8) | _tail[i - 1];
+    }
+    if (_tailSize > 8) {
+        k2 *= kC2;
+        k2 = rotl(k2, 33);
+        k2 *= kC1;
+        h2 ^= k2;
+    }
+    if (_tailSize > 0) {
+        k1 *= kC1;
+        k1 = rotl(k1, 31);
+        k1 *= kC2;
+        h1 ^= k1;
+    }
+
+    h1 ^= _length;
+    h2 ^= _length;
+    h1 += h2;
+    h2 += h1;
+    h1 = fmix(h1);
+    h2 = fmix(h2);
+    h1 += h2;
+    h2 += h1;
+
+    static constexpr char kHex[] = "0123456789abcdef";
+    std::string result(32, '0');
+    for (int i = 0; i < 16; ++i) {
+        const auto value = i < 8 ? h1 >> (56 - 8 * i) : h2 >> (120 - 8 * i);
+        result[2 * i] = kHex[(value >> 4) & 0xf];
+        result[2 * i + 1] = kHex[value & 0xf];
+    }
+    return result;
+}
+
+bool
+Digest::file(const std::string& filepath, std::string& hex)
+{
+    // an empty file cannot be mapped, tell it apart from a missing one
+    Util::FileInfo info;
+    if (!Util::file_info(filepath, info)) {
+        return false;
+    }
+    MappedFile mapped(filepath);
+    if (!mapped && info.size > 0) {
+        return false;
+    }
+    hex = Digest().update(mapped.data(), mapped.size()).hex();
+    return true;
+}
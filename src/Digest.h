@@ -0,0 +1,61 @@
+/*
+ * Digest.h
+ *
+ * Copyright (c) 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DIGEST_H_
+#define DIGEST_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// incremental 128bit hash used to fingerprint files and arguments,
+// this is MurmurHash3 x64_128 which is fast but not cryptographically secure
+class Digest
+{
+public:
+    Digest();
+
+    Digest& update(const void* data, size_t size);
+    inline Digest& update(const std::string& data)
+    {
+        // include the size so that consecutive strings cannot be confused
+        const uint64_t size = data.size();
+        update(&size, sizeof(size));
+        return update(data.data(), data.size());
+    }
+
+    // the digest of all data passed so far as a hex string
+    std::string hex() const;
+
+    // the hex digest of the contents of the given file,
+    // returns false when the file could not be read
+    static bool file(const std::string& filepath, std::string& hex);
+
+private:
+    uint64_t _h1;
+    uint64_t _h2;
+    uint64_t _length;
+    std::array<unsigned char, 16> _tail;
+    size_t _tailSize;
+};
+
+#endif // DIGEST_H_
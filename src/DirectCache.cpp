@@ -0,0 +1,319 @@
+/*
+ * DirectCache.cpp
+ *
+ * Copyright (c) 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_set>
+
+#include "DirectCache.h"
+#include "Digest.h"
+#include "Environment.h"
+#include "Logging.h"
+#include "MappedFile.h"
+#include "Util.h"
+
+const char* DirectCache::kEnvDependencies = "LINTER_CACHE_DIRECT_DEPENDENCIES";
+static constexpr char kEnvDirect[] = "LINTER_CACHE_DIRECT";
+// bump the version whenever the layout of manifests changes
+static constexpr char kMagic[] = "LCDIRECT 1\n";
+static constexpr size_t kDigestSize = 32;
+
+namespace {
+
+// reads a `<length>\n<data>` field starting at pos
+bool
+readField(const char* data, size_t size, size_t& pos, std::string& field)
+{
+    const auto* newline =
+      static_cast<const char*>(std::memchr(data + pos, '\n', size - pos));
+    if (!newline) {
+        return false;
+    }
+    char* end = nullptr;
+    const auto length = std::strtoull(data + pos, &end, 10);
+    if (end != newline) {
+        return false;
+    }
+    pos = static_cast<size_t>(newline - data) + 1;
+    if (length > size - pos) {
+        return false;
+    }
+    field.assign(data + pos, length);
+    pos += length;
+    return true;
+}
+
+void
+writeField(std::string& out, const std::string& field)
+{
+    out += std::to_string(field.size());
+    out += '\n';
+    out += field;
+}
+
+} // namespace
+
+DirectCache::DirectCache(const std::string& directory)
+  : _directory(directory)
+{}
+
+std::string
+DirectCache::defaultPath()
+{
+    return Util::cache_dir() + "/direct";
+}
+
+bool
+DirectCache::enabled()
+{
+    return Environment::get(kEnvDirect, 0) != 0;
+}
+
+std::string
+DirectCache::manifestPath(const std::string& key) const
+{
+    return _directory + "/" + key.substr(0, 2) + "/" + key.substr(2);
+}
+
+bool
+DirectCache::lookup(const std::string& key, Result& result) const
+{
+    MappedFile manifest(manifestPath(key));
+    if (!manifest) {
+        return false;
+    }
+    const auto* data = manifest.data();
+    const auto size = manifest.size();
+    const auto magicSize = sizeof(kMagic) - 1;
+    if (size < magicSize || 0 != std::memcmp(data, kMagic, magicSize)) {
+        LOG(TRACE) << "DirectCache: Ignoring invalid manifest for " << key;
+        return false;
+    }
+
+    size_t pos = magicSize;
+    std::string dependencies;
+    if (!readField(data, size, pos, dependencies) ||
+        !readField(data, size, pos, result.output) ||
+        !readField(data, size, pos, result.errorOutput) ||
+        !readField(data, size, pos, result.objectContents)) {
+        LOG(TRACE) << "DirectCache: Ignoring truncated manifest for " << key;
+        return false;
+    }
+
+    // every line is `<digest> <path>`
+    size_t start = 0;
+    std::string digest;
+    while (start < dependencies.size()) {
+        auto end = dependencies.find('\n', start);
+        if (std::string::npos == end) {
+            end = dependencies.size();
+        }
+        const auto space = dependencies.find(' ', start);
+        if (std::string::npos == space || space > end) {
+            return false;
+        }
+        const auto path = dependencies.substr(space + 1, end - space - 1);
+        if (!Digest::file(path, digest) ||
+            0 != dependencies.compare(start, space - start, digest)) {
+            LOG(TRACE) << "DirectCache: '" << path << "' changed for " << key;
+            return false;
+        }
+        start = end + 1;
+    }
+    return true;
+}
+
+bool
+DirectCache::store(const std::string& key,
+                   const std::string& dependencies,
+                   const Result& result) const
+{
+    for (size_t start = 0; start < dependencies.size();) {
+        const auto space = dependencies.find(' ', start);
+        if (space - start != kDigestSize) {
+            LOG(TRACE) << "DirectCache: Not storing " << key
+                       << " with unresolved dependencies";
+            return false;
+        }
+        start = dependencies.find('\n', space);
+        start = std::string::npos == start ? start : start + 1;
+    }
+
+    std::string contents = kMagic;
+    writeField(contents, dependencies);
+    writeField(contents, result.output);
+    writeField(contents, result.errorOutput);
+    writeField(contents, result.objectContents);
+
+    const auto path = manifestPath(key);
+    Util::make_dirs(path.substr(0, path.find_last_of('/')));
+
+    // concurrent lookups will always see a complete manifest
+    if (!Util::write_file_atomically(path, contents)) {
+        LOG(WARNING) << "Failed to store manifest in '" << path << "'";
+        return false;
+    }
+    return true;
+}
+
+bool
+DirectCache::addDependency(std::string& dependencies,
+                           const std::string& filepath)
+{
+    std::string digest;
+    if (!Digest::file(filepath, digest)) {
+        return false;
+    }
+    dependencies += digest + " " + filepath + "\n";
+    return true;
+}
+
+StringList
+DirectCache::filesFromPreprocessed(const std::string& preprocessed)
+{
+    StringList files;
+    std::unordered_set<std::string> seen;
+
+    // line markers are either `# 1 "file" flags` or `#line 1 "file"`
+    const auto* data = preprocessed.data();
+    const auto size = preprocessed.size();
+    size_t pos = 0;
+    while (pos < size) {
+        const auto* newline =
+          static_cast<const char*>(std::memchr(data + pos, '\n', size - pos));
+        const size_t end =
+          newline ? static_cast<size_t>(newline - data) : size;
+        size_t i = pos;
+        pos = end + 1;
+
+        if (data[i] != '#') {
+            continue;
+        }
+        ++i;
+        while (i < end && data[i] == ' ') {
+            ++i;
+        }
+        if (0 == preprocessed.compare(i, 4, "line")) {
+            i += 4;
+            while (i < end && data[i] == ' ') {
+                ++i;
+            }
+        }
+        if (i == end || data[i] < '0' || data[i] > '9') {
+            continue;
+        }
+        while (i < end && data[i] >= '0' && data[i] <= '9') {
+            ++i;
+        }
+        while (i < end && data[i] == ' ') {
+            ++i;
+        }
+        if (i == end || data[i] != '"') {
+            continue;
+        }
+
+        std::string file;
+        for (++i; i < end && data[i] != '"'; ++i) {
+            if (data[i] == '\\' && i + 1 < end) {
+                ++i;
+            }
+            file += data[i];
+        }
+        // skip pseudo files like <built-in> or <command line>
+        if (file.empty() || file[0] == '<') {
+            continue;
+        }
+        if (seen.insert(file).second) {
+            files.push_back(file);
+        }
+    }
+    return files;
+}
+
+void
+DirectCache::recordDependencies(const std::string& preprocessed)
+{
+    const auto filename = Environment::get(kEnvDependencies);
+    if (filename.empty()) {
+        return;
+    }
+
+    std::string dependencies;
+    for (const auto& file : filesFromPreprocessed(preprocessed)) {
+        if (!addDependency(dependencies, file)) {
+            // poison the manifest, it cannot be verified later on
+            LOG(TRACE) << "DirectCache: Unreadable dependency '" << file << "'";
+            dependencies += "? " + file + "\n";
+        }
+    }
+
+    // a single write in append mode as the caller already recorded the source
+    auto* output = fopen(filename.c_str(), "ab");
+    if (output) {
+        fwrite(dependencies.data(), 1, dependencies.size(), output);
+        fclose(output);
+    } else {
+        LOG(WARNING) << "Failed to record dependencies in '" << filename
+                     << "'";
+    }
+}
+
+DirectCache::Recorder::Recorder(OutputSink& next)
+  : _next(next)
+  , _lineStart(true)
+  , _inMarker(false)
+{}
+
+void
+DirectCache::Recorder::write(const char* data, size_t size)
+{
+    _next.write(data, size);
+
+    size_t pos = 0;
+    while (pos < size) {
+        if (_lineStart) {
+            _inMarker = (data[pos] == '#');
+        }
+        const auto* newline =
+          static_cast<const char*>(std::memchr(data + pos, '\n', size - pos));
+        const size_t end =
+          newline ? static_cast<size_t>(newline - data) + 1 : size;
+        if (_inMarker) {
+            _markers.append(data + pos, end - pos);
+        }
+        _lineStart = (newline != nullptr);
+        pos = end;
+    }
+}
+
+void
+DirectCache::Recorder::finish()
+{
+    recordDependencies(_markers);
+    _markers.clear();
+}
+
+StringList
+DirectCache::Recorder::files() const
+{
+    return filesFromPreprocessed(_markers);
+}
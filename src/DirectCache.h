@@ -0,0 +1,101 @@
+/*
+ * DirectCache.h
+ *
+ * Copyright (c) 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DIRECT_CACHE_H_
+#define DIRECT_CACHE_H_
+
+#include <string>
+
+#include "OutputSink.h"
+#include "StringList.h"
+
+// a native cache in front of ccache which remembers the files a lint
+// depended upon the last time it was run. As long as all of them are
+// unchanged the stored result is replayed without spawning any process
+class DirectCache
+{
+public:
+    // names the file the preprocessing stage records dependencies to
+    static const char* kEnvDependencies;
+
+    struct Result
+    {
+        std::string output;
+        std::string errorOutput;
+        std::string objectContents;
+    };
+
+    // opens the manifests stored in the given directory
+    DirectCache(const std::string& directory = defaultPath());
+
+    // true when enabled via `LINTER_CACHE_DIRECT`
+    static bool enabled();
+
+    // loads the result stored for key when all its dependencies match
+    bool lookup(const std::string& key, Result& result) const;
+
+    // stores result for key, dependencies are lines of `<digest> <path>`
+    bool store(const std::string& key,
+               const std::string& dependencies,
+               const Result& result) const;
+
+    // appends the digest of filepath to the given dependencies
+    static bool addDependency(std::string& dependencies,
+                              const std::string& filepath);
+
+    // the files named by line markers in preprocessed output
+    static StringList filesFromPreprocessed(const std::string& preprocessed);
+
+    // records all files named in preprocessed output to the file given by
+    // `kEnvDependencies`, does nothing when not set
+    static void recordDependencies(const std::string& preprocessed);
+
+    // passes preprocessed output on while keeping its line markers only,
+    // records the files named by them on finish()
+    class Recorder : public OutputSink
+    {
+    public:
+        explicit Recorder(OutputSink& next);
+
+        using OutputSink::write;
+        void write(const char* data, size_t size) override;
+        void finish();
+
+        // the files named by the line markers seen so far
+        StringList files() const;
+
+    private:
+        OutputSink& _next;
+        std::string _markers;
+        bool _lineStart;
+        bool _inMarker;
+    };
+
+    // the location used when no explicit directory is given
+    static std::string defaultPath();
+
+private:
+    std::string manifestPath(const std::string& key) const;
+
+    std::string _directory;
+};
+
+#endif // DIRECT_CACHE_H_
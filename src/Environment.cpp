@@ -24,11 +24,14 @@
 #include "config.h"
 
 #include <cstdlib>
+#include <cstring>
 #include <vector>
 #include <stdexcept>
 
 #if LINTER_CACHE_HAVE_SETENV && LINTER_CACHE_HAVE_GETENV &&                    \
   LINTER_CACHE_HAVE_UNSETENV
+extern char** environ;
+
 namespace platform {
 static void
 setenv(const char* name, const std::string& value)
@@ -51,6 +54,16 @@ getenv(const char* name)
     }
     throw std::out_of_range(name);
 }
+
+static StringList
+entries()
+{
+    StringList result;
+    for (auto** entry = environ; entry && *entry; ++entry) {
+        result.push_back(*entry);
+    }
+    return result;
+}
 }
 #elif LINTER_CACHE_HAVE_SET_ENVIRONMENT_VARIABLE &&                            \
   LINTER_CACHE_HAVE_GET_ENVIRONMENT_VARIABLE
@@ -86,15 +99,65 @@ getenv(const char* name)
     }
     return std::string(buffer.data(), stored);
 }
+
+static StringList
+entries()
+{
+    StringList result;
+    auto* block = GetEnvironmentStringsA();
+    for (auto* entry = block; entry && *entry; entry += strlen(entry) + 1) {
+        result.push_back(entry);
+    }
+    FreeEnvironmentStringsA(block);
+    return result;
+}
 }
 #else
     #error "Cannot interact with the env on this platform"
 #endif
 
+Environment::Environment(const Environment& other)
+  : _values(other._values)
+  , _unset(other._unset)
+{}
+
+Environment&
+Environment::operator=(const Environment& other)
+{
+    _values = other._values;
+    _unset = other._unset;
+    return *this;
+}
+
+void
+Environment::apply()
+{
+    for (const auto& var : _unset) {
+        remember(var);
+        platform::unsetenv(var.c_str());
+    }
+    for (const auto& var : _values) {
+        remember(var.first);
+        platform::setenv(var.first.c_str(), var.second);
+    }
+}
+
+void
+Environment::remember(const std::string& key)
+{
+    if (_applied.insert(key).second) {
+        // not modified here before, remember the original value (if any)
+        auto* original = getenv(key.c_str());
+        if (original != nullptr) {
+            _originals[key] = original;
+        }
+    }
+}
+
 void
 Environment::reset()
 {
-    for (const auto& var : _variables) {
+    for (const auto& var : _applied) {
         auto original = _originals.find(var);
         if (original == _originals.end()) {
             platform::unsetenv(var.c_str());
@@ -104,7 +167,7 @@ Environment::reset()
     }
 
     _originals.clear();
-    _variables.clear();
+    _applied.clear();
 }
 
 std::string
@@ -131,24 +194,55 @@ Environment::get(const char* key, double defaultValue)
     return std::atof(value.c_str());
 }
 
+std::string
+Environment::value(const char* key, const std::string& defaultValue) const
+{
+    auto it = _values.find(key);
+    if (it != _values.end()) {
+        return it->second;
+    }
+    if (_unset.count(key)) {
+        return defaultValue;
+    }
+    return get(key, defaultValue);
+}
+
 void
 Environment::unset(const char* key)
 {
-    set(key, std::string());
-    platform::unsetenv(key);
+    _values.erase(key);
+    _unset.insert(key);
 }
 
 void
 Environment::set(const char* key, const std::string& value)
 {
-    auto it = _variables.insert(key);
-    if (it.second) {
-        // value had not been set here before, remember original value (if any)
-        auto* original = getenv(key);
-        if (original != nullptr) {
-            _originals[key] = original;
+    _unset.erase(key);
+    _values[key] = value;
+}
+
+StringList
+Environment::merged() const
+{
+    std::map<std::string, std::string> variables;
+    for (const auto& entry : platform::entries()) {
+        // skip the hidden per-drive entries like "=C:=C:\" on Windows
+        const auto separator = entry.find('=', 1);
+        if (separator != std::string::npos) {
+            variables[entry.substr(0, separator)] = entry.substr(separator + 1);
         }
     }
+    for (const auto& var : _unset) {
+        variables.erase(var);
+    }
+    for (const auto& var : _values) {
+        variables[var.first] = var.second;
+    }
 
-    platform::setenv(key, value);
+    StringList result;
+    result.reserve(variables.size());
+    for (const auto& var : variables) {
+        result.push_back(var.first + "=" + var.second);
+    }
+    return result;
 }
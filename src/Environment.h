@@ -26,17 +26,30 @@
 #include <map>
 #include <set>
 
+#include "StringList.h"
+
+// A set of variables to pass to child processes on top of the environment
+// of the current process. The environment of the current process is only
+// modified when explicitly calling apply() and gets restored on reset()
 class Environment
 {
 public:
+    Environment() = default;
+    // copies the variables only, never any changes applied by the other
+    Environment(const Environment& other);
+    Environment& operator=(const Environment& other);
     inline ~Environment() { reset(); }
-    void reset();
 
+    // reads the environment of the current process
     static std::string get(const char* key,
                            const std::string& defaultValue = std::string());
     static int get(const char* key, int defaultValue);
     static double get(const char* key, double defaultValue);
 
+    // reads a variable of this set, falls back to the current process
+    std::string value(const char* key,
+                      const std::string& defaultValue = std::string()) const;
+
     void unset(const char* key);
     void set(const char* key, const std::string& value);
     inline void set(const char* key, int value)
@@ -48,8 +61,25 @@ public:
         set(key, std::to_string(value));
     }
 
+    // true when no variables have been set or unset
+    inline bool empty() const { return _values.empty() && _unset.empty(); }
+
+    // the environment of the current process with all variables of this
+    // set merged in, as "KEY=value" entries sorted by key
+    StringList merged() const;
+
+    // modifies the environment of the current process, e.g. for tests
+    void apply();
+    void reset();
+
 private:
-    std::set<std::string> _variables;
+    void remember(const std::string& key);
+
+    std::map<std::string, std::string> _values;
+    std::set<std::string> _unset;
+
+    // the original values of variables modified by apply()
+    std::set<std::string> _applied;
     std::map<std::string, std::string> _originals;
 };
 
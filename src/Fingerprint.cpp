@@ -0,0 +1,291 @@
+/*
+ * Fingerprint.cpp
+ *
+ * Copyright (c) 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <sstream>
+
+#include "Digest.h"
+#include "Fingerprint.h"
+#include "Logging.h"
+#include "MappedFile.h"
+#include "Util.h"
+
+const char* Fingerprint::kEnvFile = "LINTER_CACHE_FINGERPRINT_FILE";
+
+// bump the version whenever the layout changes
+static constexpr char kMagic[] = "LCFP 1";
+
+// items are stored one per line
+static std::string
+sanitize(std::string item)
+{
+    return Util::replace_all(std::move(item), "\n", "\\n");
+}
+
+void
+Fingerprint::setList(const std::string& component, const StringList& items)
+{
+    auto& list = _lists[component];
+    list.clear();
+    for (const auto& item : items) {
+        list.push_back(sanitize(item));
+    }
+}
+
+void
+Fingerprint::setFiles(const std::string& component,
+                      const StringList& paths,
+                      const Fingerprint* previous)
+{
+    const std::map<std::string, File>* known = nullptr;
+    if (previous) {
+        const auto found = previous->_files.find(component);
+        if (found != previous->_files.end()) {
+            known = &found->second;
+        }
+    }
+
+    auto& files = _files[component];
+    files.clear();
+    for (const auto& path : paths) {
+        const auto name = sanitize(path);
+        auto& file = files[name];
+        Util::FileInfo info;
+        if (!Util::file_info(path, info)) {
+            continue;
+        }
+        file.size = info.size;
+        file.mtime = info.mtime;
+        if (known) {
+            // trust unchanged files the same way ccache's direct mode does
+            const auto old = known->find(name);
+            if (old != known->end() && !old->second.digest.empty() &&
+                old->second.size == file.size &&
+                old->second.mtime == file.mtime) {
+                file.digest = old->second.digest;
+                continue;
+            }
+        }
+        Digest::file(path, file.digest);
+    }
+}
+
+void
+Fingerprint::add(const Fingerprint& other)
+{
+    // inserting keeps any existing component
+    _lists.insert(other._lists.begin(), other._lists.end());
+    _files.insert(other._files.begin(), other._files.end());
+}
+
+static void
+listDifferences(const std::string& component,
+                const StringList& previous,
+                const StringList& current,
+                StringList& out)
+{
+    if (previous == current) {
+        return;
+    }
+    // compare as multisets first, an item may be given more than once
+    auto removed = previous;
+    auto added = current;
+    std::sort(removed.begin(), removed.end());
+    std::sort(added.begin(), added.end());
+    StringList onlyPrevious;
+    StringList onlyCurrent;
+    std::set_difference(removed.begin(),
+                        removed.end(),
+                        added.begin(),
+                        added.end(),
+                        std::back_inserter(onlyPrevious));
+    std::set_difference(added.begin(),
+                        added.end(),
+                        removed.begin(),
+                        removed.end(),
+                        std::back_inserter(onlyCurrent));
+    for (const auto& item : onlyPrevious) {
+        out.push_back(component + ": removed '" + item + "'");
+    }
+    for (const auto& item : onlyCurrent) {
+        out.push_back(component + ": added '" + item + "'");
+    }
+    if (onlyPrevious.empty() && onlyCurrent.empty()) {
+        out.push_back(component + ": changed order of '" +
+                      current.join(' ') + "'");
+    }
+}
+
+static void
+fileDifferences(const std::string& component,
+                const std::map<std::string, Fingerprint::File>& previous,
+                const std::map<std::string, Fingerprint::File>& current,
+                StringList& out)
+{
+    for (const auto& file : previous) {
+        if (!current.count(file.first)) {
+            out.push_back(component + ": removed '" + file.first + "'");
+        }
+    }
+    for (const auto& file : current) {
+        const auto old = previous.find(file.first);
+        if (old == previous.end()) {
+            out.push_back(component + ": added '" + file.first + "'");
+        } else if (old->second.digest != file.second.digest ||
+                   file.second.digest.empty()) {
+            out.push_back(component + ": modified '" + file.first + "'");
+        }
+    }
+}
+
+StringList
+Fingerprint::differences(const Fingerprint& previous) const
+{
+    static const StringList kNoList;
+    static const std::map<std::string, File> kNoFiles;
+
+    StringList out;
+    for (const auto& list : _lists) {
+        const auto old = previous._lists.find(list.first);
+        listDifferences(list.first,
+                        old == previous._lists.end() ? kNoList : old->second,
+                        list.second,
+                        out);
+    }
+    for (const auto& list : previous._lists) {
+        if (!_lists.count(list.first)) {
+            listDifferences(list.first, list.second, kNoList, out);
+        }
+    }
+    for (const auto& files : _files) {
+        const auto old = previous._files.find(files.first);
+        fileDifferences(files.first,
+                        old == previous._files.end() ? kNoFiles : old->second,
+                        files.second,
+                        out);
+    }
+    for (const auto& files : previous._files) {
+        if (!_files.count(files.first)) {
+            fileDifferences(files.first, files.second, kNoFiles, out);
+        }
+    }
+    return out;
+}
+
+std::string
+Fingerprint::serialize() const
+{
+    std::ostringstream out;
+    out << kMagic << '\n';
+    for (const auto& list : _lists) {
+        for (const auto& item : list.second) {
+            out << "L " << list.first << ' ' << item << '\n';
+        }
+        if (list.second.empty()) {
+            out << "E " << list.first << '\n';
+        }
+    }
+    for (const auto& files : _files) {
+        for (const auto& file : files.second) {
+            out << "F " << files.first << ' '
+                << (file.second.digest.empty() ? "-" : file.second.digest)
+                << ' ' << file.second.size << ' ' << file.second.mtime << ' '
+                << file.first << '\n';
+        }
+        if (files.second.empty()) {
+            out << "N " << files.first << '\n';
+        }
+    }
+    return out.str();
+}
+
+bool
+Fingerprint::parse(const std::string& serialized)
+{
+    _lists.clear();
+    _files.clear();
+
+    std::istringstream in(serialized);
+    std::string line;
+    if (!std::getline(in, line) || line != kMagic) {
+        return false;
+    }
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string type;
+        std::string component;
+        if (!(fields >> type >> component)) {
+            return false;
+        }
+        if ("E" == type) {
+            _lists[component];
+        } else if ("N" == type) {
+            _files[component];
+        } else if ("L" == type) {
+            const auto prefix = type.size() + component.size() + 2;
+            _lists[component].push_back(
+              line.size() > prefix ? line.substr(prefix) : std::string());
+        } else if ("F" == type) {
+            File file;
+            if (!(fields >> file.digest >> file.size >> file.mtime)) {
+                return false;
+            }
+            if ("-" == file.digest) {
+                file.digest.clear();
+            }
+            std::string path;
+            std::getline(fields >> std::ws, path);
+            _files[component][path] = file;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool
+Fingerprint::load(const std::string& filepath)
+{
+    MappedFile file(filepath);
+    if (!file) {
+        return false;
+    }
+    if (!parse(std::string(file.data(), file.size()))) {
+        LOG(WARNING) << "Fingerprint: Ignoring malformed '" << filepath << "'";
+        return false;
+    }
+    return true;
+}
+
+bool
+Fingerprint::save(const std::string& filepath) const
+{
+    Util::make_dirs(filepath.substr(0, filepath.find_last_of("/\\")));
+    return Util::write_file_atomically(filepath, serialize());
+}
+
+std::string
+Fingerprint::pathFor(const std::string& sourcefile)
+{
+    Digest digest;
+    digest.update(Util::normalize_path(sourcefile));
+    return Util::cache_dir() + "/fingerprints/" + digest.hex() + ".txt";
+}
@@ -0,0 +1,80 @@
+/*
+ * Fingerprint.h
+ *
+ * Copyright (c) 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FINGERPRINT_H_
+#define FINGERPRINT_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include "StringList.h"
+
+// Structured description of the inputs of a lint split into components
+// like the flags, the configuration or the headers. One is stored per
+// source after every run to explain why a later run missed the cache
+class Fingerprint
+{
+public:
+    // names the file the preprocessing stage writes its components to
+    static const char* kEnvFile;
+
+    struct File
+    {
+        // empty when the file could not be read
+        std::string digest;
+        uint64_t size = 0;
+        int64_t mtime = 0;
+    };
+
+    // values compared by contents and order, e.g. flags
+    void setList(const std::string& component, const StringList& items);
+
+    // files compared by the digest of their contents, the digest found in
+    // previous gets reused as long as size and modification time match
+    void setFiles(const std::string& component,
+                  const StringList& paths,
+                  const Fingerprint* previous = nullptr);
+
+    // adds all components of other which are missing here
+    void add(const Fingerprint& other);
+
+    inline bool empty() const { return _lists.empty() && _files.empty(); }
+
+    // one line per difference to previous naming the component and the
+    // item, e.g. a single flag or header
+    StringList differences(const Fingerprint& previous) const;
+
+    std::string serialize() const;
+    bool parse(const std::string& serialized);
+
+    bool load(const std::string& filepath);
+    bool save(const std::string& filepath) const;
+
+    // the location the fingerprint of the given source is stored at
+    static std::string pathFor(const std::string& sourcefile);
+
+private:
+    std::map<std::string, StringList> _lists;
+    std::map<std::string, std::map<std::string, File>> _files;
+};
+
+#endif // FINGERPRINT_H_
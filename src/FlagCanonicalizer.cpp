@@ -0,0 +1,275 @@
+/*
+ * FlagCanonicalizer.cpp
+ *
+ * Copyright (c) 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+#include "Environment.h"
+#include "FlagCanonicalizer.h"
+
+const char* FlagCanonicalizer::kEnvDisable = "LINTER_CACHE_NO_CANONICAL_FLAGS";
+const char* FlagCanonicalizer::kEnvIgnore = "LINTER_CACHE_IGNORE_FLAGS";
+const char* FlagCanonicalizer::kEnvKeep = "LINTER_CACHE_KEEP_FLAGS";
+const char* FlagCanonicalizer::kEnvOnly = "LINTER_CACHE_ONLY_FLAGS";
+
+namespace {
+
+// flags followed by a separate argument, they get handled as one unit
+const std::set<std::string> kWithArgument = {
+    "-D",       "-U",          "-I",           "-isystem",    "-iquote",
+    "-idirafter", "-include",  "-imacros",     "-isysroot",   "-iprefix",
+    "-iwithprefix", "-F",      "-MF",          "-MT",         "-MQ",
+    "-x",       "-arch",       "-target",      "-Xclang",     "-Xpreprocessor",
+    "--param",  "-Xassembler", "-Xlinker",
+};
+
+// include paths are searched in order, any repetition is without effect
+const char* const kIncludes[] = { "-isystem", "-iquote", "-idirafter", "-I" };
+
+struct Unit
+{
+    std::string flag;
+    // empty unless given as a separate argument
+    std::string argument;
+    bool separate = false;
+};
+
+StringList
+split(const std::string& patterns)
+{
+    StringList out;
+    std::istringstream in(patterns);
+    for (std::string pattern; in >> pattern;) {
+        out.push_back(pattern);
+    }
+    return out;
+}
+
+bool
+startsWith(const std::string& string, const char* prefix)
+{
+    return 0 == string.compare(0, std::char_traits<char>::length(prefix), prefix);
+}
+
+// the macro named by a -D or -U unit, empty for any other unit
+std::string
+macroOf(const Unit& unit)
+{
+    if (!startsWith(unit.flag, "-D") && !startsWith(unit.flag, "-U")) {
+        return std::string();
+    }
+    const auto& definition =
+      unit.separate ? unit.argument : unit.flag.substr(2);
+    return definition.substr(0, definition.find('='));
+}
+
+// the include directory named by a unit as `<kind> <path>`, empty else
+std::string
+includeOf(const Unit& unit)
+{
+    for (const auto* kind : kIncludes) {
+        if (unit.separate && unit.flag == kind) {
+            return std::string(kind) + ' ' + unit.argument;
+        }
+        if (!unit.separate && startsWith(unit.flag, kind) &&
+            unit.flag.size() > std::char_traits<char>::length(kind)) {
+            return std::string(kind) + ' ' +
+                   unit.flag.substr(std::char_traits<char>::length(kind));
+        }
+    }
+    return std::string();
+}
+
+} // namespace
+
+FlagCanonicalizer::FlagCanonicalizer(const StringList& ignore,
+                                     const StringList& keep,
+                                     const StringList& only)
+  : _enabled(true)
+  , _ignore(ignore)
+  , _keep(keep)
+  , _only(only)
+{}
+
+FlagCanonicalizer
+FlagCanonicalizer::fromEnvironment()
+{
+    FlagCanonicalizer canonicalizer(
+      defaultIgnored() + split(Environment::get(kEnvIgnore)),
+      split(Environment::get(kEnvKeep)),
+      split(Environment::get(kEnvOnly)));
+    canonicalizer._enabled = !Environment::get(kEnvDisable, false);
+    return canonicalizer;
+}
+
+StringList
+FlagCanonicalizer::defaultIgnored()
+{
+    return {
+        // debug information
+        "-g", "-g0", "-g1", "-g2", "-g3", "-ggdb*", "-gdwarf*", "-gz*",
+        "-gsplit-dwarf", "-gline-tables-only", "-gcolumn-info", "-gno-*",
+        // optimization
+        "-O", "-O0", "-O1", "-O2", "-O3", "-Os", "-Oz", "-Og", "-Ofast",
+        "-fomit-frame-pointer", "-fno-omit-frame-pointer",
+        "-ffunction-sections", "-fdata-sections", "-flto*", "-fno-lto",
+        // position independence
+        "-fPIC", "-fpic", "-fPIE", "-fpie", "-fno-pic", "-fno-pie",
+        // instrumentation
+        "-fsanitize=*", "-fsanitize-*", "-fno-sanitize*", "-fprofile-*",
+        "-fcoverage-mapping", "--coverage", "-fstack-protector*",
+        "-fno-stack-protector",
+        // output and diagnostics formatting
+        "-fdiagnostics-color*", "-fno-diagnostics-color",
+        "-fcolor-diagnostics", "-fno-color-diagnostics", "-pipe",
+        // dependency files
+        "-MD", "-MMD", "-MP", "-MF*", "-MT*", "-MQ*", "-Wp,-MD,*",
+        "-Wp,-MMD,*",
+    };
+}
+
+bool
+FlagCanonicalizer::matches(const std::string& pattern, const std::string& flag)
+{
+    // iterative wildcard matching, backtracking to the last `*` only
+    size_t p = 0;
+    size_t f = 0;
+    size_t star = std::string::npos;
+    size_t resume = 0;
+    while (f < flag.size()) {
+        if (p < pattern.size() && '*' == pattern[p]) {
+            star = p++;
+            resume = f;
+        } else if (p < pattern.size() && pattern[p] == flag[f]) {
+            ++p;
+            ++f;
+        } else if (std::string::npos != star) {
+            p = star + 1;
+            f = ++resume;
+        } else {
+            return false;
+        }
+    }
+    while (p < pattern.size() && '*' == pattern[p]) {
+        ++p;
+    }
+    return p == pattern.size();
+}
+
+FlagCanonicalizer::Patterns::Patterns(const StringList& patterns)
+{
+    for (const auto& pattern : patterns) {
+        if (std::string::npos == pattern.find('*')) {
+            exact.insert(pattern);
+        } else {
+            wildcards.push_back(pattern);
+        }
+    }
+}
+
+bool
+FlagCanonicalizer::Patterns::empty() const
+{
+    return exact.empty() && wildcards.empty();
+}
+
+bool
+FlagCanonicalizer::Patterns::match(const std::string& flag) const
+{
+    return exact.count(flag) ||
+           std::any_of(wildcards.begin(),
+                       wildcards.end(),
+                       [&flag](const std::string& pattern) {
+                           return matches(pattern, flag);
+                       });
+}
+
+bool
+FlagCanonicalizer::ignored(const std::string& flag) const
+{
+    if (!_only.empty()) {
+        return !_only.match(flag);
+    }
+    return _ignore.match(flag) && !_keep.match(flag);
+}
+
+StringList
+FlagCanonicalizer::apply(const StringList& options) const
+{
+    if (!_enabled) {
+        return options;
+    }
+
+    std::vector<Unit> others;
+    std::vector<std::pair<std::string, std::string>> macros;
+    std::set<std::string> includes;
+    for (size_t i = 0; i < options.size(); ++i) {
+        Unit unit;
+        unit.flag = options[i];
+        if (kWithArgument.count(unit.flag) && i + 1 < options.size()) {
+            unit.argument = options[++i];
+            unit.separate = true;
+        }
+        if (ignored(unit.flag)) {
+            continue;
+        }
+
+        // macros get defined and undefined in order but before any of the
+        // other flags take effect, only their order per name matters
+        const auto macro = macroOf(unit);
+        if (!macro.empty()) {
+            macros.emplace_back(macro,
+                                unit.flag.substr(0, 2) +
+                                  (unit.separate ? unit.argument
+                                                 : unit.flag.substr(2)));
+            continue;
+        }
+        const auto include = includeOf(unit);
+        if (!include.empty() && !includes.insert(include).second) {
+            continue;
+        }
+        others.push_back(std::move(unit));
+    }
+
+    std::stable_sort(
+      macros.begin(), macros.end(), [](const auto& lhs, const auto& rhs) {
+          return lhs.first < rhs.first;
+      });
+
+    StringList canonical;
+    canonical.reserve(options.size());
+    for (const auto& unit : others) {
+        canonical.push_back(unit.flag);
+        if (unit.separate) {
+            canonical.push_back(unit.argument);
+        }
+    }
+    for (size_t i = 0; i < macros.size(); ++i) {
+        // a repeated identical definition is without effect
+        if (i > 0 && macros[i].second == macros[i - 1].second) {
+            continue;
+        }
+        canonical.push_back(macros[i].second);
+    }
+    return canonical;
+}
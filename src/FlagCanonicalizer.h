@@ -0,0 +1,83 @@
+/*
+ * FlagCanonicalizer.h
+ *
+ * Copyright (c) 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FLAG_CANONICALIZER_H_
+#define FLAG_CANONICALIZER_H_
+
+#include <set>
+#include <string>
+
+#include "StringList.h"
+
+// Rewrites compiler flags before they get hashed by ccache so that builds
+// differing only in flags irrelevant to the linter share their results.
+// Drops flags matching a deny-list or not matching an allow-list, removes
+// duplicate include paths and sorts the macro definitions
+class FlagCanonicalizer
+{
+public:
+    // disables canonicalization when set
+    static const char* kEnvDisable;
+    // patterns of flags to drop in addition to the defaults
+    static const char* kEnvIgnore;
+    // patterns of flags to keep although matching the deny-list
+    static const char* kEnvKeep;
+    // patterns of the only flags to keep, replaces the deny-list
+    static const char* kEnvOnly;
+
+    // patterns may use `*` as a wildcard, a flag with a separate
+    // argument like `-MF file` is matched by its first part only
+    FlagCanonicalizer(const StringList& ignore = defaultIgnored(),
+                      const StringList& keep = StringList(),
+                      const StringList& only = StringList());
+
+    // as configured via the environment, the patterns in the variables
+    // are separated by whitespace
+    static FlagCanonicalizer fromEnvironment();
+
+    // flags like -g, -O2 or -fPIC which change code generation only
+    static StringList defaultIgnored();
+
+    StringList apply(const StringList& options) const;
+
+    static bool matches(const std::string& pattern, const std::string& flag);
+
+private:
+    // most patterns have no wildcard and get looked up directly
+    struct Patterns
+    {
+        explicit Patterns(const StringList& patterns);
+        bool empty() const;
+        bool match(const std::string& flag) const;
+
+        std::set<std::string> exact;
+        StringList wildcards;
+    };
+
+    bool ignored(const std::string& flag) const;
+
+    bool _enabled;
+    Patterns _ignore;
+    Patterns _keep;
+    Patterns _only;
+};
+
+#endif // FLAG_CANONICALIZER_H_
@@ -0,0 +1,337 @@
+/*
+ * History.cpp
+ *
+ * Copyright (c) 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <set>
+#include <vector>
+
+#include "config.h"
+
+#if LINTER_CACHE_HAVE_OPEN
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+#include "Digest.h"
+#include "History.h"
+#include "Logging.h"
+#include "MappedFile.h"
+#include "Util.h"
+
+namespace {
+
+// bump whenever the layout of the records changes
+constexpr uint32_t kMagic = 0x4c434831; // "LCH1"
+constexpr size_t kPathSize = 208;
+
+struct Record
+{
+    uint32_t magic;
+    int32_t exitCode;
+    uint64_t key;
+    int64_t timestamp;
+    double seconds;
+    uint64_t peakRssKb;
+    uint8_t hit;
+    uint8_t reserved[7];
+    // the tail of the normalized path for reporting, keyed by digest
+    char path[kPathSize];
+};
+static_assert(sizeof(Record) == 256, "records need a fixed size");
+
+// once the history grows beyond this many records it gets cut down to the
+// most recent ones, keeping the latest records of older sources as well
+constexpr size_t kCompactThreshold = 32768;
+constexpr size_t kKeepRecords = kCompactThreshold / 2;
+
+uint64_t
+keyFor(const std::string& normalized)
+{
+    return std::strtoull(
+      Digest().update(normalized).hex().substr(0, 16).c_str(), nullptr, 16);
+}
+
+// a single write in append mode will not be interleaved with writes of
+// other processes recording at the same time
+bool
+append(const std::string& filepath, const Record& record)
+{
+#if LINTER_CACHE_HAVE_OPEN
+    const auto fd =
+      open(filepath.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    const bool written = sizeof(record) == write(fd, &record, sizeof(record));
+    close(fd);
+    return written;
+#else
+    auto* output = fopen(filepath.c_str(), "ab");
+    if (!output) {
+        return false;
+    }
+    const bool written = 1 == fwrite(&record, sizeof(record), 1, output);
+    return 0 == fclose(output) && written;
+#endif
+}
+
+} // namespace
+
+History::History(const std::string& filepath)
+  : _filepath(filepath)
+  , _loaded(false)
+{}
+
+std::string
+History::defaultPath()
+{
+    return Util::cache_dir() + "/history.bin";
+}
+
+void
+History::forEach(const std::function<void(const Entry&)>& visitor) const
+{
+    MappedFile file(_filepath);
+    if (!file) {
+        return;
+    }
+
+    // a record still being appended is skipped, so are foreign ones
+    const auto count = file.size() / sizeof(Record);
+    Record record;
+    Entry entry;
+    for (size_t i = 0; i < count; ++i) {
+        std::memcpy(&record, file.data() + i * sizeof(Record), sizeof(record));
+        if (kMagic != record.magic) {
+            continue;
+        }
+        entry.sourcefile.assign(record.path, strnlen(record.path, kPathSize));
+        entry.seconds = record.seconds;
+        entry.hit = (0 != record.hit);
+        entry.peakRssKb = static_cast<long>(record.peakRssKb);
+        entry.exitCode = record.exitCode;
+        entry.timestamp = record.timestamp;
+        entry.key = record.key;
+        visitor(entry);
+    }
+}
+
+void
+History::load() const
+{
+    if (_loaded) {
+        return;
+    }
+    _loaded = true;
+
+    // later records override earlier ones for the same source
+    MappedFile file(_filepath);
+    const auto count = file ? file.size() / sizeof(Record) : 0;
+    std::set<size_t> summarized;
+    std::map<uint64_t, size_t> lastRecord;
+    std::map<uint64_t, size_t> lastPeakRss;
+    Record record;
+    for (size_t i = 0; i < count; ++i) {
+        std::memcpy(&record, file.data() + i * sizeof(Record), sizeof(record));
+        if (kMagic != record.magic) {
+            continue;
+        }
+        auto& summary = _summaries[record.key];
+        summary.seconds = record.seconds;
+        lastRecord[record.key] = i;
+        if (record.peakRssKb > 0 && !record.hit) {
+            summary.peakRssKb = static_cast<long>(record.peakRssKb);
+            lastPeakRss[record.key] = i;
+        }
+    }
+    if (count <= kCompactThreshold) {
+        return;
+    }
+
+    // keep the recent records for the report and whatever the summaries
+    // were taken from, records appended meanwhile are lost just like
+    // with any other cache cleanup
+    for (const auto* indices : { &lastRecord, &lastPeakRss }) {
+        for (const auto& item : *indices) {
+            summarized.insert(item.second);
+        }
+    }
+    std::string compacted;
+    for (size_t i = 0; i < count; ++i) {
+        if (i >= count - kKeepRecords || summarized.count(i) > 0) {
+            compacted.append(file.data() + i * sizeof(Record), sizeof(Record));
+        }
+    }
+    LOG(TRACE) << "History: Compacting '" << _filepath << "' from " << count
+               << " to " << compacted.size() / sizeof(Record) << " records";
+    Util::write_file_atomically(_filepath, compacted);
+}
+
+double
+History::duration(const std::string& sourcefile) const
+{
+    load();
+
+    auto it = _summaries.find(keyFor(Util::resolve_path(sourcefile)));
+    if (it != _summaries.end()) {
+        return it->second.seconds;
+    }
+    return -1;
+}
+
+long
+History::peakRss(const std::string& sourcefile) const
+{
+    load();
+
+    auto it = _summaries.find(keyFor(Util::resolve_path(sourcefile)));
+    if (it != _summaries.end()) {
+        return it->second.peakRssKb;
+    }
+    return 0;
+}
+
+void
+History::record(const Entry& entry)
+{
+    const auto resolved = Util::resolve_path(entry.sourcefile);
+    if (resolved.empty()) {
+        return;
+    }
+    Util::make_dirs(_filepath.substr(0, _filepath.find_last_of("/\\")));
+
+    Record record;
+    std::memset(&record, 0, sizeof(record));
+    record.magic = kMagic;
+    record.exitCode = entry.exitCode;
+    record.key = keyFor(resolved);
+    record.timestamp = entry.timestamp;
+    if (0 == record.timestamp) {
+        record.timestamp =
+          std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch())
+            .count();
+    }
+    record.seconds = entry.seconds;
+    record.peakRssKb = static_cast<uint64_t>(std::max(0L, entry.peakRssKb));
+    record.hit = entry.hit ? 1 : 0;
+    // keep the end of long paths, it tells most about the source
+    const auto offset =
+      resolved.size() >= kPathSize ? resolved.size() - kPathSize + 1 : 0;
+    std::memcpy(record.path, resolved.data() + offset, resolved.size() - offset);
+
+    if (!append(_filepath, record)) {
+        LOG(WARNING) << "Failed to record history in '" << _filepath << "'";
+    }
+
+    if (_loaded) {
+        auto& summary = _summaries[record.key];
+        summary.seconds = entry.seconds;
+        if (entry.peakRssKb > 0 && !entry.hit) {
+            summary.peakRssKb = entry.peakRssKb;
+        }
+    }
+}
+
+void
+History::report(std::ostream& output, size_t top) const
+{
+    struct Source
+    {
+        std::string path;
+        size_t misses = 0;
+        double lastMiss = -1;
+    };
+
+    size_t runs = 0;
+    size_t hits = 0;
+    size_t failures = 0;
+    double spent = 0;
+    double saved = 0;
+    // the paths are truncated, only the keys tell sources apart reliably
+    std::map<uint64_t, Source> sources;
+    forEach([&](const Entry& entry) {
+        ++runs;
+        spent += entry.seconds;
+        if (0 != entry.exitCode) {
+            ++failures;
+        }
+
+        auto& source = sources[entry.key];
+        source.path = entry.sourcefile;
+        if (entry.hit) {
+            ++hits;
+            // a hit saves the time the source took when it last missed
+            if (source.lastMiss > entry.seconds) {
+                saved += source.lastMiss - entry.seconds;
+            }
+        } else {
+            ++source.misses;
+            source.lastMiss = entry.seconds;
+        }
+    });
+
+    output << "History: " << _filepath << "\n";
+    output << "Runs: " << runs << ", hits: " << hits << ", misses: "
+           << (runs - hits) << ", failures: " << failures << "\n";
+    if (0 == runs) {
+        return;
+    }
+    output << std::fixed << std::setprecision(1);
+    output << "Hit rate: " << (100.0 * hits / runs) << "%\n";
+    output << "Time spent: " << spent << "s, saved by hits: " << saved
+           << "s\n";
+
+    std::vector<const Source*> ordered;
+    for (const auto& source : sources) {
+        ordered.push_back(&source.second);
+    }
+    const auto count = std::min(top, ordered.size());
+
+    std::partial_sort(ordered.begin(),
+                      ordered.begin() + count,
+                      ordered.end(),
+                      [](const Source* lhs, const Source* rhs) {
+                          return lhs->lastMiss > rhs->lastMiss;
+                      });
+    output << "Slowest sources (last miss):\n";
+    for (size_t i = 0; i < count && ordered[i]->lastMiss >= 0; ++i) {
+        output << std::setw(10) << ordered[i]->lastMiss << "s  "
+               << ordered[i]->path << "\n";
+    }
+
+    std::partial_sort(ordered.begin(),
+                      ordered.begin() + count,
+                      ordered.end(),
+                      [](const Source* lhs, const Source* rhs) {
+                          return lhs->misses > rhs->misses;
+                      });
+    output << "Most missed sources:\n";
+    for (size_t i = 0; i < count && ordered[i]->misses > 0; ++i) {
+        output << std::setw(10) << ordered[i]->misses << "   "
+               << ordered[i]->path << "\n";
+    }
+}
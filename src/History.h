@@ -0,0 +1,89 @@
+/*
+ * History.h
+ *
+ * Copyright (c) 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HISTORY_H_
+#define HISTORY_H_
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <ostream>
+#include <string>
+
+// Append-only store of every linted source with its runtime, outcome and
+// memory use. Entries are fixed size records appended by a single write so
+// that concurrent processes never interleave, readers map the whole file
+class History
+{
+public:
+    struct Entry
+    {
+        // the source as given, normalized when recorded
+        std::string sourcefile;
+        double seconds = 0;
+        bool hit = false;
+        long peakRssKb = 0;
+        int exitCode = 0;
+        // seconds since the epoch, set when recorded
+        int64_t timestamp = 0;
+        // identifies the source even when the path above got truncated,
+        // set when recorded
+        uint64_t key = 0;
+    };
+
+    // opens the history stored at the given filepath
+    History(const std::string& filepath = defaultPath());
+
+    // the runtime in seconds last observed for the given source
+    // or a negative value when the source was never seen before
+    double duration(const std::string& sourcefile) const;
+
+    // the peak memory last observed when actually linting the source,
+    // zero when not known
+    long peakRss(const std::string& sourcefile) const;
+
+    // appends an entry for the source
+    void record(const Entry& entry);
+
+    // visits all entries in the order they were recorded
+    void forEach(const std::function<void(const Entry&)>& visitor) const;
+
+    // prints hit rate, time saved and the slowest and most missed sources
+    void report(std::ostream& output, size_t top = 10) const;
+
+    // the location used when no explicit filepath is given
+    static std::string defaultPath();
+
+private:
+    struct Summary
+    {
+        double seconds = -1;
+        long peakRssKb = 0;
+    };
+
+    void load() const;
+
+    std::string _filepath;
+    mutable bool _loaded;
+    mutable std::map<uint64_t, Summary> _summaries;
+};
+
+#endif // HISTORY_H_
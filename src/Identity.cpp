@@ -0,0 +1,90 @@
+/*
+ * Identity.cpp
+ *
+ * Copyright (c) 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Digest.h"
+#include "Identity.h"
+#include "Logging.h"
+#include "NamedFile.h"
+#include "Subprocess.h"
+#include "Util.h"
+
+static constexpr char kVersion[] = "version\n";
+
+Identity::Identity(const std::string& directory)
+  : _directory(directory)
+{}
+
+std::string
+Identity::defaultPath()
+{
+    return Util::cache_dir() + "/identity";
+}
+
+std::string
+Identity::fileFor(const std::string& executable, bool withVersion) const
+{
+    const auto found = Util::find_program(executable);
+    const auto resolved = found.empty() ? found : Util::resolve_path(found);
+    Util::FileInfo info;
+    if (resolved.empty() || !Util::file_info(resolved, info)) {
+        return std::string();
+    }
+
+    // the name only depends on the path so that the contents change
+    // whenever the executable does
+    const auto filepath =
+      _directory + "/" + Digest().update(resolved).hex() + ".txt";
+    auto identity = "path " + resolved + "\n" +
+                    "size " + std::to_string(info.size) + "\n" +
+                    "mtime " + std::to_string(info.mtime) + "\n" +
+                    "inode " + std::to_string(info.inode) + "\n" +
+                    "device " + std::to_string(info.device) + "\n";
+    if (withVersion) {
+        identity += kVersion;
+    }
+
+    const auto existing = NamedFile(filepath).readText();
+    if (0 == existing.compare(0, identity.size(), identity) &&
+        (withVersion || existing.size() == identity.size())) {
+        return filepath;
+    }
+
+    if (withVersion) {
+        Process proc({ resolved, "--version" },
+                     Process::CAPTURE_STDOUT | Process::CAPTURE_STDERR);
+        try {
+            proc.run();
+            identity += proc.output();
+        } catch (ProcessError& error) {
+            LOG(WARNING) << "Failed to query the version of '" << resolved
+                         << "': " << error.exitCode();
+        }
+    }
+
+    LOG(TRACE) << "Identity: Updating '" << filepath << "' for '" << resolved
+               << "'";
+    Util::make_dirs(_directory);
+    if (!Util::write_file_atomically(filepath, identity)) {
+        LOG(WARNING) << "Failed to write identity of '" << resolved << "'";
+        return std::string();
+    }
+    return filepath;
+}
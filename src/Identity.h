@@ -0,0 +1,48 @@
+/*
+ * Identity.h
+ *
+ * Copyright (c) 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef IDENTITY_H_
+#define IDENTITY_H_
+
+#include <string>
+
+// small files standing in for executables when hashing, an identity changes
+// whenever its executable gets replaced but is much cheaper to hash
+class Identity
+{
+public:
+    // keeps the identity files in the given directory
+    Identity(const std::string& directory = defaultPath());
+
+    // returns the identity file of the given executable, creating or
+    // updating it when the executable changed. Optionally the output
+    // of `<executable> --version` is included. Returns an empty string
+    // when the executable cannot be found
+    std::string fileFor(const std::string& executable, bool withVersion) const;
+
+    // the location used when no explicit directory is given
+    static std::string defaultPath();
+
+private:
+    std::string _directory;
+};
+
+#endif // IDENTITY_H_
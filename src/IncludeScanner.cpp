@@ -0,0 +1,414 @@
+/*
+ * IncludeScanner.cpp
+ *
+ * Copyright (c) 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include "Digest.h"
+#include "IncludeScanner.h"
+#include "Logging.h"
+#include "MappedFile.h"
+#include "Util.h"
+
+namespace {
+
+struct FileKey
+{
+    uint64_t inode;
+    uint64_t device;
+    uint64_t size;
+    int64_t mtime;
+
+    bool operator==(const FileKey& other) const
+    {
+        return inode == other.inode && device == other.device &&
+               size == other.size && mtime == other.mtime;
+    }
+};
+
+struct FileKeyHash
+{
+    size_t operator()(const FileKey& key) const
+    {
+        return std::hash<uint64_t>()(key.inode ^ (key.device << 32)) ^
+               std::hash<int64_t>()(key.mtime) ^
+               std::hash<uint64_t>()(key.size << 1);
+    }
+};
+
+inline bool
+isSpace(char c)
+{
+    return c == ' ' || c == '\t';
+}
+
+std::string
+directoryOf(const std::string& filepath)
+{
+    const auto slash = filepath.find_last_of("/\\");
+    return std::string::npos == slash ? "." : filepath.substr(0, slash);
+}
+
+bool
+isAbsolute(const std::string& path)
+{
+    return (!path.empty() && ('/' == path.front() || '\\' == path.front())) ||
+           (path.size() > 1 && ':' == path[1]);
+}
+
+} // namespace
+
+// the results of scanning a single file
+struct IncludeScanner::Scanned
+{
+    std::string digest;
+    std::vector<Include> includes;
+    bool computed = false;
+};
+
+
+IncludeScanner::IncludeScanner(const StringList& options, size_t concurrency)
+  : _concurrency(concurrency)
+{
+    if (0 == _concurrency) {
+        _concurrency = std::max(1U, std::thread::hardware_concurrency());
+    }
+
+    // quoted includes search the quote dirs first and the angled ones
+    // afterwards, order as documented for gcc and clang
+    StringList angled;
+    StringList system;
+    StringList after;
+    const std::vector<std::pair<std::string, StringList*>> prefixes = {
+        { "-iquote", &_quoteDirs }, { "-isystem", &system },
+        { "-idirafter", &after },   { "-include", &_forcedIncludes },
+        { "-I", &angled },          { "/I", &angled },
+        { "/FI", &_forcedIncludes }
+    };
+    for (size_t i = 0; i < options.size(); ++i) {
+        const auto& option = options[i];
+        for (const auto& prefix : prefixes) {
+            if (0 != option.compare(0, prefix.first.size(), prefix.first)) {
+                continue;
+            }
+            auto value = option.substr(prefix.first.size());
+            if (value.empty() && i + 1 < options.size()) {
+                value = options[++i];
+            }
+            if (!value.empty() && value != "-") {
+                prefix.second->push_back(value);
+            }
+            break;
+        }
+    }
+    _angledDirs = angled;
+    _angledDirs.insert(_angledDirs.end(), system.begin(), system.end());
+    _angledDirs.insert(_angledDirs.end(), after.begin(), after.end());
+}
+
+bool
+IncludeScanner::parseIncludes(const char* data,
+                              size_t size,
+                              std::vector<Include>& includes)
+{
+    static constexpr const char* kDirectives[] = { "include_next",
+                                                   "include",
+                                                   "import" };
+    size_t pos = 0;
+    while (pos < size) {
+        const auto* newline =
+          static_cast<const char*>(std::memchr(data + pos, '\n', size - pos));
+        const size_t end = newline ? static_cast<size_t>(newline - data) : size;
+        size_t i = pos;
+        pos = end + 1;
+
+        while (i < end && isSpace(data[i])) {
+            ++i;
+        }
+        if (i == end || data[i] != '#') {
+            continue;
+        }
+        ++i;
+        while (i < end && isSpace(data[i])) {
+            ++i;
+        }
+        const char* matched = nullptr;
+        for (const auto* directive : kDirectives) {
+            const auto length = std::strlen(directive);
+            if (end - i >= length && 0 == std::memcmp(data + i, directive, length)) {
+                i += length;
+                matched = directive;
+                break;
+            }
+        }
+        if (!matched) {
+            continue;
+        }
+        while (i < end && isSpace(data[i])) {
+            ++i;
+        }
+        if (i == end) {
+            continue;
+        }
+
+        Include include;
+        include.next = (matched == kDirectives[0]);
+        char terminator = 0;
+        if ('"' == data[i]) {
+            terminator = '"';
+        } else if ('<' == data[i]) {
+            terminator = '>';
+            include.angled = true;
+        } else {
+            // the included file is given by a macro
+            return false;
+        }
+        const auto* close = static_cast<const char*>(
+          std::memchr(data + i + 1, terminator, end - i - 1));
+        if (!close) {
+            continue;
+        }
+        include.name.assign(data + i + 1, close);
+        includes.push_back(std::move(include));
+    }
+    return true;
+}
+
+bool
+IncludeScanner::scanFile(const std::string& filepath, Scanned& scanned)
+{
+    Util::FileInfo info;
+    if (!Util::file_info(filepath, info)) {
+        return false;
+    }
+    // files get memoized by identity for as long as the process is running
+    static std::mutex s_memoMutex;
+    static std::unordered_map<FileKey, Scanned, FileKeyHash> s_memo;
+
+    const FileKey key = { info.inode, info.device, info.size, info.mtime };
+    {
+        std::lock_guard<std::mutex> lock(s_memoMutex);
+        auto it = s_memo.find(key);
+        if (it != s_memo.end()) {
+            scanned = it->second;
+            return true;
+        }
+    }
+
+    // headers are small, reading them is cheaper than mapping
+    std::string contents;
+    auto* input = fopen(filepath.c_str(), "rb");
+    if (!input) {
+        return false;
+    }
+    contents.resize(info.size);
+    const auto read = fread(&contents[0], 1, contents.size(), input);
+    fclose(input);
+    if (read != contents.size()) {
+        return false;
+    }
+    scanned.digest = Digest().update(contents.data(), contents.size()).hex();
+    scanned.computed =
+      !parseIncludes(contents.data(), contents.size(), scanned.includes);
+
+    std::lock_guard<std::mutex> lock(s_memoMutex);
+    s_memo.emplace(key, scanned);
+    return true;
+}
+
+std::string
+IncludeScanner::resolve(const std::string& includer,
+                        const Include& include) const
+{
+    if (isAbsolute(include.name)) {
+        return Util::is_file(include.name) ? include.name : std::string();
+    }
+
+    auto probe = [&](const std::string& dir) {
+        const auto candidate = Util::normalize_path(dir + "/" + include.name);
+        return Util::is_file(candidate) ? candidate : std::string();
+    };
+    if (include.next) {
+        // continue after the directory holding the includer, preferring
+        // the one it is found in under the same name as in wrapper headers
+        StringList chain = _quoteDirs;
+        chain.insert(chain.end(), _angledDirs.begin(), _angledDirs.end());
+        size_t start = 0;
+        size_t longest = 0;
+        for (size_t i = 0; i < chain.size(); ++i) {
+            const auto dir = Util::normalize_path(chain[i]);
+            if (Util::normalize_path(dir + "/" + include.name) == includer) {
+                start = i + 1;
+                break;
+            }
+            const bool within =
+              includer.size() > dir.size() &&
+              0 == includer.compare(0, dir.size(), dir) &&
+              ('/' == includer[dir.size()] || '\\' == includer[dir.size()]);
+            if (within && dir.size() > longest) {
+                longest = dir.size();
+                start = i + 1;
+            }
+        }
+        // like the compilers a source using it gets a regular include
+        if (0 == start) {
+            Include regular = include;
+            regular.next = false;
+            return resolve(includer, regular);
+        }
+        for (auto i = start; i < chain.size(); ++i) {
+            auto found = probe(chain[i]);
+            if (!found.empty()) {
+                return found;
+            }
+        }
+        return std::string();
+    }
+    if (!include.angled) {
+        auto found = probe(directoryOf(includer));
+        for (auto it = _quoteDirs.begin(); found.empty() && it != _quoteDirs.end();
+             ++it) {
+            found = probe(*it);
+        }
+        if (!found.empty()) {
+            return found;
+        }
+    }
+    for (const auto& dir : _angledDirs) {
+        auto found = probe(dir);
+        if (!found.empty()) {
+            return found;
+        }
+    }
+    return std::string();
+}
+
+bool
+IncludeScanner::scan(const std::string& sourcefile)
+{
+    _headers.clear();
+    _missing.clear();
+
+    const auto source = Util::normalize_path(sourcefile);
+
+    // forced includes get searched in the working directory first
+    // and behave as if included by the source otherwise
+    std::vector<Include> forced;
+    for (const auto& name : _forcedIncludes) {
+        if (Util::is_file(name)) {
+            forced.push_back({ Util::normalize_path(name), false });
+        } else {
+            forced.push_back({ name, false });
+        }
+    }
+
+    // the files of one level get scanned in parallel, their includes
+    // will be resolved and form the next level
+    struct Work
+    {
+        std::string file;
+        Scanned scanned;
+        bool ok = false;
+        std::vector<std::pair<const Include*, std::string>> found;
+    };
+    // angled includes resolve the same for all files and quoted ones
+    // the same for all files in a directory, also share misses
+    std::mutex resolvedMutex;
+    std::unordered_map<std::string, std::string> resolved;
+    auto resolveOnce = [&](const std::string& file, const Include& include) {
+        auto key = include.next     ? file + "\n"
+                   : include.angled ? "<"
+                                    : directoryOf(file) + "\"";
+        key += include.name;
+        {
+            std::lock_guard<std::mutex> lock(resolvedMutex);
+            auto it = resolved.find(key);
+            if (it != resolved.end()) {
+                return it->second;
+            }
+        }
+        auto path = resolve(file, include);
+        std::lock_guard<std::mutex> lock(resolvedMutex);
+        resolved.emplace(std::move(key), path);
+        return path;
+    };
+
+    std::vector<Work> level(1);
+    level.front().file = source;
+    std::set<std::string> visited = { source };
+
+    while (!level.empty()) {
+        std::atomic<size_t> next(0);
+        auto worker = [&] {
+            for (auto i = next++; i < level.size(); i = next++) {
+                auto& work = level[i];
+                work.ok = scanFile(work.file, work.scanned) &&
+                          !work.scanned.computed;
+                if (!work.ok) {
+                    continue;
+                }
+                auto& includes = work.scanned.includes;
+                if (work.file == source) {
+                    includes.insert(includes.begin(), forced.begin(), forced.end());
+                }
+                for (const auto& include : includes) {
+                    work.found.emplace_back(&include,
+                                            resolveOnce(work.file, include));
+                }
+            }
+        };
+        std::vector<std::thread> threads;
+        const auto count = std::min(_concurrency, level.size());
+        for (size_t i = 1; i < count; ++i) {
+            threads.emplace_back(worker);
+        }
+        worker();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        std::vector<Work> following;
+        for (const auto& work : level) {
+            if (!work.ok) {
+                LOG(TRACE) << "IncludeScanner: Cannot scan '" << work.file
+                           << "'";
+                return false;
+            }
+            if (work.file != source) {
+                _headers[work.file] = work.scanned.digest;
+            }
+            for (const auto& item : work.found) {
+                if (item.second.empty()) {
+                    _missing.insert(item.first->name);
+                } else if (visited.insert(item.second).second) {
+                    following.emplace_back();
+                    following.back().file = item.second;
+                }
+            }
+        }
+        level = std::move(following);
+    }
+    return true;
+}
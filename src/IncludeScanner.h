@@ -0,0 +1,91 @@
+/*
+ * IncludeScanner.h
+ *
+ * Copyright (c) 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INCLUDE_SCANNER_H_
+#define INCLUDE_SCANNER_H_
+
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "StringList.h"
+
+// resolves the headers included by a source similar to a dependency scanner
+// without running the preprocessor. Conditional compilation is ignored so
+// the result is a superset of the headers actually included
+class IncludeScanner
+{
+public:
+    // uses the include paths given by the compiler options, a concurrency
+    // of zero will use the number of available cores to scan headers
+    explicit IncludeScanner(const StringList& options, size_t concurrency = 0);
+
+    // scans the given source and all headers it includes, returns false
+    // when the includes cannot be resolved statically, i.e. for macros
+    bool scan(const std::string& sourcefile);
+
+    // the digests of all headers which were found, sorted by path
+    inline const std::map<std::string, std::string>& headers() const
+    {
+        return _headers;
+    }
+
+    // the names of all includes which were not found in any include path,
+    // these are usually headers provided by the compiler itself
+    inline const std::set<std::string>& missing() const { return _missing; }
+
+    // the directories searched for quoted and angled includes
+    inline const StringList& quoteDirs() const { return _quoteDirs; }
+    inline const StringList& angledDirs() const { return _angledDirs; }
+
+    // a single include directive as found in a file
+    struct Include
+    {
+        std::string name;
+        bool angled = false;
+        // `#include_next` searches the directories after the one the
+        // including file was found in only
+        bool next = false;
+    };
+
+    // extracts all include directives, returns false on computed includes
+    static bool parseIncludes(const char* data,
+                              size_t size,
+                              std::vector<Include>& includes);
+
+private:
+    struct Scanned;
+    static bool scanFile(const std::string& filepath, Scanned& scanned);
+
+    std::string resolve(const std::string& includer,
+                        const Include& include) const;
+
+    size_t _concurrency;
+    StringList _quoteDirs;
+    StringList _angledDirs;
+    StringList _forcedIncludes;
+    std::map<std::string, std::string> _headers;
+    std::set<std::string> _missing;
+};
+
+#endif // INCLUDE_SCANNER_H_
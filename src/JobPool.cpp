@@ -0,0 +1,226 @@
+/*
+ * JobPool.cpp
+ *
+ * Copyright (c) 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <memory>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <thread>
+
+#include "JobPool.h"
+#include "Jobserver.h"
+#include "Logging.h"
+#include "ProcessReactor.h"
+
+JobPool::JobPool(size_t concurrency)
+  : _concurrency(concurrency)
+{
+    if (0 == _concurrency) {
+        _concurrency = std::max(1U, std::thread::hardware_concurrency());
+    }
+}
+
+void
+JobPool::add(const std::string& name, double expectedDuration, Function job)
+{
+    _jobs.push_back({ name, expectedDuration, std::move(job), StringList() });
+}
+
+void
+JobPool::add(const std::string& name,
+             double expectedDuration,
+             const StringList& command)
+{
+    _jobs.push_back({ name, expectedDuration, nullptr, command });
+}
+
+static JobPool::Result
+resultOf(const Process& process)
+{
+    LOG(INFO) << "JobPool: Job exited with " << process.exitCode() << ", "
+              << process.usage();
+    JobPool::Result result;
+    if (0 != process.exitCode()) {
+        result.exitCode = process.exitCode() > 0 ? process.exitCode() : 1;
+    }
+    result.output = process.output();
+    result.errorOutput = process.errorOutput();
+    return result;
+}
+
+static constexpr int kTokenPollMs = 50;
+static constexpr int kCaptureAll =
+  Process::CAPTURE_STDOUT | Process::CAPTURE_STDERR;
+
+int
+JobPool::run(std::ostream& output, std::ostream& errorOutput)
+{
+    _results.clear();
+    _results.resize(_jobs.size());
+
+    // jobs never seen before could be just as long as the longest
+    // known one so have them start together with the longest ones
+    double longest = 0;
+    for (const auto& job : _jobs) {
+        longest = std::max(longest, job.expectedDuration);
+    }
+    std::vector<size_t> order(_jobs.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) {
+        auto expected = [&](size_t idx) {
+            const auto duration = _jobs[idx].expectedDuration;
+            return duration < 0 ? longest : duration;
+        };
+        return expected(lhs) > expected(rhs);
+    });
+
+    const bool commandsOnly =
+      std::all_of(_jobs.begin(), _jobs.end(), [](const Job& job) {
+          return !job.function;
+      });
+    if (commandsOnly) {
+        runCommands(order, output, errorOutput);
+    } else {
+        runThreads(order, output, errorOutput);
+    }
+    _jobs.clear();
+
+    for (const auto& result : _results) {
+        if (0 != result.exitCode) {
+            return result.exitCode;
+        }
+    }
+    return 0;
+}
+
+void
+JobPool::report(const Job& job,
+                const Result& result,
+                std::ostream& output,
+                std::ostream& errorOutput) const
+{
+    if (0 != result.exitCode) {
+        LOG(TRACE) << "JobPool: '" << job.name << "' failed with "
+                   << result.exitCode;
+    }
+    output << result.output << std::flush;
+    errorOutput << result.errorOutput << std::flush;
+}
+
+void
+JobPool::runThreads(const std::vector<size_t>& order,
+                    std::ostream& output,
+                    std::ostream& errorOutput)
+{
+    std::atomic<size_t> next{ 0 };
+    std::mutex outputMutex;
+    auto worker = [&] {
+        for (auto idx = next++; idx < order.size(); idx = next++) {
+            const auto& job = _jobs[order[idx]];
+            auto& result = _results[order[idx]];
+            try {
+                if (job.function) {
+                    result = job.function();
+                } else {
+                    Process process(job.command, kCaptureAll);
+                    try {
+                        process.run();
+                    } catch (ProcessError&) {
+                        // reported via the exit code
+                    }
+                    result = resultOf(process);
+                }
+            } catch (std::exception& e) {
+                result.exitCode = 1;
+                result.errorOutput += e.what();
+                result.errorOutput += "\n";
+            }
+
+            std::lock_guard<std::mutex> lock(outputMutex);
+            report(job, result, output, errorOutput);
+        }
+    };
+
+    const auto workers = std::min(_concurrency, _jobs.size());
+    LOG(TRACE) << "JobPool: Running " << _jobs.size() << " jobs on "
+               << workers << " workers";
+    std::vector<std::thread> threads;
+    threads.reserve(workers);
+    for (size_t i = 1; i < workers; ++i) {
+        threads.emplace_back(worker);
+    }
+    // the calling thread takes part as well
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+void
+JobPool::runCommands(const std::vector<size_t>& order,
+                     std::ostream& output,
+                     std::ostream& errorOutput)
+{
+    LOG(TRACE) << "JobPool: Supervising " << _jobs.size()
+               << " commands, at most " << _concurrency << " at once";
+    // the first command runs within the slot of this process, every other
+    // one needs a token when make announced a jobserver
+    Jobserver jobserver;
+    std::map<size_t, Jobserver::Token> tokens;
+
+    ProcessReactor reactor;
+    size_t next = 0;
+    while (next < order.size() || reactor.running() > 0) {
+        bool waitingForToken = false;
+        while (next < order.size() && reactor.running() < _concurrency) {
+            Jobserver::Token token;
+            if (jobserver.external() && reactor.running() > 0) {
+                token = jobserver.tryAcquire();
+                if (!token) {
+                    waitingForToken = true;
+                    break;
+                }
+            }
+
+            const auto idx = order[next++];
+            const auto& job = _jobs[idx];
+            tokens[idx] = std::move(token);
+            try {
+                reactor.start(
+                  std::make_unique<Process>(job.command, kCaptureAll),
+                  [&, idx](Process& process) {
+                      tokens.erase(idx);
+                      _results[idx] = resultOf(process);
+                      report(_jobs[idx], _results[idx], output, errorOutput);
+                  });
+            } catch (std::exception& e) {
+                tokens.erase(idx);
+                _results[idx].exitCode = 1;
+                _results[idx].errorOutput = std::string(e.what()) + "\n";
+                report(job, _results[idx], output, errorOutput);
+            }
+        }
+        // tokens returned by others do not wake up the reactor
+        reactor.dispatch(waitingForToken ? kTokenPollMs : -1);
+    }
+}
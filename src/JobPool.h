@@ -0,0 +1,92 @@
+/*
+ * JobPool.h
+ *
+ * Copyright (c) 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef JOB_POOL_H_
+#define JOB_POOL_H_
+
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "StringList.h"
+
+class JobPool
+{
+public:
+    struct Result
+    {
+        int exitCode = 0;
+        std::string output;
+        std::string errorOutput;
+    };
+    using Function = std::function<Result()>;
+
+    // creates a pool running at most the given number of jobs at once,
+    // a concurrency of zero will use the number of available cores
+    explicit JobPool(size_t concurrency);
+
+    inline size_t concurrency() const { return _concurrency; }
+
+    // queues a job, jobs with a longer expected duration get started first
+    // and a negative duration marks a job without any known duration
+    void add(const std::string& name, double expectedDuration, Function job);
+
+    // queues a command to run with its output captured, as long as only
+    // commands were queued the calling thread supervises all of them
+    void add(const std::string& name,
+             double expectedDuration,
+             const StringList& command);
+
+    // runs all queued jobs and writes the output of each job in one piece
+    // as soon as it completes. Returns the first non-zero exit code in
+    // the order the jobs were added or zero when all jobs succeeded
+    int run(std::ostream& output, std::ostream& errorOutput);
+
+    // the results of all jobs in the order they were added
+    inline const std::vector<Result>& results() const { return _results; }
+
+private:
+    struct Job
+    {
+        std::string name;
+        double expectedDuration;
+        Function function;
+        StringList command;
+    };
+
+    void runThreads(const std::vector<size_t>& order,
+                    std::ostream& output,
+                    std::ostream& errorOutput);
+    void runCommands(const std::vector<size_t>& order,
+                     std::ostream& output,
+                     std::ostream& errorOutput);
+    void report(const Job& job,
+                const Result& result,
+                std::ostream& output,
+                std::ostream& errorOutput) const;
+
+    size_t _concurrency;
+    std::vector<Job> _jobs;
+    std::vector<Result> _results;
+};
+
+#endif // JOB_POOL_H_
@@ -0,0 +1,311 @@
+/*
+ * Jobserver.cpp
+ *
+ * Copyright (c) 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include "config.h"
+
+#if LINTER_CACHE_HAVE_POLL
+    #include <fcntl.h>
+    #include <poll.h>
+    #include <unistd.h>
+#endif
+#if LINTER_CACHE_HAVE_FLOCK
+    #include <fcntl.h>
+    #include <sys/file.h>
+    #include <unistd.h>
+#endif
+
+#include "Jobserver.h"
+#include "Logging.h"
+#include "StringList.h"
+#include "Util.h"
+
+const char* Jobserver::kEnvSlots = "LINTER_CACHE_SLOTS";
+const char* Jobserver::kEnvHeld = "LINTER_CACHE_SLOT_HELD";
+
+// the value of the last --jobserver-auth (or the older --jobserver-fds)
+// option in MAKEFLAGS, later ones override earlier ones
+static std::string
+jobserver_auth(const std::string& makeflags)
+{
+    static constexpr const char* kOptions[] = { "--jobserver-auth=",
+                                                "--jobserver-fds=" };
+
+    std::string auth;
+    for (const auto& flag : StringList::split(makeflags, ' ')) {
+        for (const auto* option : kOptions) {
+            const auto length = strlen(option);
+            if (0 == flag.compare(0, length, option)) {
+                auth = flag.substr(length);
+            }
+        }
+    }
+    return auth;
+}
+
+#if LINTER_CACHE_HAVE_POLL
+
+static bool
+valid_fd(int fd)
+{
+    return fd >= 0 && fcntl(fd, F_GETFD) >= 0;
+}
+
+// opens the pipe behind an inherited descriptor once more, the result
+// can be made non-blocking without affecting anyone else sharing the
+// original one. Negative where there is no /proc to do so
+static int
+reopen_nonblocking(int fd)
+{
+    const auto path = "/proc/self/fd/" + std::to_string(fd);
+    return open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+}
+
+// waits for the descriptor to become readable, tries once when not waiting
+// which needs a non-blocking descriptor as others may take the token first
+static bool
+read_token(int fd, bool wait, char& token)
+{
+    while (true) {
+        struct pollfd entry;
+        entry.fd = fd;
+        entry.events = POLLIN;
+        entry.revents = 0;
+        const auto ready = poll(&entry, 1, wait ? -1 : 0);
+        if (ready < 0 && EINTR == errno) {
+            continue;
+        }
+        if (ready <= 0) {
+            return false;
+        }
+        // others may have taken the token meanwhile
+        const auto actual = read(fd, &token, 1);
+        if (1 == actual) {
+            return true;
+        }
+        if (actual < 0 && (EINTR == errno || EAGAIN == errno)) {
+            if (!wait) {
+                return false;
+            }
+            continue;
+        }
+        LOG(WARNING) << "Jobserver: Failed to read token: " << strerror(errno);
+        return false;
+    }
+}
+
+#endif
+
+Jobserver::Token::Token(Token&& other) noexcept
+  : _fd(other._fd)
+  , _token(other._token)
+  , _slot(other._slot)
+{
+    other._fd = -1;
+}
+
+Jobserver::Token&
+Jobserver::Token::operator=(Token&& other) noexcept
+{
+    if (this != &other) {
+        release();
+        _fd = other._fd;
+        _token = other._token;
+        _slot = other._slot;
+        other._fd = -1;
+    }
+    return *this;
+}
+
+Jobserver::Token::~Token()
+{
+    release();
+}
+
+void
+Jobserver::Token::release()
+{
+    if (_fd < 0) {
+        return;
+    }
+#if LINTER_CACHE_HAVE_FLOCK
+    if (_slot) {
+        // closing drops the lock
+        close(_fd);
+        _fd = -1;
+        return;
+    }
+#endif
+#if LINTER_CACHE_HAVE_POLL
+    // the token needs to go back even when it took a while
+    while (write(_fd, &_token, 1) < 0 && EINTR == errno) {
+    }
+#endif
+    _fd = -1;
+}
+
+Jobserver::Jobserver(const Environment& env)
+  : _held(!env.value(kEnvHeld).empty())
+  , _readFd(-1)
+  , _writeFd(-1)
+  , _ownsFds(false)
+  , _nonBlocking(false)
+  , _slots(0)
+{
+    const auto auth = jobserver_auth(env.value("MAKEFLAGS"));
+#if LINTER_CACHE_HAVE_POLL
+    static constexpr char kFifo[] = "fifo:";
+    if (0 == auth.compare(0, sizeof(kFifo) - 1, kFifo)) {
+        // make >= 4.4 passes a named pipe, open it on our own so that it
+        // can be used without blocking unlike the descriptors of others
+        const auto path = auth.substr(sizeof(kFifo) - 1);
+        _readFd = open(path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+        if (_readFd < 0) {
+            LOG(WARNING) << "Jobserver: Failed to open '" << path
+                         << "': " << strerror(errno);
+        }
+        _writeFd = _readFd;
+        _ownsFds = true;
+        _nonBlocking = true;
+    } else if (!auth.empty()) {
+        // make < 4.4 passes an inherited pipe, recipes not marked by a
+        // '+' get it closed though
+        const auto comma = auth.find(',');
+        if (comma != std::string::npos) {
+            const auto readFd = std::atoi(auth.c_str());
+            const auto writeFd = std::atoi(auth.c_str() + comma + 1);
+            if (valid_fd(readFd) && valid_fd(writeFd)) {
+                // the pipe is blocking and shared with sibling jobs, a
+                // token seen by poll() may be gone by the time of read()
+                _readFd = reopen_nonblocking(readFd);
+                _ownsFds = _nonBlocking = (_readFd >= 0);
+                if (!_nonBlocking) {
+                    LOG(TRACE) << "Jobserver: Only taking tokens blocking";
+                    _readFd = readFd;
+                }
+                _writeFd = writeFd;
+            } else {
+                LOG(TRACE) << "Jobserver: Descriptors '" << auth
+                           << "' not inherited";
+            }
+        }
+    }
+#endif
+    if (external()) {
+        LOG(TRACE) << "Jobserver: Using '" << auth << "'";
+        return;
+    }
+
+#if LINTER_CACHE_HAVE_FLOCK
+    const auto cores = std::max(1u, std::thread::hardware_concurrency());
+    _slots = static_cast<unsigned>(std::max(
+      0, std::atoi(env.value(kEnvSlots, std::to_string(cores)).c_str())));
+    const auto runtimeDir = env.value("XDG_RUNTIME_DIR");
+    _slotDir = runtimeDir.empty() ? Util::cache_dir() + "/slots"
+                                  : runtimeDir + "/linter-cache";
+#endif
+}
+
+Jobserver::~Jobserver()
+{
+#if LINTER_CACHE_HAVE_POLL
+    if (_ownsFds && _readFd >= 0) {
+        close(_readFd);
+    }
+#endif
+}
+
+Jobserver::Token
+Jobserver::acquire()
+{
+    return take(true);
+}
+
+Jobserver::Token
+Jobserver::tryAcquire()
+{
+    return take(false);
+}
+
+Jobserver::Token
+Jobserver::take(bool wait)
+{
+    Token token;
+    if (_held) {
+        return token;
+    }
+#if LINTER_CACHE_HAVE_POLL
+    if (external()) {
+        if ((wait || _nonBlocking) &&
+            read_token(_readFd, wait, token._token)) {
+            token._fd = _writeFd;
+        }
+        return token;
+    }
+#endif
+    return lockSlot(wait);
+}
+
+Jobserver::Token
+Jobserver::lockSlot(bool wait)
+{
+    Token token;
+#if LINTER_CACHE_HAVE_FLOCK
+    if (0 == _slots || !Util::make_dirs(_slotDir)) {
+        return token;
+    }
+
+    // spread the processes so that waiting ones queue on different slots
+    const auto first = static_cast<unsigned>(Util::process_id() % _slots);
+    for (unsigned i = 0; i < _slots; ++i) {
+        const auto slot = (first + i) % _slots;
+        const auto path = _slotDir + "/slot-" + std::to_string(slot);
+        const auto fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            LOG(WARNING) << "Jobserver: Failed to open '" << path
+                         << "': " << strerror(errno);
+            return token;
+        }
+
+        // all slots are taken, queue on the last one tried
+        const bool last = (i + 1 == _slots);
+        int result = -1;
+        do {
+            result = flock(fd, (wait && last) ? LOCK_EX : LOCK_EX | LOCK_NB);
+        } while (result < 0 && EINTR == errno);
+        if (0 == result) {
+            LOG(TRACE) << "Jobserver: Locked '" << path << "'";
+            token._fd = fd;
+            token._slot = true;
+            return token;
+        }
+        close(fd);
+    }
+#else
+    (void)wait;
+#endif
+    return token;
+}
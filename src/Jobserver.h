@@ -0,0 +1,94 @@
+/*
+ * Jobserver.h
+ *
+ * Copyright (c) 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef JOBSERVER_H_
+#define JOBSERVER_H_
+
+#include <string>
+
+#include "Environment.h"
+
+// Limits the number of linters running at once across all processes. Acts
+// as a client of the jobserver announced by GNU make via MAKEFLAGS and
+// falls back to a fixed number of slots guarded by file locks otherwise
+class Jobserver
+{
+public:
+    // the number of slots used without a jobserver, 0 disables them
+    static const char* kEnvSlots;
+    // set for children running within a slot held by their parent
+    static const char* kEnvHeld;
+
+    // a token or slot released when destroyed, empty when none was needed
+    class Token
+    {
+    public:
+        Token() = default;
+        Token(Token&& other) noexcept;
+        Token& operator=(Token&& other) noexcept;
+        Token(const Token&) = delete;
+        Token& operator=(const Token&) = delete;
+        ~Token();
+
+        explicit operator bool() const { return _fd >= 0; }
+
+        void release();
+
+    private:
+        friend class Jobserver;
+
+        // the descriptor to write the token to or the locked slot file
+        int _fd = -1;
+        char _token = '+';
+        bool _slot = false;
+    };
+
+    explicit Jobserver(const Environment& env = Environment());
+    Jobserver(const Jobserver&) = delete;
+    Jobserver& operator=(const Jobserver&) = delete;
+    ~Jobserver();
+
+    // true when MAKEFLAGS named a usable jobserver
+    inline bool external() const { return _readFd >= 0; }
+
+    // blocks until a token is available, returns an empty token when the
+    // slot is held by the parent already or limiting is disabled
+    Token acquire();
+
+    // like acquire() but returns an empty token instead of blocking,
+    // always does so when the jobserver cannot be read without blocking
+    Token tryAcquire();
+
+private:
+    Token take(bool wait);
+    Token lockSlot(bool wait);
+
+    bool _held;
+    int _readFd;
+    int _writeFd;
+    bool _ownsFds;
+    // false when tryAcquire() could block and therefore never takes tokens
+    bool _nonBlocking;
+    unsigned _slots;
+    std::string _slotDir;
+};
+
+#endif // JOBSERVER_H_
@@ -0,0 +1,80 @@
+/*
+ * LintResult.cpp
+ *
+ * Copyright (c) 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdlib>
+
+#include "LintResult.h"
+
+const char* LintResult::kEnvNoCaching = "LINTER_CACHE_NO_FAILURE_CACHING";
+
+static constexpr char kSuccess[] = "ok-";
+static constexpr char kFailure[] = "fail-";
+
+bool
+LintResult::cacheable(int exitCode)
+{
+    // shells report signals as 128 + signal
+    return 0 < exitCode && exitCode < 128;
+}
+
+std::string
+LintResult::serialize() const
+{
+    if (0 == exitCode) {
+        return kSuccess;
+    }
+    // fail-<exitcode> <length of output>\n<output><error output>
+    return kFailure + std::to_string(exitCode) + " " +
+           std::to_string(output.size()) + "\n" + output + errorOutput;
+}
+
+bool
+LintResult::parse(const std::string& data, LintResult& result)
+{
+    if (0 != data.compare(0, sizeof(kFailure) - 1, kFailure)) {
+        return false;
+    }
+    const auto newline = data.find('\n');
+    if (std::string::npos == newline) {
+        return false;
+    }
+
+    const char* header = data.c_str() + sizeof(kFailure) - 1;
+    char* end = nullptr;
+    const auto exitCode = std::strtol(header, &end, 10);
+    if (end == header || *end != ' ') {
+        return false;
+    }
+    header = end + 1;
+    const auto length = std::strtoul(header, &end, 10);
+    if (end == header || *end != '\n') {
+        return false;
+    }
+    const auto body = newline + 1;
+    if (length > data.size() - body) {
+        return false;
+    }
+
+    result.exitCode = static_cast<int>(exitCode);
+    result.output = data.substr(body, length);
+    result.errorOutput = data.substr(body + length);
+    return true;
+}
@@ -0,0 +1,50 @@
+/*
+ * LintResult.h
+ *
+ * Copyright (c) 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LINT_RESULT_H_
+#define LINT_RESULT_H_
+
+#include <string>
+
+// the outcome of a linter run as stored in the object file handed to ccache
+//
+// ccache only caches successful compiler invocations so failing runs get
+// reported as success with the original exit code and diagnostics encoded
+// here, to be decoded again by the invocation waiting on ccache
+struct LintResult
+{
+    int exitCode = 0;
+    std::string output;
+    std::string errorOutput;
+
+    // when set, failures are neither stored nor replayed from the cache
+    static const char* kEnvNoCaching;
+
+    // exit codes which are worth caching, excluding crashes and signals
+    static bool cacheable(int exitCode);
+
+    std::string serialize() const;
+
+    // returns false when data was not a serialized failure
+    static bool parse(const std::string& data, LintResult& result);
+};
+
+#endif // LINT_RESULT_H_
@@ -25,6 +25,7 @@
 #include "SavedArguments.h"
 #include "CommandlineArguments.h"
 #include "Environment.h"
+#include "OutputSink.h"
 #include "StringList.h"
 
 class Linter
@@ -34,13 +35,19 @@ public:
 
     virtual std::string executable() const = 0;
 
+    // digest of the configuration which applies to the source
+    virtual std::string configDigest(const std::string& sourceFile,
+                                     const CommandlineArguments& args) const = 0;
+
     virtual void prepare(const std::string& sourceFile,
                          const CommandlineArguments& args,
                          SavedArguments& savedArgs,
                          Environment& env) = 0;
 
+    // writes the preprocessed source and whatever else influences the
+    // result of the linter to output
     virtual void preprocess(const SavedArguments& savedArgs,
-                            std::string& output) = 0;
+                            OutputSink& output) = 0;
 
     virtual void execute(const SavedArguments& savedArgs,
                          std::string& output) = 0;
@@ -19,13 +19,36 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <csignal>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <set>
+
 #include "LinterClangTidy.h"
+#include "LintResult.h"
 #include "Subprocess.h"
+#include "Jobserver.h"
 #include "Logging.h"
+#include "MemoryBudget.h"
+#include "Metrics.h"
+#include "Trace.h"
 #include "CompileCommands.h"
+#include "Depfile.h"
+#include "Digest.h"
+#include "DirectCache.h"
+#include "Fingerprint.h"
+#include "FlagCanonicalizer.h"
+#include "IncludeScanner.h"
+#include "TemporaryFile.h"
 #include "Util.h"
 
 static constexpr char kEnvClangTidy[] = "CLANG_TIDY";
+static constexpr char kEnvPreprocess[] = "LINTER_CACHE_PREPROCESS";
+static constexpr char kPreprocessCompiler[] = "compiler";
+static constexpr char kPreprocessScan[] = "scan";
+static constexpr char kPreprocessDepfile[] = "depfile";
 static constexpr char kSaveSrc[] = "clangTidySrc";
 static constexpr char kSaveArgs[] = "clangTidyArgs";
 static constexpr char kSaveCompDb[] = "clangTidyCompDb";
@@ -33,6 +56,8 @@ static constexpr char kSaveCompDb[] = "clangTidyCompDb";
 LinterClangTidy::LinterClangTidy(const std::string& clangTidy,
                                  const Environment& env)
   : _clangTidy(clangTidy)
+  , _cacheFailures(!env.get(LintResult::kEnvNoCaching, false))
+  , _limits(Process::Limits::fromEnvironment())
 {
     if (_clangTidy.empty()) {
         _clangTidy = env.get(kEnvClangTidy, "clang-tidy");
@@ -40,6 +65,13 @@ LinterClangTidy::LinterClangTidy(const std::string& clangTidy,
     LOG(TRACE) << "Using clang-tidy from '" << _clangTidy << "'";
 }
 
+std::string
+LinterClangTidy::configDigest(const std::string& sourceFile,
+                              const CommandlineArguments& args) const
+{
+    return _configs.resolve(sourceFile, args.remainingArgs).digest;
+}
+
 void
 LinterClangTidy::prepare(const std::string& sourceFile,
                          const CommandlineArguments& args,
@@ -55,53 +87,298 @@ LinterClangTidy::prepare(const std::string& sourceFile,
     env.set(kEnvClangTidy, _clangTidy);
 }
 
+// emits the source followed by line markers and digests of all headers
+static void
+writeManifest(const std::string& sourcePath,
+              const CompileCommands::Flags& flags,
+              const std::map<std::string, std::string>& headers,
+              const std::set<std::string>& missing,
+              std::string& output)
+{
+    std::string manifest = Util::preproc_file_header(sourcePath);
+    manifest += NamedFile(sourcePath).readText();
+    manifest += "\n";
+    for (const auto& header : headers) {
+        manifest += Util::preproc_file_header(header.first);
+        manifest += "// " + header.second + "\n";
+    }
+    // anything not found is expected to be provided by the compiler
+    // and macros are not reflected above, hence include both verbatim
+    for (const auto& name : missing) {
+        manifest += "// missing " + name + "\n";
+    }
+    const auto compiler = Util::find_program(flags.compiler);
+    Util::FileInfo info;
+    if (!compiler.empty() && Util::file_info(compiler, info)) {
+        manifest += "// compiler " + compiler + " " +
+                    std::to_string(info.size) + " " +
+                    std::to_string(info.mtime) + "\n";
+    } else {
+        manifest += "// compiler " + flags.compiler + "\n";
+    }
+    for (const auto& option : flags.options) {
+        manifest += "// option " + option + "\n";
+    }
+    output += manifest;
+}
+
+// returns false when the includes could not be resolved without the compiler
+static bool
+scanIncludes(const std::string& sourcePath,
+             const CompileCommands::Flags& flags,
+             std::string& output)
+{
+    IncludeScanner scanner(flags.options);
+    if (!scanner.scan(sourcePath)) {
+        LOG(TRACE) << "LinterClangTidy: Falling back to the compiler for "
+                   << sourcePath;
+        return false;
+    }
+    writeManifest(sourcePath, flags, scanner.headers(), scanner.missing(), output);
+    return true;
+}
+
+// returns false when there is no up to date depfile written by the build,
+// `path` is located via the original flags as canonicalizing drops `-MF`
+static bool
+readDepfile(const std::string& sourcePath,
+            const std::string& path,
+            const CompileCommands::Flags& flags,
+            std::string& output)
+{
+    if (path.empty()) {
+        LOG(TRACE) << "LinterClangTidy: No depfile written for " << sourcePath;
+        return false;
+    }
+    Depfile depfile(path, flags.directory);
+    if (!depfile.fresh()) {
+        LOG(TRACE) << "LinterClangTidy: Depfile '" << path
+                   << "' is missing or outdated";
+        return false;
+    }
+
+    const auto source = Util::normalize_path(sourcePath);
+    bool listsSource = false;
+    std::map<std::string, std::string> headers;
+    for (const auto& dependency : depfile.dependencies()) {
+        if (dependency == source) {
+            listsSource = true;
+            continue;
+        }
+        std::string digest;
+        if (!Digest::file(dependency, digest)) {
+            return false;
+        }
+        headers[dependency] = digest;
+    }
+    if (!listsSource) {
+        LOG(TRACE) << "LinterClangTidy: Depfile '" << path
+                   << "' does not belong to " << sourcePath;
+        return false;
+    }
+    writeManifest(sourcePath, flags, headers, {}, output);
+    return true;
+}
+
 void
 LinterClangTidy::preprocess(const SavedArguments& savedArgs,
-                            std::string& output)
+                            OutputSink& output)
 {
     // ccache wants to get the preproc output
     // we create this from
     // a) the source
     // b) the effective config
+    Metrics metrics;
+    Metrics::Timer timer(metrics,
+                         Metrics::Counter::PREPROCESS_RUNS,
+                         Metrics::Counter::PREPROCESS_MICROS);
 
     auto sourcePath = savedArgs.get(kSaveSrc);
+    const auto fingerprintFile = Environment::get(Fingerprint::kEnvFile);
+    StringList headers;
 
+    std::string manifest;
     auto compDb = savedArgs.get(kSaveCompDb);
     if (compDb.empty()) {
         NamedFile sourceFile(sourcePath);
-        output += sourceFile.readText();
+        manifest += sourceFile.readText();
     } else {
         CompileCommands compDb(savedArgs.get(kSaveCompDb));
         auto flags = compDb.flagsForFile(sourcePath);
-        auto compilerArgs = flags.options;
-        compilerArgs.insert(compilerArgs.begin(), flags.compiler);
-        compilerArgs.insert(compilerArgs.end(), { "-E", "-c", sourcePath });
+        const auto depfilePath = Depfile::pathFor(flags);
+        // flags not hashed by ccache must not change the output either
+        flags.options = FlagCanonicalizer::fromEnvironment().apply(flags.options);
+        const auto mode = Environment::get(kEnvPreprocess, kPreprocessCompiler);
+        if (kPreprocessScan == mode &&
+            scanIncludes(sourcePath, flags, manifest)) {
+            LOG(TRACE) << "LinterClangTidy: Scanned includes of " << sourcePath;
+        } else if (kPreprocessDepfile == mode &&
+                   readDepfile(sourcePath, depfilePath, flags, manifest)) {
+            LOG(TRACE) << "LinterClangTidy: Used depfile of " << sourcePath;
+        } else {
+            const bool msvcStyle = Depfile::msvcStyle(flags);
+            auto compilerArgs = msvcStyle
+                                  ? flags.options
+                                  : Depfile::withoutDepfileOptions(flags.options);
+            compilerArgs.insert(compilerArgs.begin(), flags.compiler);
 
-        Process compiler(compilerArgs, Process::CAPTURE_STDOUT);
-        compiler.run();
-        output += compiler.output();
+            // the headers come from a depfile written on the side so that
+            // the output, which can be huge, still goes where it is needed.
+            // cl style compilers cannot write one, there the line markers
+            // are picked from the output on its way instead
+            std::unique_ptr<TemporaryFile> depfile;
+            DirectCache::Recorder recorder(output);
+            OutputSink* sink = &output;
+            if (!fingerprintFile.empty() && msvcStyle) {
+                sink = &recorder;
+            } else if (!fingerprintFile.empty()) {
+                depfile = std::make_unique<TemporaryFile>();
+                compilerArgs.insert(compilerArgs.end(),
+                                    { "-MD", "-MF", depfile->filename() });
+            }
+            compilerArgs.insert(compilerArgs.end(), { "-E", "-c", sourcePath });
+
+            TraceSpan span("run preprocessor", sourcePath);
+            Process compiler(compilerArgs);
+            compiler.setOutputSink(sink);
+            compiler.setLimits(_limits);
+            compiler.run();
+            LOG(INFO) << "LinterClangTidy: Preprocessed, " << compiler.usage();
+            if (sink == &recorder) {
+                headers = recorder.files();
+            } else if (depfile) {
+                const auto source = Util::normalize_path(sourcePath);
+                const Depfile dependencies(depfile->filename(), "");
+                for (const auto& dependency : dependencies.dependencies()) {
+                    if (dependency != source) {
+                        headers.push_back(dependency);
+                    }
+                }
+            }
+        }
+    }
+    if (!fingerprintFile.empty() && headers.empty()) {
+        headers = DirectCache::filesFromPreprocessed(manifest);
     }
 
-    auto clang_tidy_config =
-      Util::find_applicable_config(".clang-tidy", sourcePath);
-    if (!clang_tidy_config.empty()) {
-        output += Util::preproc_file_header(clang_tidy_config);
-        output += NamedFile(clang_tidy_config).readText();
+    // name every config file so that they get tracked as dependencies
+    // but only pass a single digest covering the whole chain
+    const auto config =
+      _configs.resolve(sourcePath, savedArgs.get(kSaveArgs, StringList()));
+    for (const auto& file : config.chain) {
+        manifest += Util::preproc_file_header(file);
+    }
+    manifest += "\n// config " + config.digest + "\n";
+    output.write(manifest);
+
+    if (!fingerprintFile.empty()) {
+        // the source itself is tracked by the cache already
+        headers.erase(std::remove(headers.begin(), headers.end(), sourcePath),
+                      headers.end());
+        Fingerprint previous;
+        previous.load(Fingerprint::pathFor(sourcePath));
+        Fingerprint fingerprint;
+        fingerprint.setFiles("headers", headers, &previous);
+        fingerprint.setFiles("config", config.chain, &previous);
+        fingerprint.save(fingerprintFile);
     }
 }
 
-void
-LinterClangTidy::execute(const SavedArguments& savedArgs, std::string& output)
+// the OOM killer sends SIGKILL, so does exceeding RLIMIT_CPU though
+static bool
+killedByOom(const Process& proc)
 {
-    output = "ok-" + invoke(savedArgs.get(kSaveArgs, StringList()) +
-                            savedArgs.get(kSaveSrc));
+#ifdef SIGKILL
+    return !proc.timedOut() && 128 + SIGKILL == proc.exitCode();
+#else
+    (void)proc;
+    return false;
+#endif
 }
 
-std::string
-LinterClangTidy::invoke(const StringList& args, int flags) const
+static void
+count(Metrics& metrics, const Process& proc)
 {
-    Process proc(_clangTidy + args, flags);
-    LOG(TRACE) << "LinterClangTidy: Running " << proc.cmd();
-    proc.run();
-    return proc.output();
+    metrics.add(Metrics::Counter::LINT_RUNS);
+    metrics.addSeconds(Metrics::Counter::LINT_MICROS, proc.usage().wallSeconds);
+    if (proc.timedOut()) {
+        metrics.add(Metrics::Counter::LINT_TIMEOUTS);
+    } else if (0 != proc.exitCode()) {
+        metrics.add(Metrics::Counter::LINT_FAILURES);
+    }
 }
+
+void
+LinterClangTidy::execute(const SavedArguments& savedArgs, std::string& output)
+{
+    Process proc(_clangTidy + savedArgs.get(kSaveArgs, StringList()) +
+                   savedArgs.get(kSaveSrc),
+                 Process::CAPTURE_STDOUT | Process::CAPTURE_STDERR);
+    proc.setLimits(_limits);
+
+    // only misses get here, ccache replays hits without calling us
+    Jobserver jobserver;
+    const auto token = [&jobserver] {
+        TraceSpan span("wait for token");
+        return jobserver.acquire();
+    }();
+
+    const auto source = savedArgs.get(kSaveSrc);
+    MemoryBudget budget;
+    Metrics metrics;
+    LintResult result;
+    for (int attempt = 0;; ++attempt) {
+        try {
+            const auto reservation = budget.reserve(source);
+            LOG(TRACE) << "LinterClangTidy: Running " << proc.cmd();
+            TraceSpan span("run clang-tidy", source);
+            proc.run();
+            LOG(INFO) << "LinterClangTidy: Finished, " << proc.usage();
+            budget.record(source, proc.usage().maxResidentKb);
+            count(metrics, proc);
+            break;
+        } catch (ProcessError& error) {
+            LOG(INFO) << "LinterClangTidy: Failed with " << error.exitCode()
+                      << ", " << proc.usage();
+            budget.record(source, proc.usage().maxResidentKb);
+            count(metrics, proc);
+            if (0 == attempt && 0 == _limits.cpuSeconds &&
+                killedByOom(proc)) {
+                // the estimate recorded above makes the next run wait
+                // until enough memory is available
+                LOG(WARNING) << "LinterClangTidy: Retrying '" << source
+                             << "' after being killed";
+                metrics.add(Metrics::Counter::LINT_RETRIES);
+                continue;
+            }
+            if (proc.timedOut()) {
+                // the result is incomplete, never let ccache store it
+                std::cout << proc.output();
+                std::cerr << proc.errorOutput();
+                std::cerr << "linter-cache: " << source << ": Timed out after "
+                          << _limits.timeoutSeconds << "s" << std::endl;
+                throw;
+            }
+            if (!_cacheFailures ||
+                !LintResult::cacheable(error.exitCode())) {
+                std::cout << proc.output();
+                std::cerr << proc.errorOutput();
+                throw;
+            }
+            // report success to ccache so that the findings get cached
+            // too, the diagnostics travel inside the output instead
+            LOG(TRACE) << "LinterClangTidy: Caching failure "
+                       << error.exitCode();
+            result.exitCode = error.exitCode();
+            result.output = proc.output();
+            result.errorOutput = proc.errorOutput();
+            output = result.serialize();
+            return;
+        }
+    }
+
+    std::cout << proc.output();
+    std::cerr << proc.errorOutput();
+    output = result.serialize();
+}
+
@@ -22,6 +22,7 @@
 #ifndef LINTER_CLANG_TIDY_H_
 #define LINTER_CLANG_TIDY_H_
 
+#include "ConfigResolver.h"
 #include "Linter.h"
 #include "Subprocess.h"
 
@@ -32,20 +33,24 @@ public:
 
     std::string executable() const final { return _clangTidy; }
 
+    std::string configDigest(const std::string& sourceFile,
+                             const CommandlineArguments& args) const final;
+
     void prepare(const std::string& sourceFile,
                  const CommandlineArguments& args,
                  SavedArguments& savedArgs,
                  Environment& env) final;
 
-    void preprocess(const SavedArguments& savedArgs, std::string& output) final;
+    void preprocess(const SavedArguments& savedArgs, OutputSink& output) final;
 
     void execute(const SavedArguments& savedArg, std::string& output) final;
 
 private:
-    std::string invoke(const StringList& args,
-                       int flags = Process::Flags::NONE) const;
-
     std::string _clangTidy;
+    bool _cacheFailures;
+    Process::Limits _limits;
+    // memoizes the resolved configs only
+    mutable ConfigResolver _configs;
 };
 
 #endif // LINTER_CLANG_TIDY_H_
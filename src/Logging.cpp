@@ -19,10 +19,31 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
 #include <iostream>
+#include <vector>
+
+#include "config.h"
+
+#if LINTER_CACHE_HAVE_OPEN
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
 
 #include "Logging.h"
 #include "Environment.h"
+#include "MappedFile.h"
+#include "Util.h"
+
+const char* Logging::kPidPattern = "%p";
+
+// "YYYY-MM-DDTHH:MM:SS.uuuuuuZ" sorts in the order of time
+static constexpr size_t kTimestampSize = 27;
 
 Logging&
 Logging::defaultInstance()
@@ -31,9 +52,58 @@ Logging::defaultInstance()
     return s_instance;
 }
 
+static Logging::Level
+level_from_string(const std::string& level)
+{
+    if (level == "info") {
+        return Logging::Level::INFO;
+    }
+    if (level == "warning") {
+        return Logging::Level::WARNING;
+    }
+    if (level == "error") {
+        return Logging::Level::ERROR;
+    }
+    return Logging::Level::TRACE;
+}
+
+static std::string
+timestamp()
+{
+    const auto now = std::chrono::system_clock::now();
+    const auto time = std::chrono::system_clock::to_time_t(now);
+    const auto micros = std::chrono::duration_cast<std::chrono::microseconds>(
+                          now.time_since_epoch())
+                          .count() %
+                        1000000;
+    std::tm utc{};
+#if _WIN32
+    gmtime_s(&utc, &time);
+#else
+    gmtime_r(&time, &utc);
+#endif
+    char buffer[kTimestampSize + 1];
+    const auto length =
+      std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S", &utc);
+    std::snprintf(buffer + length,
+                  sizeof(buffer) - length,
+                  ".%06dZ",
+                  static_cast<int>(micros));
+    return buffer;
+}
+
+static bool
+is_record(const char* line, size_t size)
+{
+    return size >= kTimestampSize && '-' == line[4] && 'T' == line[10] &&
+           'Z' == line[kTimestampSize - 1];
+}
+
 Logging::Logging()
-  : _stream(nullptr)
+  : _fd(-1)
+  , _stream(nullptr)
   , _logfile()
+  , _level(Level::TRACE)
 {
     Environment env;
 
@@ -42,33 +112,169 @@ Logging::Logging()
     auto debug =
       env.get("LINTER_CACHE_DEBUG", env.get("CACHE_TIDY_VERBOSE", false));
     if (!logfile.empty()) {
+        const auto pattern = logfile.find(kPidPattern);
+        if (std::string::npos != pattern) {
+            logfile.replace(
+              pattern, 2, std::to_string(Util::process_id()));
+        }
+#if LINTER_CACHE_HAVE_OPEN
+        _fd = open(logfile.c_str(),
+                   O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC,
+                   0644);
+#else
         _logfile.open(logfile, std::ios::out | std::ios::app);
         _stream = &_logfile;
+#endif
     } else if (debug) {
         _stream = &std::cerr;
-    } else {
-        // FIXME(zwicker): Optimize this better
-        _logfile.setstate(std::ios::badbit);
-        _stream = &_logfile;
     }
+    _level = std::max(level_from_string(env.get("LINTER_CACHE_LOG_LEVEL")),
+                      kMinimumLevel);
 }
 
-std::ostream&
-Logging::stream(Level level)
+Logging::~Logging()
 {
+#if LINTER_CACHE_HAVE_OPEN
+    if (_fd >= 0) {
+        close(_fd);
+    }
+#endif
+}
+
+void
+Logging::setCorrelation(const std::string& id)
+{
+    const std::lock_guard<std::mutex> lock(_mutex);
+    _correlation = id;
+}
+
+void
+Logging::write(Level level, const std::string& message)
+{
+    const char* prefix = "";
     switch (level) {
         case Level::TRACE:
-            *_stream << "TRACE: ";
+            prefix = "TRACE: ";
             break;
         case Level::INFO:
-            *_stream << " INFO: ";
+            prefix = " INFO: ";
             break;
         case Level::WARNING:
-            *_stream << " WARN: ";
+            prefix = " WARN: ";
             break;
         case Level::ERROR:
-            *_stream << "  ERR: ";
+            prefix = "  ERR: ";
             break;
     }
-    return *_stream;
+
+    std::string record = timestamp();
+    record.reserve(record.size() + message.size() + 64);
+    record += ' ';
+    record += std::to_string(Util::process_id());
+    record += ' ';
+
+    const std::lock_guard<std::mutex> lock(_mutex);
+    record += _correlation.empty() ? "-" : _correlation;
+    record += ' ';
+    record += prefix;
+    record += message;
+    record += '\n';
+#if LINTER_CACHE_HAVE_OPEN
+    if (_fd >= 0) {
+        // O_APPEND moves to the end and writes in one step, interrupted
+        // writes are the only ones which may end up partial
+        for (size_t written = 0; written < record.size();) {
+            const auto result = ::write(
+              _fd, record.data() + written, record.size() - written);
+            if (result <= 0) {
+                break;
+            }
+            written += static_cast<size_t>(result);
+        }
+        return;
+    }
+#endif
+    *_stream << record << std::flush;
+}
+
+size_t
+Logging::merge(const std::string& pattern, std::ostream& output)
+{
+    const auto slash = pattern.find_last_of("/\\");
+    const auto dirpath =
+      std::string::npos == slash ? std::string(".") : pattern.substr(0, slash);
+    const auto name =
+      std::string::npos == slash ? pattern : pattern.substr(slash + 1);
+    const auto placeholder = name.find(kPidPattern);
+    const auto prefix = name.substr(0, placeholder);
+    const auto suffix =
+      std::string::npos == placeholder ? std::string() : name.substr(placeholder + 2);
+
+    struct Record
+    {
+        std::string timestamp;
+        std::string text;
+    };
+    std::vector<Record> records;
+    size_t merged = 0;
+    for (const auto& candidate : Util::list_dir(dirpath)) {
+        if (std::string::npos == placeholder) {
+            if (candidate != name) {
+                continue;
+            }
+        } else {
+            // only the pid may differ
+            if (candidate.size() <= prefix.size() + suffix.size() ||
+                0 != candidate.compare(0, prefix.size(), prefix) ||
+                0 != candidate.compare(candidate.size() - suffix.size(),
+                                       suffix.size(),
+                                       suffix)) {
+                continue;
+            }
+            const auto pid = candidate.substr(
+              prefix.size(), candidate.size() - prefix.size() - suffix.size());
+            if (!std::all_of(pid.begin(), pid.end(), [](unsigned char c) {
+                    return std::isdigit(c);
+                })) {
+                continue;
+            }
+        }
+        MappedFile file(dirpath + "/" + candidate);
+        if (!file) {
+            continue;
+        }
+        ++merged;
+
+        // lines not starting with a timestamp continue the previous record
+        const auto* data = file.data();
+        const auto size = file.size();
+        const auto first = records.size();
+        for (size_t begin = 0; begin < size;) {
+            const auto* newline = static_cast<const char*>(
+              std::memchr(data + begin, '\n', size - begin));
+            const auto end = newline ? size_t(newline - data) + 1 : size;
+            if (records.size() == first || is_record(data + begin, end - begin)) {
+                Record record;
+                if (is_record(data + begin, end - begin)) {
+                    record.timestamp.assign(data + begin, kTimestampSize);
+                }
+                records.push_back(std::move(record));
+            }
+            records.back().text.append(data + begin, end - begin);
+            begin = end;
+        }
+        if (records.size() > first && '\n' != records.back().text.back()) {
+            records.back().text += '\n';
+        }
+    }
+
+    // records of a single process are in order already
+    std::stable_sort(
+      records.begin(), records.end(), [](const Record& a, const Record& b) {
+          return a.timestamp < b.timestamp;
+      });
+    for (const auto& record : records) {
+        output << record.text;
+    }
+    return merged;
 }
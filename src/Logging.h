@@ -22,8 +22,13 @@
 #ifndef LOGGING_H_
 #define LOGGING_H_
 
-#include <ostream>
 #include <fstream>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+
+#include "config.h"
 
 class LogMessage;
 
@@ -38,40 +43,95 @@ public:
         ERROR
     };
 
+    // messages below this level are removed at compile time,
+    // see the LINTER_CACHE_MIN_LOG_LEVEL option in CMake
+    static constexpr Level kMinimumLevel =
+      static_cast<Level>(LINTER_CACHE_MIN_LOG_LEVEL);
+
+    // replaced by the pid in `LINTER_CACHE_LOGFILE` to log to one
+    // file per process, see merge()
+    static const char* kPidPattern;
+
     Logging();
+    ~Logging();
+
+    Logging(const Logging&) = delete;
+    Logging& operator=(const Logging&) = delete;
+
+    // true when messages of the given level get written anywhere,
+    // use LOG() to skip formatting them otherwise
+    inline bool enabled(Level level) const
+    {
+        return (_fd >= 0 || _stream != nullptr) && level >= _level;
+    }
 
-    std::ostream& stream(Level level);
+    // writes a complete record prefixed by the time, the pid, the
+    // correlation id and the level, safe to call from any thread
+    void write(Level level, const std::string& message);
+
+    // tags all following records, e.g. to follow a source across processes
+    void setCorrelation(const std::string& id);
 
     static Logging& defaultInstance();
 
+    // writes the records of all logfiles matching a pattern containing
+    // kPidPattern ordered by time, returns the number of files merged
+    static size_t merge(const std::string& pattern, std::ostream& output);
+
 private:
+    std::mutex _mutex;
+    // logfiles are appended to by a single write per record, other
+    // processes may be writing to the same file at the same time
+    int _fd;
     std::ostream* _stream;
     std::ofstream _logfile;
+    Level _level;
+    std::string _correlation;
 };
 
 class LogMessage
 {
 public:
     inline LogMessage(Logging::Level level, Logging& logging)
-      : _stream(logging.stream(level))
+      : _level(level)
+      , _logging(logging)
     {}
 
     inline LogMessage(Logging::Level level)
       : LogMessage(level, Logging::defaultInstance())
     {}
 
-    inline ~LogMessage() { _stream << std::endl; }
+    // collects the message first so that concurrent ones never interleave
+    inline ~LogMessage()
+    {
+        if (_logging.enabled(_level)) {
+            _logging.write(_level, _buffer.str());
+        }
+    }
 
-    inline std::ostream& stream() { return _stream; };
+    inline std::ostream& stream() { return _buffer; };
 
 private:
-    std::ostream& _stream;
+    Logging::Level _level;
+    Logging& _logging;
+    std::ostringstream _buffer;
 };
 
-#define LOG(level) LogMessage(Logging::Level::level).stream()
+// turns the streamed message into void to match the other branch of LOG()
+struct LogVoidify
+{
+    inline void operator&(std::ostream&) {}
+};
+
+// the operands streamed into a disabled level never get evaluated
+#define LOG_TO(logging, level)                                                 \
+    !(Logging::Level::level >= Logging::kMinimumLevel &&                       \
+      (logging).enabled(Logging::Level::level))                                \
+      ? (void)0                                                                \
+      : LogVoidify() & LogMessage(Logging::Level::level, logging).stream()
+
+#define LOG(level) LOG_TO(Logging::defaultInstance(), level)
 
-#define LOG_IF(level, condition)                                               \
-    if (condition)                                                             \
-    LogMessage(Logging::Level::##level).stream()
+#define LOG_IF(level, condition) !(condition) ? (void)0 : LOG(level)
 
 #endif // LOGGING_H_
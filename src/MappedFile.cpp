@@ -0,0 +1,83 @@
+/*
+ * MappedFile.cpp
+ *
+ * Copyright (c) 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "config.h"
+
+#include <array>
+#include <cstdio>
+#if LINTER_CACHE_HAVE_MMAP
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#include "MappedFile.h"
+
+MappedFile::MappedFile(const std::string& filename)
+  : _data(nullptr)
+  , _size(0)
+{
+#if LINTER_CACHE_HAVE_MMAP
+    auto fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    struct stat info;
+    if (0 == fstat(fd, &info) && info.st_size > 0) {
+        auto* mapped = mmap(nullptr,
+                            static_cast<size_t>(info.st_size),
+                            PROT_READ,
+                            MAP_SHARED,
+                            fd,
+                            0);
+        if (MAP_FAILED != mapped) {
+            _data = static_cast<const char*>(mapped);
+            _size = static_cast<size_t>(info.st_size);
+        }
+    }
+    // the mapping stays valid after closing
+    close(fd);
+#else
+    auto* input = fopen(filename.c_str(), "rb");
+    if (input) {
+        std::array<char, 4096> buffer;
+        size_t read = 0;
+        while ((read = fread(buffer.data(), 1, buffer.size(), input)) > 0) {
+            _buffer.append(buffer.data(), read);
+        }
+        fclose(input);
+    }
+    if (!_buffer.empty()) {
+        _data = _buffer.data();
+        _size = _buffer.size();
+    }
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#if LINTER_CACHE_HAVE_MMAP
+    if (_data) {
+        munmap(const_cast<char*>(_data), _size);
+    }
+#endif
+}
@@ -0,0 +1,49 @@
+/*
+ * MappedFile.h
+ *
+ * Copyright (c) 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MAPPED_FILE_H_
+#define MAPPED_FILE_H_
+
+#include <string>
+
+class MappedFile
+{
+public:
+    // maps the given file read-only, falls back to reading
+    // the whole file on platforms without support for mmap()
+    MappedFile(const std::string& filename);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    inline const char* data() const { return _data; }
+    inline size_t size() const { return _size; }
+
+    inline operator bool() const { return _data != nullptr; }
+
+private:
+    const char* _data;
+    size_t _size;
+    std::string _buffer;
+};
+
+#endif // MAPPED_FILE_H_
@@ -0,0 +1,294 @@
+/*
+ * MemoryBudget.cpp
+ *
+ * Copyright (c) 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include "config.h"
+
+#if LINTER_CACHE_HAVE_FLOCK
+    #include <fcntl.h>
+    #include <signal.h>
+    #include <sys/file.h>
+    #include <unistd.h>
+#endif
+
+#include "Environment.h"
+#include "Logging.h"
+#include "MemoryBudget.h"
+#include "StringList.h"
+#include "Util.h"
+
+const char* MemoryBudget::kEnvBudget = "LINTER_CACHE_MEMORY_BUDGET";
+
+static constexpr auto kRetryInterval = std::chrono::milliseconds(100);
+
+static long
+physical_memory_kb()
+{
+#if defined(_SC_PHYS_PAGES) && defined(_SC_PAGESIZE)
+    const auto pages = sysconf(_SC_PHYS_PAGES);
+    const auto pageSize = sysconf(_SC_PAGESIZE);
+    if (pages > 0 && pageSize > 0) {
+        return static_cast<long>(static_cast<long long>(pages) * pageSize /
+                                 1024);
+    }
+#endif
+    return 0;
+}
+
+#if LINTER_CACHE_HAVE_FLOCK
+
+// holds an exclusive lock on the reservations while alive
+class LockedFile
+{
+public:
+    explicit LockedFile(const std::string& path)
+      : _fd(open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644))
+    {
+        if (_fd < 0) {
+            LOG(WARNING) << "MemoryBudget: Failed to open '" << path
+                         << "': " << strerror(errno);
+            return;
+        }
+        while (flock(_fd, LOCK_EX) < 0 && EINTR == errno) {
+        }
+    }
+    LockedFile(const LockedFile&) = delete;
+    LockedFile& operator=(const LockedFile&) = delete;
+    ~LockedFile()
+    {
+        if (_fd >= 0) {
+            close(_fd);
+        }
+    }
+
+    inline bool valid() const { return _fd >= 0; }
+
+    std::string read() const
+    {
+        std::string contents;
+        char buffer[4096];
+        ssize_t actual = 0;
+        lseek(_fd, 0, SEEK_SET);
+        while ((actual = ::read(_fd, buffer, sizeof(buffer))) > 0) {
+            contents.append(buffer, static_cast<size_t>(actual));
+        }
+        return contents;
+    }
+
+    void write(const std::string& contents) const
+    {
+        if (ftruncate(_fd, 0) < 0 ||
+            pwrite(_fd, contents.data(), contents.size(), 0) !=
+              static_cast<ssize_t>(contents.size())) {
+            LOG(WARNING) << "MemoryBudget: Failed to update reservations: "
+                         << strerror(errno);
+        }
+    }
+
+private:
+    int _fd;
+};
+
+// reservations are lines of "<pid>.<serial>\t<KiB>"
+static bool
+alive(const std::string& id)
+{
+    const auto pid = static_cast<pid_t>(std::atol(id.c_str()));
+    return pid > 0 && (0 == kill(pid, 0) || EPERM == errno);
+}
+
+#endif
+
+MemoryBudget::Reservation::Reservation(Reservation&& other) noexcept
+  : _budget(other._budget)
+  , _id(std::move(other._id))
+{
+    other._budget = nullptr;
+}
+
+MemoryBudget::Reservation&
+MemoryBudget::Reservation::operator=(Reservation&& other) noexcept
+{
+    if (this != &other) {
+        release();
+        _budget = other._budget;
+        _id = std::move(other._id);
+        other._budget = nullptr;
+    }
+    return *this;
+}
+
+MemoryBudget::Reservation::~Reservation()
+{
+    release();
+}
+
+void
+MemoryBudget::Reservation::release()
+{
+    if (_budget) {
+        _budget->remove(_id);
+        _budget = nullptr;
+    }
+}
+
+MemoryBudget::MemoryBudget(const std::string& directory, long budgetKb)
+  : _budgetKb(budgetKb)
+  , _reservations(directory + "/memory-reservations.txt")
+  , _history(directory + "/history.bin")
+{
+    if (_budgetKb < 0) {
+        const auto defaultMb = physical_memory_kb() / 1024 * 8 / 10;
+        _budgetKb = std::max(
+          0L,
+          static_cast<long>(Environment::get(kEnvBudget, static_cast<int>(
+                                                           defaultMb))) *
+            1024);
+    }
+#if !LINTER_CACHE_HAVE_FLOCK
+    _budgetKb = 0;
+#endif
+}
+
+std::string
+MemoryBudget::defaultDirectory()
+{
+    return Util::cache_dir();
+}
+
+long
+MemoryBudget::estimate(const std::string& sourcefile) const
+{
+    auto it = _observed.find(sourcefile);
+    const auto peakKb =
+      it != _observed.end() ? it->second : _history.peakRss(sourcefile);
+    return peakKb > 0 ? peakKb : kDefaultEstimateKb;
+}
+
+void
+MemoryBudget::record(const std::string& sourcefile, long peakKb)
+{
+    if (peakKb > 0) {
+        _observed[sourcefile] = peakKb;
+    }
+}
+
+MemoryBudget::Reservation
+MemoryBudget::reserve(const std::string& sourcefile)
+{
+    auto reservation = tryReserve(sourcefile);
+    if (reservation || 0 == _budgetKb) {
+        return reservation;
+    }
+
+    LOG(TRACE) << "MemoryBudget: Waiting to fit " << estimate(sourcefile)
+               << "kB of '" << sourcefile << "'";
+    const auto start = std::chrono::steady_clock::now();
+    while (!reservation) {
+        std::this_thread::sleep_for(kRetryInterval);
+        reservation = tryReserve(sourcefile);
+    }
+    const std::chrono::duration<double> waited =
+      std::chrono::steady_clock::now() - start;
+    LOG(INFO) << "MemoryBudget: Admitted '" << sourcefile << "' after "
+              << waited.count() << "s";
+    return reservation;
+}
+
+MemoryBudget::Reservation
+MemoryBudget::tryReserve(const std::string& sourcefile)
+{
+    static std::atomic<unsigned> s_serial{ 0 };
+
+    Reservation reservation;
+    if (0 == _budgetKb) {
+        return reservation;
+    }
+
+    const auto id =
+      std::to_string(Util::process_id()) + "." + std::to_string(s_serial++);
+    if (add(id, estimate(sourcefile))) {
+        reservation._budget = this;
+        reservation._id = id;
+    }
+    return reservation;
+}
+
+bool
+MemoryBudget::add(const std::string& id, long kb) const
+{
+#if LINTER_CACHE_HAVE_FLOCK
+    Util::make_dirs(_reservations.substr(0, _reservations.find_last_of('/')));
+    LockedFile file(_reservations);
+    if (!file.valid()) {
+        // never block linting because of the bookkeeping
+        return true;
+    }
+
+    long reserved = 0;
+    std::string kept;
+    for (const auto& line : StringList::split(file.read(), '\n')) {
+        const auto tab = line.find('\t');
+        if (std::string::npos == tab || !alive(line.substr(0, tab))) {
+            continue;
+        }
+        reserved += std::atol(line.c_str() + tab + 1);
+        kept += line + "\n";
+    }
+    if (reserved > 0 && reserved + kb > _budgetKb) {
+        return false;
+    }
+    file.write(kept + id + "\t" + std::to_string(kb) + "\n");
+    return true;
+#else
+    (void)id;
+    (void)kb;
+    return true;
+#endif
+}
+
+void
+MemoryBudget::remove(const std::string& id) const
+{
+#if LINTER_CACHE_HAVE_FLOCK
+    LockedFile file(_reservations);
+    if (!file.valid()) {
+        return;
+    }
+
+    const auto prefix = id + "\t";
+    std::string kept;
+    for (const auto& line : StringList::split(file.read(), '\n')) {
+        if (!line.empty() && 0 != line.compare(0, prefix.size(), prefix)) {
+            kept += line + "\n";
+        }
+    }
+    file.write(kept);
+#else
+    (void)id;
+#endif
+}
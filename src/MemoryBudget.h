@@ -0,0 +1,98 @@
+/*
+ * MemoryBudget.h
+ *
+ * Copyright (c) 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MEMORY_BUDGET_H_
+#define MEMORY_BUDGET_H_
+
+#include <map>
+#include <string>
+
+#include "History.h"
+
+// Admits linter runs only as long as the sum of their expected peak memory
+// fits into a budget shared by all processes. The reservations are kept in
+// a file in the cache directory and are only modified while holding a lock
+// on it, reservations of processes no longer alive get dropped
+class MemoryBudget
+{
+public:
+    // the budget in MiB, defaults to 80% of the physical memory
+    // and 0 disables any admission control
+    static const char* kEnvBudget;
+
+    // assumed for sources never seen before
+    static constexpr long kDefaultEstimateKb = 1024 * 1024;
+
+    // a reservation released when destroyed, empty when not admitted or
+    // when admission control is disabled. The budget needs to outlive it
+    class Reservation
+    {
+    public:
+        Reservation() = default;
+        Reservation(Reservation&& other) noexcept;
+        Reservation& operator=(Reservation&& other) noexcept;
+        Reservation(const Reservation&) = delete;
+        Reservation& operator=(const Reservation&) = delete;
+        ~Reservation();
+
+        explicit operator bool() const { return _budget != nullptr; }
+
+        void release();
+
+    private:
+        friend class MemoryBudget;
+
+        const MemoryBudget* _budget = nullptr;
+        std::string _id;
+    };
+
+    // a negative budget reads it from the environment
+    explicit MemoryBudget(const std::string& directory = defaultDirectory(),
+                          long budgetKb = -1);
+
+    inline long budgetKb() const { return _budgetKb; }
+
+    // the peak memory observed during the last run of the source, the
+    // History gets updated by Cache::execute() once everything finished
+    // so observations get remembered for later reservations meanwhile
+    long estimate(const std::string& sourcefile) const;
+    void record(const std::string& sourcefile, long peakKb);
+
+    // blocks until the estimate of the source fits next to all other
+    // reservations, a run exceeding the budget is admitted on its own
+    Reservation reserve(const std::string& sourcefile);
+
+    // like reserve() but returns an empty reservation instead of blocking
+    Reservation tryReserve(const std::string& sourcefile);
+
+    static std::string defaultDirectory();
+
+private:
+    bool add(const std::string& id, long kb) const;
+    void remove(const std::string& id) const;
+
+    long _budgetKb;
+    std::string _reservations;
+    History _history;
+    std::map<std::string, long> _observed;
+};
+
+#endif // MEMORY_BUDGET_H_
@@ -0,0 +1,218 @@
+/*
+ * Metrics.cpp
+ *
+ * Copyright (c) 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <iomanip>
+
+#include "config.h"
+
+#if LINTER_CACHE_HAVE_MMAP
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#include "Logging.h"
+#include "Metrics.h"
+#include "Util.h"
+
+// bump when changing the meaning of existing slots
+static constexpr uint64_t kMagic = 0x4c434d31; // "LCM1"
+// spare slots so that new counters keep existing files compatible
+static constexpr size_t kSlots = 63;
+
+static_assert(static_cast<size_t>(Metrics::Counter::COUNT) <= kSlots,
+              "Out of slots, bump kMagic and kSlots");
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "Counters are shared by processes and must be lock-free");
+
+struct Metrics::Layout
+{
+    std::atomic<uint64_t> magic;
+    std::atomic<uint64_t> counters[kSlots];
+};
+
+namespace {
+
+struct Description
+{
+    const char* name;
+    const char* help;
+    // counters of microseconds get exported as seconds
+    bool micros;
+};
+
+const Description kDescriptions[] = {
+    { "linter_cache_runs_total", "Sources checked including hits", false },
+    { "linter_cache_hits_total", "Sources replayed from the cache", false },
+    { "linter_cache_misses_total", "Sources which needed linting", false },
+    { "linter_cache_failures_total",
+      "Sources reported as failing including cached findings",
+      false },
+    { "linter_cache_run_seconds_total",
+      "Wall time spent checking sources",
+      true },
+    { "linter_cache_preprocess_runs_total",
+      "Preprocessing steps on behalf of ccache",
+      false },
+    { "linter_cache_preprocess_seconds_total",
+      "Wall time spent preprocessing",
+      true },
+    { "linter_cache_lint_runs_total", "Linter runs started", false },
+    { "linter_cache_lint_failures_total",
+      "Linter runs exiting with an error",
+      false },
+    { "linter_cache_lint_timeouts_total",
+      "Linter runs killed after timing out",
+      false },
+    { "linter_cache_lint_retries_total",
+      "Linter runs retried after being killed",
+      false },
+    { "linter_cache_lint_seconds_total", "Wall time spent linting", true },
+};
+
+static_assert(sizeof(kDescriptions) / sizeof(kDescriptions[0]) ==
+                static_cast<size_t>(Metrics::Counter::COUNT),
+              "Every counter needs a description");
+
+} // namespace
+
+Metrics::Metrics(const std::string& filepath)
+  : _layout(nullptr)
+{
+#if LINTER_CACHE_HAVE_MMAP
+    Util::make_dirs(filepath.substr(0, filepath.find_last_of("/\\")));
+    const auto fd = open(filepath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        LOG(WARNING) << "Metrics: Failed to open '" << filepath << "'";
+        return;
+    }
+    // growing a new file is idempotent, concurrent creators see zeroes
+    struct stat info;
+    if (0 != fstat(fd, &info) ||
+        (info.st_size < static_cast<off_t>(sizeof(Layout)) &&
+         0 != ftruncate(fd, sizeof(Layout)))) {
+        LOG(WARNING) << "Metrics: Failed to size '" << filepath << "'";
+        close(fd);
+        return;
+    }
+    auto* mapped = mmap(
+      nullptr, sizeof(Layout), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (MAP_FAILED == mapped) {
+        LOG(WARNING) << "Metrics: Failed to map '" << filepath << "'";
+        return;
+    }
+
+    auto* layout = static_cast<Layout*>(mapped);
+    uint64_t magic = 0;
+    if (!layout->magic.compare_exchange_strong(magic, kMagic) &&
+        kMagic != magic) {
+        LOG(WARNING) << "Metrics: Ignoring '" << filepath
+                     << "' written by another version";
+        munmap(mapped, sizeof(Layout));
+        return;
+    }
+    _layout = layout;
+#else
+    (void)filepath;
+#endif
+}
+
+Metrics::~Metrics()
+{
+#if LINTER_CACHE_HAVE_MMAP
+    if (_layout) {
+        munmap(_layout, sizeof(Layout));
+    }
+#endif
+}
+
+std::string
+Metrics::defaultPath()
+{
+    return Util::cache_dir() + "/metrics.bin";
+}
+
+void
+Metrics::add(Counter counter, uint64_t value)
+{
+    if (_layout) {
+        _layout->counters[static_cast<size_t>(counter)].fetch_add(
+          value, std::memory_order_relaxed);
+    }
+}
+
+void
+Metrics::addSeconds(Counter counter, double seconds)
+{
+    if (seconds > 0) {
+        add(counter, static_cast<uint64_t>(seconds * 1e6));
+    }
+}
+
+uint64_t
+Metrics::get(Counter counter) const
+{
+    if (!_layout) {
+        return 0;
+    }
+    return _layout->counters[static_cast<size_t>(counter)].load(
+      std::memory_order_relaxed);
+}
+
+void
+Metrics::exportText(std::ostream& output) const
+{
+    for (size_t i = 0; i < static_cast<size_t>(Counter::COUNT); ++i) {
+        const auto& description = kDescriptions[i];
+        const auto value = get(static_cast<Counter>(i));
+        output << "# HELP " << description.name << ' ' << description.help
+               << '\n'
+               << "# TYPE " << description.name << " counter\n"
+               << description.name << ' ';
+        if (description.micros) {
+            output << value / 1000000 << '.' << std::setw(6)
+                   << std::setfill('0') << value % 1000000 << std::setfill(' ');
+        } else {
+            output << value;
+        }
+        output << '\n';
+    }
+}
+
+Metrics::Timer::Timer(Metrics& metrics, Counter runs, Counter micros)
+  : _metrics(metrics)
+  , _runs(runs)
+  , _micros(micros)
+  , _start(std::chrono::steady_clock::now())
+{}
+
+Metrics::Timer::~Timer()
+{
+    _metrics.add(_runs);
+    _metrics.add(_micros,
+                 static_cast<uint64_t>(
+                   std::chrono::duration_cast<std::chrono::microseconds>(
+                     std::chrono::steady_clock::now() - _start)
+                     .count()));
+}
@@ -0,0 +1,100 @@
+/*
+ * Metrics.h
+ *
+ * Copyright (c) 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef METRICS_H_
+#define METRICS_H_
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Counters shared by all linter-cache processes using the same cache
+// directory. They live in a small file mapped into every process and get
+// updated using lock-free atomics, see export() to feed them to Prometheus
+class Metrics
+{
+public:
+    enum class Counter
+    {
+        // every source checked by Cache::execute()
+        RUNS,
+        HITS,
+        MISSES,
+        FAILURES,
+        RUN_MICROS,
+        // LinterClangTidy::preprocess()
+        PREPROCESS_RUNS,
+        PREPROCESS_MICROS,
+        // every clang-tidy run in LinterClangTidy::execute()
+        LINT_RUNS,
+        LINT_FAILURES,
+        LINT_TIMEOUTS,
+        LINT_RETRIES,
+        LINT_MICROS,
+
+        COUNT
+    };
+
+    // maps the counters stored at the given filepath, creating them
+    Metrics(const std::string& filepath = defaultPath());
+    ~Metrics();
+
+    Metrics(const Metrics&) = delete;
+    Metrics& operator=(const Metrics&) = delete;
+
+    // false when the counters could not be mapped, updates get dropped
+    inline explicit operator bool() const { return _layout != nullptr; }
+
+    void add(Counter counter, uint64_t value = 1);
+    void addSeconds(Counter counter, double seconds);
+    uint64_t get(Counter counter) const;
+
+    // writes all counters in the Prometheus text exposition format
+    void exportText(std::ostream& output) const;
+
+    // the location used when no explicit filepath is given
+    static std::string defaultPath();
+
+    // counts a run and its duration when leaving the scope
+    class Timer
+    {
+    public:
+        Timer(Metrics& metrics, Counter runs, Counter micros);
+        ~Timer();
+
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+
+    private:
+        Metrics& _metrics;
+        Counter _runs;
+        Counter _micros;
+        std::chrono::steady_clock::time_point _start;
+    };
+
+private:
+    struct Layout;
+
+    Layout* _layout;
+};
+
+#endif // METRICS_H_
@@ -0,0 +1,154 @@
+/*
+ * OutputSink.cpp
+ *
+ * Copyright (c) 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "config.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#if LINTER_CACHE_HAVE_CLOSE
+    #include <fcntl.h>
+    #include <unistd.h>
+#else
+    #include <fcntl.h>
+    #include <io.h>
+    #include <sys/stat.h>
+#endif
+
+#include "OutputSink.h"
+
+void
+CaptureSink::write(const char* data, size_t size)
+{
+    _contents.append(data, size);
+}
+
+FdSink::FdSink(int fd)
+  : _fd(fd)
+{}
+
+int
+FdSink::fd() const
+{
+    return _fd;
+}
+
+void
+FdSink::write(const char* data, size_t size)
+{
+    while (size > 0) {
+#if LINTER_CACHE_HAVE_CLOSE
+        const auto written = ::write(_fd, data, size);
+#else
+        const auto written = ::_write(_fd, data, static_cast<unsigned>(size));
+#endif
+        if (written < 0) {
+            if (EINTR == errno) {
+                continue;
+            }
+            throw std::runtime_error(std::string("Failed to write output: ") +
+                                     strerror(errno));
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+}
+
+FileSink::FileSink(const std::string& filename)
+  : FdSink(-1)
+{
+#if LINTER_CACHE_HAVE_CLOSE
+    _fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+#else
+    _fd = _open(filename.c_str(),
+                _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY,
+                _S_IREAD | _S_IWRITE);
+#endif
+    if (_fd < 0) {
+        throw std::runtime_error("Failed to open '" + filename +
+                                 "': " + strerror(errno));
+    }
+}
+
+FileSink::~FileSink()
+{
+#if LINTER_CACHE_HAVE_CLOSE
+    close(_fd);
+#else
+    _close(_fd);
+#endif
+}
+
+TeeSink::TeeSink(OutputSink& first, OutputSink& second)
+  : _first(first)
+  , _second(second)
+{}
+
+void
+TeeSink::write(const char* data, size_t size)
+{
+    _first.write(data, size);
+    _second.write(data, size);
+}
+
+RingBufferSink::RingBufferSink(size_t capacity)
+  : _buffer(capacity)
+  , _start(0)
+  , _size(0)
+  , _discarded(0)
+{}
+
+void
+RingBufferSink::write(const char* data, size_t size)
+{
+    const auto capacity = _buffer.size();
+    if (size >= capacity) {
+        // only the tail of the data survives
+        _discarded += _size + size - capacity;
+        std::copy(data + size - capacity, data + size, _buffer.begin());
+        _start = 0;
+        _size = capacity;
+        return;
+    }
+
+    const auto overflow = std::max(_size + size, capacity) - capacity;
+    _discarded += overflow;
+    _start = (_start + overflow) % capacity;
+    _size -= overflow;
+
+    auto end = (_start + _size) % capacity;
+    const auto first = std::min(size, capacity - end);
+    std::copy(data, data + first, _buffer.begin() + end);
+    std::copy(data + first, data + size, _buffer.begin());
+    _size += size;
+}
+
+std::string
+RingBufferSink::contents() const
+{
+    std::string result;
+    result.reserve(_size);
+    const auto first = std::min(_size, _buffer.size() - _start);
+    result.append(_buffer.data() + _start, first);
+    result.append(_buffer.data(), _size - first);
+    return result;
+}
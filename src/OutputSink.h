@@ -0,0 +1,119 @@
+/*
+ * OutputSink.h
+ *
+ * Copyright (c) 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OUTPUT_SINK_H_
+#define OUTPUT_SINK_H_
+
+#include <string>
+#include <vector>
+
+// Receives the output of a Process as it is produced instead of
+// collecting all of it in memory first
+class OutputSink
+{
+public:
+    virtual ~OutputSink() = default;
+
+    // a descriptor the child may write to directly without passing its
+    // output through us at all, negative when write() needs to be used
+    virtual int fd() const { return -1; }
+
+    virtual void write(const char* data, size_t size) = 0;
+    inline void write(const std::string& data)
+    {
+        write(data.data(), data.size());
+    }
+};
+
+// collects everything in memory
+class CaptureSink : public OutputSink
+{
+public:
+    using OutputSink::write;
+    void write(const char* data, size_t size) override;
+
+    inline const std::string& contents() const { return _contents; }
+
+private:
+    std::string _contents;
+};
+
+// writes to a descriptor owned by someone else, e.g. our own stdout
+class FdSink : public OutputSink
+{
+public:
+    explicit FdSink(int fd);
+
+    int fd() const override;
+    using OutputSink::write;
+    void write(const char* data, size_t size) override;
+
+protected:
+    int _fd;
+};
+
+// truncates and writes the given file, throws when it cannot be opened
+class FileSink : public FdSink
+{
+public:
+    explicit FileSink(const std::string& filename);
+    FileSink(const FileSink&) = delete;
+    FileSink& operator=(const FileSink&) = delete;
+    ~FileSink() override;
+};
+
+// forwards to two other sinks, e.g. the terminal and a capture
+class TeeSink : public OutputSink
+{
+public:
+    TeeSink(OutputSink& first, OutputSink& second);
+
+    using OutputSink::write;
+    void write(const char* data, size_t size) override;
+
+private:
+    OutputSink& _first;
+    OutputSink& _second;
+};
+
+// keeps only the last `capacity` bytes, e.g. the tail of a verbose log
+class RingBufferSink : public OutputSink
+{
+public:
+    explicit RingBufferSink(size_t capacity);
+
+    using OutputSink::write;
+    void write(const char* data, size_t size) override;
+
+    // the bytes kept in the order they were written
+    std::string contents() const;
+
+    // the number of bytes dropped to stay within the capacity
+    inline size_t discarded() const { return _discarded; }
+
+private:
+    std::vector<char> _buffer;
+    size_t _start;
+    size_t _size;
+    size_t _discarded;
+};
+
+#endif // OUTPUT_SINK_H_
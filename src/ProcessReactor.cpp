@@ -0,0 +1,325 @@
+/*
+ * ProcessReactor.cpp
+ *
+ * Copyright (c) 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <array>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include "ProcessReactor.h"
+#include "Logging.h"
+
+#include "config.h"
+
+// mirrors the selection of the wait mechanism in Subprocess_fork.cpp
+#define LINTER_CACHE_REACTOR_EPOLL                                             \
+    (LINTER_CACHE_HAVE_EXECVP && LINTER_CACHE_HAVE_PIDFD_OPEN &&               \
+     LINTER_CACHE_HAVE_EPOLL)
+#define LINTER_CACHE_REACTOR_KQUEUE                                            \
+    (LINTER_CACHE_HAVE_EXECVP && !LINTER_CACHE_HAVE_PIDFD_OPEN &&              \
+     LINTER_CACHE_HAVE_KEVENT)
+
+#if LINTER_CACHE_REACTOR_EPOLL
+    #include <sys/epoll.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#elif LINTER_CACHE_REACTOR_KQUEUE
+    #include <fcntl.h>
+    #include <sys/event.h>
+    #include <unistd.h>
+#endif
+
+static constexpr size_t kMaxEvents = 64;
+
+ProcessReactor::ProcessReactor()
+  : _queue(-1)
+  , _nextId(0)
+{
+#if LINTER_CACHE_REACTOR_EPOLL
+    _queue = epoll_create1(EPOLL_CLOEXEC);
+#elif LINTER_CACHE_REACTOR_KQUEUE
+    _queue = kqueue();
+    if (_queue >= 0) {
+        fcntl(_queue, F_SETFD, FD_CLOEXEC);
+    }
+#endif
+#if LINTER_CACHE_REACTOR_EPOLL || LINTER_CACHE_REACTOR_KQUEUE
+    if (_queue < 0) {
+        throw std::runtime_error(std::string("Failed to create reactor: ") +
+                                 strerror(errno));
+    }
+#endif
+}
+
+ProcessReactor::~ProcessReactor()
+{
+    try {
+        run();
+    } catch (std::exception& e) {
+        LOG(ERROR) << "ProcessReactor: " << e.what();
+    }
+#if LINTER_CACHE_REACTOR_EPOLL || LINTER_CACHE_REACTOR_KQUEUE
+    close(_queue);
+#endif
+}
+
+void
+ProcessReactor::run()
+{
+    while (!_processes.empty()) {
+        dispatch();
+    }
+}
+
+#if LINTER_CACHE_REACTOR_EPOLL || LINTER_CACHE_REACTOR_KQUEUE
+
+static void
+watchFd(int queue, int fd)
+{
+    #if LINTER_CACHE_REACTOR_EPOLL
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    const auto result = epoll_ctl(queue, EPOLL_CTL_ADD, fd, &event);
+    #else
+    struct kevent event;
+    EV_SET(&event, fd, EVFILT_READ, EV_ADD, 0, 0, nullptr);
+    const auto result = kevent(queue, &event, 1, nullptr, 0, nullptr);
+    #endif
+    if (result < 0) {
+        throw std::runtime_error(std::string("Failed to watch fd: ") +
+                                 strerror(errno));
+    }
+}
+
+void
+ProcessReactor::unwatch(int fd)
+{
+    auto it = _fds.find(fd);
+    if (it == _fds.end()) {
+        return;
+    }
+    _fds.erase(it);
+    #if LINTER_CACHE_REACTOR_EPOLL
+    epoll_ctl(_queue, EPOLL_CTL_DEL, fd, nullptr);
+    #else
+    struct kevent event;
+    EV_SET(&event, fd, EVFILT_READ, EV_DELETE, 0, 0, nullptr);
+    kevent(_queue, &event, 1, nullptr, 0, nullptr);
+    #endif
+}
+
+void
+ProcessReactor::start(std::unique_ptr<Process> process, Completion completion)
+{
+    process->start();
+
+    const auto id = _nextId++;
+    Running running;
+    running.process = std::move(process);
+    running.completion = std::move(completion);
+    auto& entry = _processes.emplace(id, std::move(running)).first->second;
+    auto& started = *entry.process;
+
+    try {
+    #if LINTER_CACHE_REACTOR_EPOLL
+        entry.pidFd =
+          static_cast<int>(syscall(SYS_pidfd_open, started._pid, 0));
+        if (entry.pidFd < 0) {
+            throw std::runtime_error(
+              std::string("Failed to obtain fd for pid: ") + strerror(errno));
+        }
+        watchFd(_queue, entry.pidFd);
+        _fds[entry.pidFd] = id;
+    #else
+        struct kevent event;
+        EV_SET(&event,
+               started._pid,
+               EVFILT_PROC,
+               EV_ADD | EV_ONESHOT,
+               NOTE_EXIT,
+               0,
+               nullptr);
+        if (kevent(_queue, &event, 1, nullptr, 0, nullptr) < 0) {
+            throw std::runtime_error(std::string("Failed to watch pid: ") +
+                                     strerror(errno));
+        }
+        _pids[started._pid] = id;
+    #endif
+        for (const auto fd : { started._stdoutFd, started._stderrFd }) {
+            if (fd >= 0) {
+                watchFd(_queue, fd);
+                _fds[fd] = id;
+            }
+        }
+    } catch (std::exception& e) {
+        LOG(ERROR) << "ProcessReactor: " << e.what();
+        // the child is running already, wait for it without reporting
+        entry.completion = nullptr;
+        complete(id);
+        throw ProcessError(started.cmd().join(" "), -1);
+    }
+    LOG(TRACE) << "ProcessReactor: Started " << started.cmd() << " as "
+               << started._pid;
+}
+
+void
+ProcessReactor::complete(int id)
+{
+    auto it = _processes.find(id);
+    if (it == _processes.end()) {
+        return;
+    }
+    auto running = std::move(it->second);
+    _processes.erase(it);
+
+    auto& process = *running.process;
+    unwatch(process._stdoutFd);
+    unwatch(process._stderrFd);
+    if (running.pidFd >= 0) {
+        unwatch(running.pidFd);
+        close(running.pidFd);
+    }
+    _pids.erase(process._pid);
+    process.finish();
+
+    if (running.completion) {
+        running.completion(process);
+    }
+}
+
+void
+ProcessReactor::dispatch(int timeoutMs)
+{
+    size_t completed = 0;
+    while (!_processes.empty() && (completed == 0 || timeoutMs >= 0)) {
+        std::vector<int> exited;
+    #if LINTER_CACHE_REACTOR_EPOLL
+        std::array<struct epoll_event, kMaxEvents> events;
+        const auto count =
+          epoll_wait(_queue, events.data(), events.size(), timeoutMs);
+    #else
+        std::array<struct kevent, kMaxEvents> events;
+        struct timespec timeout = {};
+        timeout.tv_sec = timeoutMs / 1000;
+        timeout.tv_nsec = (timeoutMs % 1000) * 1000000L;
+        const auto count = kevent(_queue,
+                                  nullptr,
+                                  0,
+                                  events.data(),
+                                  events.size(),
+                                  timeoutMs < 0 ? nullptr : &timeout);
+    #endif
+        if (count < 0) {
+            if (EINTR == errno) {
+                continue;
+            }
+            throw std::runtime_error(std::string("Failed to wait: ") +
+                                     strerror(errno));
+        }
+
+        for (int i = 0; i < count; ++i) {
+    #if LINTER_CACHE_REACTOR_EPOLL
+            const auto fd = events[i].data.fd;
+            const bool closed = events[i].events & (EPOLLHUP | EPOLLERR);
+    #else
+            if (events[i].filter == EVFILT_PROC) {
+                auto owner = _pids.find(static_cast<int>(events[i].ident));
+                if (owner != _pids.end()) {
+                    exited.push_back(owner->second);
+                }
+                continue;
+            }
+            const auto fd = static_cast<int>(events[i].ident);
+            const bool closed = events[i].flags & (EV_EOF | EV_ERROR);
+    #endif
+            auto owner = _fds.find(fd);
+            if (owner == _fds.end()) {
+                continue;
+            }
+            auto& running = _processes.at(owner->second);
+            if (fd == running.pidFd) {
+                exited.push_back(owner->second);
+                continue;
+            }
+            running.process->drain();
+            // a pipe closed by the child would report over and over
+            // again until the child exits, stop watching once drained
+            if (closed) {
+                unwatch(fd);
+            }
+        }
+
+        for (const auto id : exited) {
+            complete(id);
+            ++completed;
+        }
+        if (timeoutMs >= 0) {
+            break;
+        }
+    }
+}
+
+#else
+
+// without a way to wait on many children at once
+// run them one after the other when dispatching
+void
+ProcessReactor::start(std::unique_ptr<Process> process, Completion completion)
+{
+    Running running;
+    running.process = std::move(process);
+    running.completion = std::move(completion);
+    _processes.emplace(_nextId++, std::move(running));
+}
+
+void
+ProcessReactor::complete(int id)
+{
+    auto it = _processes.find(id);
+    if (it == _processes.end()) {
+        return;
+    }
+    auto running = std::move(it->second);
+    _processes.erase(it);
+    try {
+        running.process->run();
+    } catch (ProcessError&) {
+        // reported via the exit code
+    }
+    if (running.completion) {
+        running.completion(*running.process);
+    }
+}
+
+void
+ProcessReactor::unwatch(int)
+{}
+
+void
+ProcessReactor::dispatch(int)
+{
+    if (!_processes.empty()) {
+        complete(_processes.begin()->first);
+    }
+}
+
+#endif
@@ -0,0 +1,80 @@
+/*
+ * ProcessReactor.h
+ *
+ * Copyright (c) 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PROCESS_REACTOR_H_
+#define PROCESS_REACTOR_H_
+
+#include <functional>
+#include <map>
+#include <memory>
+
+#include "Subprocess.h"
+
+// Supervises many running processes from a single thread by waiting on
+// their exits and captured outputs at once using epoll or kqueue. On
+// platforms lacking both the processes are run one after the other
+class ProcessReactor
+{
+public:
+    // called once the process exited and all of its output got captured,
+    // check its exitCode() as failures are not reported by throwing
+    using Completion = std::function<void(Process&)>;
+
+    ProcessReactor();
+    ProcessReactor(const ProcessReactor&) = delete;
+    ProcessReactor& operator=(const ProcessReactor&) = delete;
+    // waits for all remaining processes
+    ~ProcessReactor();
+
+    // starts the process, throws a ProcessError when this fails
+    void start(std::unique_ptr<Process> process, Completion completion);
+
+    // the number of processes not completed yet
+    inline size_t running() const { return _processes.size(); }
+
+    // waits up to the given number of milliseconds for events and invokes
+    // the completions of all processes which exited meanwhile. A negative
+    // timeout waits until at least one process completes or none is left
+    void dispatch(int timeoutMs = -1);
+
+    // dispatches until all processes have completed
+    void run();
+
+private:
+    struct Running
+    {
+        std::unique_ptr<Process> process;
+        Completion completion;
+        int pidFd = -1;
+    };
+
+    void complete(int id);
+    void unwatch(int fd);
+
+    int _queue;
+    int _nextId;
+    std::map<int, Running> _processes;
+    // the processes owning a watched fd or pid
+    std::map<int, int> _fds;
+    std::map<int, int> _pids;
+};
+
+#endif // PROCESS_REACTOR_H_
@@ -21,6 +21,7 @@
 
 #include "SavedArguments.h"
 #include "Logging.h"
+#include "Trace.h"
 
 const char* SavedArguments::kDefaultEnvVariable = "LINTER_CACHE_ARGS";
 
@@ -52,6 +53,7 @@ unescapeString(std::string string)
 void
 SavedArguments::save(Environment& env, const char* envVariable)
 {
+    TraceSpan span("save arguments");
     if (!_file) {
         _file = std::make_unique<TemporaryFile>();
     }
@@ -71,7 +73,7 @@ SavedArguments::save(Environment& env, const char* envVariable)
 void
 SavedArguments::load(const Environment& env, const char* envVariable)
 {
-    auto filename = env.get(envVariable);
+    auto filename = env.value(envVariable);
     if (filename.empty()) {
         LOG(TRACE) << "No environment in env: " << envVariable;
         return;
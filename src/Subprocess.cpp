@@ -28,11 +28,88 @@
 
 #include "config.h"
 
-Process::Process(const StringList& cmd, int flags)
+const char* Process::kEnvSpawn = "LINTER_CACHE_SPAWN";
+const char* Process::kEnvPerfCounters = "LINTER_CACHE_PERF_COUNTERS";
+const char* Process::kEnvTimeout = "LINTER_CACHE_TIMEOUT";
+const char* Process::kEnvKillGrace = "LINTER_CACHE_KILL_GRACE";
+const char* Process::kEnvMemoryLimit = "LINTER_CACHE_MEMORY_LIMIT";
+const char* Process::kEnvCpuLimit = "LINTER_CACHE_CPU_LIMIT";
+
+Process::Limits
+Process::Limits::fromEnvironment()
+{
+    Limits limits;
+    limits.timeoutSeconds = Environment::get(kEnvTimeout, 0.0);
+    limits.killGraceSeconds =
+      Environment::get(kEnvKillGrace, limits.killGraceSeconds);
+    limits.memoryBytes =
+      static_cast<long long>(Environment::get(kEnvMemoryLimit, 0)) * 1024 *
+      1024;
+    limits.cpuSeconds = Environment::get(kEnvCpuLimit, 0);
+    return limits;
+}
+
+Process::Process(const StringList& cmd, int flags, const Environment& env)
   : _flags(flags)
   , _cmd(cmd)
+  , _env(env)
+  , _stdoutSink(nullptr)
+  , _stderrSink(nullptr)
   , _exitCode(-1)
+  , _timedOut(false)
+  , _pid(-1)
+  , _stdoutFd(-1)
+  , _stderrFd(-1)
+  , _cyclesFd(-1)
+  , _instructionsFd(-1)
 {}
 
+void
+Process::setOutputSink(OutputSink* sink)
+{
+    _stdoutSink = sink;
+    if (sink) {
+        _flags |= CAPTURE_STDOUT;
+    }
+}
+
+void
+Process::setErrorOutputSink(OutputSink* sink)
+{
+    _stderrSink = sink;
+    if (sink) {
+        _flags |= CAPTURE_STDERR;
+    }
+}
+
+void
+Process::forwardToSinks()
+{
+    if (_stdoutSink) {
+        _stdoutSink->write(_stdout);
+        _stdout.clear();
+    }
+    if (_stderrSink) {
+        _stderrSink->write(_stderr);
+        _stderr.clear();
+    }
+}
+
+std::ostream&
+operator<<(std::ostream& stream, const Process::Usage& usage)
+{
+    stream << "wall " << usage.wallSeconds << "s, user " << usage.userSeconds
+           << "s, sys " << usage.systemSeconds << "s, max rss "
+           << usage.maxResidentKb << "kB, block in " << usage.blockInputs
+           << ", block out " << usage.blockOutputs;
+    if (usage.cycles >= 0) {
+        stream << ", cycles " << usage.cycles;
+    }
+    if (usage.instructions >= 0) {
+        stream << ", instructions " << usage.instructions;
+    }
+    return stream;
+}
+
 // see specific implementations _fork, _popen, _createprocess
 // void Process::run()
@@ -22,9 +22,13 @@
 #ifndef PROCESS_H_
 #define PROCESS_H_
 
+#include <chrono>
+#include <ostream>
 #include <string>
 #include <stdexcept>
 
+#include "Environment.h"
+#include "OutputSink.h"
 #include "StringList.h"
 
 class ProcessError : public std::runtime_error
@@ -52,24 +56,120 @@ public:
         CAPTURE_STDOUT = 0x02
     };
 
-    Process(const StringList& cmd, int = Flags::NONE);
+    // set to "fork" to use fork() instead of posix_spawnp()
+    static const char* kEnvSpawn;
+    // set to count cycles and instructions using perf_event_open()
+    static const char* kEnvPerfCounters;
+    // limits applied to linter children, see Limits::fromEnvironment()
+    static const char* kEnvTimeout;
+    static const char* kEnvKillGrace;
+    static const char* kEnvMemoryLimit;
+    static const char* kEnvCpuLimit;
+
+    // the exit code reported for children which ran out of time
+    static constexpr int kExitTimeout = 124;
+
+    // bounds on the resources of the child, zero means unlimited
+    struct Limits
+    {
+        // wall clock time after which the process group of the child
+        // receives SIGTERM, followed by SIGKILL after the grace period
+        double timeoutSeconds = 0;
+        double killGraceSeconds = 5;
+        // enforced via RLIMIT_AS and RLIMIT_CPU
+        long long memoryBytes = 0;
+        long cpuSeconds = 0;
+
+        // reads the limits configured via kEnvTimeout and friends,
+        // the memory limit is given in MiB
+        static Limits fromEnvironment();
+    };
+
+    // the resources consumed by the child including all of its own
+    // children it waited for, values not supported are left untouched
+    struct Usage
+    {
+        double wallSeconds = 0;
+        double userSeconds = 0;
+        double systemSeconds = 0;
+        long maxResidentKb = 0;
+        long blockInputs = 0;
+        long blockOutputs = 0;
+        long long cycles = -1;
+        long long instructions = -1;
+    };
+
+    // the child inherits the environment of this process merged with `env`
+    Process(const StringList& cmd,
+            int = Flags::NONE,
+            const Environment& env = Environment());
 
     inline const StringList& cmd() const { return _cmd; }
 
+    // the captured outputs, empty when passed to a sink instead
     inline const std::string& output() const { return _stdout; }
 
     inline const std::string& errorOutput() const { return _stderr; }
 
+    // passes the output to `sink` as it gets produced instead of capturing
+    // it, the sink needs to outlive the process
+    void setOutputSink(OutputSink* sink);
+    void setErrorOutputSink(OutputSink* sink);
+
     inline int exitCode() const { return _exitCode; }
 
+    // valid once the child exited
+    inline const Usage& usage() const { return _usage; }
+
+    // the timeout is only enforced by run(), the other limits always
+    inline void setLimits(const Limits& limits) { _limits = limits; }
+
+    // true when the child got terminated because of its timeout
+    inline bool timedOut() const { return _timedOut; }
+
+    // runs the child to completion, throws on a non-zero exit code
     void run();
 
 private:
+    friend class ProcessReactor;
+
+    // the steps of run() for use by a reactor supervising many children,
+    // finish() blocks until the child exited and never throws on failures
+    void start();
+    void drain();
+    void finish();
+
+    // signals the child once its deadline passed, returns the time left
+    // until the next deadline in milliseconds or -1 when there is none
+    int enforceTimeout();
+
+    // hands over outputs captured by backends not supporting sinks natively
+    void forwardToSinks();
+
     int _flags;
     StringList _cmd;
+    Environment _env;
     std::string _stderr;
     std::string _stdout;
+    OutputSink* _stdoutSink;
+    OutputSink* _stderrSink;
     int _exitCode;
+
+    Usage _usage;
+    Limits _limits;
+    bool _timedOut;
+    std::chrono::steady_clock::time_point _started;
+    std::chrono::steady_clock::time_point _deadline;
+
+    // the running child, the pipes of captured streams and its counters
+    int _pid;
+    int _stdoutFd;
+    int _stderrFd;
+    int _cyclesFd;
+    int _instructionsFd;
 };
 
+std::ostream&
+operator<<(std::ostream& stream, const Process::Usage& usage);
+
 #endif // ENVIRONMENT_H_
@@ -155,12 +155,23 @@ struct DrainHelper
     size_t initialSize = 0;
 };
 
+// FILETIME counts 100ns intervals
+static double
+filetime_seconds(const FILETIME& time)
+{
+    ULARGE_INTEGER value;
+    value.LowPart = time.dwLowDateTime;
+    value.HighPart = time.dwHighDateTime;
+    return value.QuadPart / 1e7;
+}
+
 void
 Process::run()
 {
     const auto cmd = "\"" + _cmd.join("\" \"") + "\"";
     _stdout.clear();
     _stderr.clear();
+    _usage = Usage();
 
     if (_cmd.empty()) {
         LOG(ERROR) << "Empty command: '" << cmd << "'";
@@ -222,16 +233,29 @@ Process::run()
         }
     }
 
+    // a block of "KEY=value\0" entries terminated by another '\0'
+    std::string environment;
+    if (!_env.empty()) {
+        for (const auto& entry : _env.merged()) {
+            environment += entry;
+            environment.push_back('\0');
+        }
+        environment.push_back('\0');
+    }
+
     std::vector<char> cmdline(cmd.size() + 1);
     std::memcpy(cmdline.data(), cmd.c_str(), cmd.size());
     cmdline.back() = 0;
+    _started = std::chrono::steady_clock::now();
     auto result = CreateProcessA(file.c_str() /* module */,
                                  cmdline.data() /* cmdline */,
                                  nullptr /* sec attr */,
                                  nullptr /* thread attr */,
                                  TRUE /* inherit handles */,
                                  0 /* creation flags */,
-                                 nullptr /* use our env */,
+                                 environment.empty()
+                                   ? nullptr /* use our env */
+                                   : environment.data(),
                                  nullptr /* use our wkdir */,
                                  &startInfo,
                                  &procInfo);
@@ -274,8 +298,17 @@ Process::run()
 
     DWORD exitCode = 1;
     GetExitCodeProcess(procInfo.hProcess, &exitCode);
+    _usage.wallSeconds = std::chrono::duration<double>(
+                           std::chrono::steady_clock::now() - _started)
+                           .count();
+    FILETIME creation, exit, kernel, user;
+    if (GetProcessTimes(procInfo.hProcess, &creation, &exit, &kernel, &user)) {
+        _usage.userSeconds = filetime_seconds(user);
+        _usage.systemSeconds = filetime_seconds(kernel);
+    }
     CloseHandle(procInfo.hProcess);
     _exitCode = static_cast<int>(exitCode);
+    forwardToSinks();
 
     if (0 != _exitCode) {
         throw ProcessError(cmd, _exitCode);
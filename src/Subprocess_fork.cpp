@@ -24,6 +24,7 @@
 #include <cstring>
 
 #include "Subprocess.h"
+#include "Environment.h"
 #include "Logging.h"
 
 #include "config.h"
@@ -40,219 +41,590 @@
     #include <sys/event.h>
 #endif
 #if LINTER_CACHE_HAVE_EXECVP
+    #include <signal.h>
     #include <unistd.h>
     #include <sys/types.h>
+    #include <sys/resource.h>
     #include <sys/wait.h>
 #endif
+#if LINTER_CACHE_HAVE_POSIX_SPAWNP
+    #include <spawn.h>
+#endif
+#if LINTER_CACHE_HAVE_WAIT4
+    #include <sys/time.h>
+#endif
+#if LINTER_CACHE_HAVE_PERF_EVENT_OPEN
+    #include <sys/syscall.h>
+    #include <linux/perf_event.h>
+#endif
 
-static std::string
-drain_fd(int fd)
-{
-    std::string buffer;
-
-    size_t written = 0;
-    size_t remaining = buffer.size();
+extern char** environ;
 
+// reads everything available without blocking and passes it on in chunks
+static void
+drain_fd(int fd, OutputSink* sink, std::string& captured)
+{
+    std::array<char, 64 * 1024> buffer;
     while (true) {
-        if (remaining <= 0) {
-            buffer.resize(buffer.size() + 512);
-            remaining = buffer.size() - written;
+        auto const actual = read(fd, buffer.data(), buffer.size());
+        if (actual < 0 && EINTR == errno) {
+            continue;
         }
-
-        char* data = buffer.data() + written;
-
-        auto const actual = read(fd, data, remaining);
         if (actual <= 0) {
             break;
         }
+        if (sink) {
+            sink->write(buffer.data(), static_cast<size_t>(actual));
+        } else {
+            captured.append(buffer.data(), static_cast<size_t>(actual));
+        }
+    }
+}
+
+// creates a pipe whose ends are not inherited by the child unless they
+// get duplicated onto one of its standard handles
+static bool
+open_pipe(int fds[2])
+{
+#if LINTER_CACHE_HAVE_PIPE2
+    // atomically, another thread may be spawning a child at the same time
+    return 0 == pipe2(fds, O_CLOEXEC);
+#else
+    if (pipe(fds)) {
+        return false;
+    }
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    return true;
+#endif
+}
 
-        written += actual;
-        remaining -= actual;
+// marks the fd as closed, other threads may reuse its number right away
+static void
+close_fd(int& fd)
+{
+    if (fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+}
+
+static void
+close_pipe(int fds[2])
+{
+    close_fd(fds[0]);
+    close_fd(fds[1]);
+}
+
+// writes a message without touching any state which may
+// have been left locked by another thread at the time of fork()
+static void
+child_fail(const char* message)
+{
+    const auto* const error = strerror(errno);
+    write(STDERR_FILENO, message, strlen(message));
+    write(STDERR_FILENO, error, strlen(error));
+    write(STDERR_FILENO, "\n", 1);
+    _exit(1);
+}
+
+// a child with a timeout gets a process group of its own so that
+// everything it started can be terminated along with it
+static bool
+own_group(const Process::Limits& limits)
+{
+    return limits.timeoutSeconds > 0;
+}
+
+static void
+set_limit(int resource, rlim_t value, rlim_t hard)
+{
+    struct rlimit limit;
+    limit.rlim_cur = value;
+    limit.rlim_max = hard;
+    if (setrlimit(resource, &limit) < 0) {
+        child_fail("Failed to apply resource limit: ");
+    }
+}
+
+static pid_t
+fork_child(const char* file,
+           char* const argv[],
+           char** envp,
+           int stdout_fd,
+           int stderr_fd,
+           const Process::Limits& limits)
+{
+    const auto pid = fork();
+    if (pid == 0) {
+        // Child: Do not use LOG(..) to avoid race with parent!
+        environ = envp;
+        if (own_group(limits)) {
+            setpgid(0, 0);
+        }
+        if (limits.memoryBytes > 0) {
+            const auto bytes = static_cast<rlim_t>(limits.memoryBytes);
+            set_limit(RLIMIT_AS, bytes, bytes);
+        }
+        if (limits.cpuSeconds > 0) {
+            // SIGXCPU first, SIGKILL when the child ignores it
+            const auto seconds = static_cast<rlim_t>(limits.cpuSeconds);
+            set_limit(RLIMIT_CPU, seconds, seconds + 1);
+        }
+        if (stdout_fd >= 0 && stdout_fd != STDOUT_FILENO &&
+            dup2(stdout_fd, STDOUT_FILENO) < 0) {
+            child_fail("Failed to redirect stdout: ");
+        }
+        if (stderr_fd >= 0 && stderr_fd != STDERR_FILENO &&
+            dup2(stderr_fd, STDERR_FILENO) < 0) {
+            child_fail("Failed to redirect stderr: ");
+        }
+        execvp(file, argv);
+        child_fail("Failed to exec cmd: ");
+    }
+    if (pid < 0) {
+        LOG(ERROR) << "Error forking child process: " << strerror(errno);
+    } else if (own_group(limits)) {
+        // also from the parent to not race against signalling the group
+        setpgid(pid, pid);
+    }
+    return pid;
+}
+
+#if LINTER_CACHE_HAVE_POSIX_SPAWNP
+
+static pid_t
+spawn_child(const char* file,
+            char* const argv[],
+            char** envp,
+            int stdout_fd,
+            int stderr_fd,
+            const Process::Limits& limits)
+{
+    posix_spawnattr_t attributes;
+    posix_spawnattr_init(&attributes);
+    if (own_group(limits)) {
+        posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETPGROUP);
+        posix_spawnattr_setpgroup(&attributes, 0);
+    }
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    // duplicating a descriptor onto itself is not portable, skip it
+    if (stdout_fd >= 0 && stdout_fd != STDOUT_FILENO) {
+        posix_spawn_file_actions_adddup2(&actions, stdout_fd, STDOUT_FILENO);
+    }
+    if (stderr_fd >= 0 && stderr_fd != STDERR_FILENO) {
+        posix_spawn_file_actions_adddup2(&actions, stderr_fd, STDERR_FILENO);
+    }
+
+    pid_t pid = -1;
+    const auto error =
+      posix_spawnp(&pid, file, &actions, &attributes, argv, envp);
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attributes);
+    if (error) {
+        LOG(ERROR) << "Error spawning child process: " << strerror(error);
+        return -1;
+    }
+    return pid;
+}
+
+#endif
+
+static std::chrono::steady_clock::duration
+to_duration(double seconds)
+{
+    return std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+      std::chrono::duration<double>(seconds));
+}
+
+// reaches children started by the child as well when it got its own group
+static void
+signal_group(pid_t pid, int signal)
+{
+    if (kill(-pid, signal) < 0 && kill(pid, signal) < 0) {
+        LOG(WARNING) << "Failed to signal " << pid << ": " << strerror(errno);
+    }
+}
+
+// counts a hardware event in userspace of pid and all its children
+static int
+open_counter(pid_t pid, uint64_t event)
+{
+#if LINTER_CACHE_HAVE_PERF_EVENT_OPEN
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = event;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    const auto fd = static_cast<int>(syscall(
+      SYS_perf_event_open, &attr, pid, -1, -1, PERF_FLAG_FD_CLOEXEC));
+    if (fd < 0) {
+        LOG(TRACE) << "Failed to open perf counter: " << strerror(errno);
+    }
+    return fd;
+#else
+    (void)pid;
+    (void)event;
+    return -1;
+#endif
+}
+
+static long long
+read_counter(int& fd)
+{
+    long long value = -1;
+    if (fd >= 0) {
+        uint64_t count = 0;
+        if (sizeof(count) == read(fd, &count, sizeof(count))) {
+            value = static_cast<long long>(count);
+        }
+        close(fd);
+        fd = -1;
     }
-    buffer.resize(written);
-    return buffer;
+    return value;
 }
 
 void
-Process::run()
+Process::start()
 {
     const auto cmd = _cmd.join(" ");
     _stdout.clear();
     _stderr.clear();
+    _exitCode = -1;
+    _usage = Usage();
+    _timedOut = false;
 
     if (_cmd.empty()) {
         LOG(ERROR) << "Empty command: '" << cmd << "'";
         throw ProcessError(cmd, -1);
     }
 
-    int stdout_fd[2];
-    if (pipe(stdout_fd)) {
+    // sinks with a descriptor get handed to the child directly, other
+    // streams being captured get a pipe and the rest is inherited
+    const int stdout_sink = _stdoutSink ? _stdoutSink->fd() : -1;
+    int stdout_fd[2] = { -1, -1 };
+    if (0 != (_flags & Process::CAPTURE_STDOUT) && stdout_sink < 0 &&
+        !open_pipe(stdout_fd)) {
         LOG(ERROR) << "Failed to prepare stdout pipe: " << strerror(errno);
         throw ProcessError(cmd, -1);
     }
 
-    int stderr_fd[2];
-    if (pipe(stderr_fd)) {
+    const int stderr_sink = _stderrSink ? _stderrSink->fd() : -1;
+    int stderr_fd[2] = { -1, -1 };
+    if (0 != (_flags & Process::CAPTURE_STDERR) && stderr_sink < 0 &&
+        !open_pipe(stderr_fd)) {
         LOG(ERROR) << "Failed to prepare stderr pipe: " << strerror(errno);
+        close_pipe(stdout_fd);
         throw ProcessError(cmd, -1);
     }
+    const int child_stdout = stdout_sink >= 0 ? stdout_sink : stdout_fd[1];
+    const int child_stderr = stderr_sink >= 0 ? stderr_sink : stderr_fd[1];
 
     const auto* const file = _cmd[0].c_str();
     std::vector<char*> argv;
-    argv.reserve(_cmd.size());
+    argv.reserve(_cmd.size() + 1);
     for (size_t i = 0; i < _cmd.size(); ++i) {
         argv.push_back(const_cast<char*>(_cmd[i].c_str()));
     }
     argv.push_back(nullptr);
-
-    const auto pid = fork();
+    _started = std::chrono::steady_clock::now();
+    _deadline = _started + to_duration(_limits.timeoutSeconds);
+
+    // only build a dedicated environment when there is anything to change
+    StringList environment;
+    std::vector<char*> envp;
+    if (!_env.empty()) {
+        environment = _env.merged();
+        envp.reserve(environment.size() + 1);
+        for (auto& entry : environment) {
+            envp.push_back(entry.data());
+        }
+        envp.push_back(nullptr);
+    }
+    auto** const child_env = envp.empty() ? environ : envp.data();
+
+#if LINTER_CACHE_HAVE_POSIX_SPAWNP
+    // posix_spawnp() avoids copying the page tables of the parent,
+    // keep plain fork() around to allow for comparisons and for
+    // resource limits which need to be applied before exec()
+    const bool use_fork = ("fork" == Environment::get(kEnvSpawn)) ||
+                          _limits.memoryBytes > 0 || _limits.cpuSeconds > 0;
+    const auto pid = use_fork ? fork_child(file,
+                                           argv.data(),
+                                           child_env,
+                                           child_stdout,
+                                           child_stderr,
+                                           _limits)
+                              : spawn_child(file,
+                                            argv.data(),
+                                            child_env,
+                                            child_stdout,
+                                            child_stderr,
+                                            _limits);
+#else
+    const auto pid = fork_child(
+      file, argv.data(), child_env, child_stdout, child_stderr, _limits);
+#endif
     if (pid < 0) {
-        LOG(ERROR) << "Error forking child process: " << strerror(errno);
+        close_pipe(stdout_fd);
+        close_pipe(stderr_fd);
         throw ProcessError(cmd, -1);
     }
-    if (pid == 0) {
-        // Child: Do not use LOG(..) to avoid race with parent!
 
-        if (0 != (_flags & Process::CAPTURE_STDOUT)) {
-            if (dup2(stdout_fd[1], STDOUT_FILENO) < 0) {
-                std::cerr << "Failed to redirect stdout: " << strerror(errno)
-                          << std::endl;
-                exit(1);
-            }
-        }
-        if (0 != (_flags & Process::CAPTURE_STDERR)) {
-            if (dup2(stderr_fd[1], STDERR_FILENO) < 0) {
-                std::cerr << "Failed to redirect stderr: " << strerror(errno)
-                          << std::endl;
-                exit(1);
-            }
-        }
-
-        if (execvp(file, argv.data()) < 0) {
-            std::cerr << "Failed to exec cmd: " << strerror(errno) << std::endl;
-            exit(1);
-        }
-        exit(0);
-    } else {
-        // Parent: Wait on child
-        close(stdout_fd[1]);
-        close(stderr_fd[1]);
+    // Parent: Keep the reading ends only
+    close_fd(stdout_fd[1]);
+    close_fd(stderr_fd[1]);
 
-        // Use fds as nonblocking
+    // Use fds as nonblocking
+    if (stdout_fd[0] >= 0) {
         fcntl(stdout_fd[0], F_SETFL, O_NONBLOCK);
+    }
+    if (stderr_fd[0] >= 0) {
         fcntl(stderr_fd[0], F_SETFL, O_NONBLOCK);
+    }
 
-        // Helper to drain all outputs
-        auto drain_fds = [&] {
-            if (0 != (_flags & Process::CAPTURE_STDERR)) {
-                // pull everything from stderr
-                _stderr += drain_fd(stderr_fd[0]);
-            }
-            if (0 != (_flags & Process::CAPTURE_STDOUT)) {
-                // pull everything from stdout
-                _stdout += drain_fd(stdout_fd[0]);
-            }
-        };
+    _pid = pid;
+    _stdoutFd = stdout_fd[0];
+    _stderrFd = stderr_fd[0];
+
+    // attached after the spawn, so the counters miss the exec itself
+    if (Environment::get(kEnvPerfCounters, 0) != 0) {
+#if LINTER_CACHE_HAVE_PERF_EVENT_OPEN
+        _cyclesFd = open_counter(pid, PERF_COUNT_HW_CPU_CYCLES);
+        _instructionsFd = open_counter(pid, PERF_COUNT_HW_INSTRUCTIONS);
+#else
+        LOG(TRACE) << "Performance counters are not supported";
+#endif
+    }
+}
+
+void
+Process::drain()
+{
+    if (_stderrFd >= 0) {
+        // pull everything from stderr
+        drain_fd(_stderrFd, _stderrSink, _stderr);
+    }
+    if (_stdoutFd >= 0) {
+        // pull everything from stdout
+        drain_fd(_stdoutFd, _stdoutSink, _stdout);
+    }
+}
+
+void
+Process::finish()
+{
+    // wait on this specific child, others may be run by other threads
+    int exitcode = -1;
+    pid_t waited = -1;
+#if LINTER_CACHE_HAVE_WAIT4
+    struct rusage usage;
+    memset(&usage, 0, sizeof(usage));
+    do {
+        waited = wait4(_pid, &exitcode, 0, &usage);
+    } while (waited < 0 && EINTR == errno);
+#else
+    do {
+        waited = waitpid(_pid, &exitcode, 0);
+    } while (waited < 0 && EINTR == errno);
+#endif
+    _usage.wallSeconds = std::chrono::duration<double>(
+                           std::chrono::steady_clock::now() - _started)
+                           .count();
+    drain();
+    close_fd(_stdoutFd);
+    close_fd(_stderrFd);
+    _usage.cycles = read_counter(_cyclesFd);
+    _usage.instructions = read_counter(_instructionsFd);
+
+    if (waited != _pid) {
+        LOG(ERROR) << "Failed to wait on child: " << strerror(errno);
+    } else if (WIFEXITED(exitcode)) {
+        _exitCode = WEXITSTATUS(exitcode);
+    } else if (WIFSIGNALED(exitcode)) {
+        // report signals the way shells do
+        _exitCode = 128 + WTERMSIG(exitcode);
+    }
+    if (_timedOut) {
+        _exitCode = kExitTimeout;
+    }
+#if LINTER_CACHE_HAVE_WAIT4
+    if (waited == _pid) {
+        _usage.userSeconds =
+          usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6;
+        _usage.systemSeconds =
+          usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+    #if defined(__APPLE__)
+        // reported in bytes instead of kilobytes
+        _usage.maxResidentKb = usage.ru_maxrss / 1024;
+    #else
+        _usage.maxResidentKb = usage.ru_maxrss;
+    #endif
+        _usage.blockInputs = usage.ru_inblock;
+        _usage.blockOutputs = usage.ru_oublock;
+    }
+#endif
+    _pid = -1;
+}
+
+int
+Process::enforceTimeout()
+{
+    if (_limits.timeoutSeconds <= 0 || _pid < 0) {
+        return -1;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    if (now >= _deadline) {
+        if (!_timedOut) {
+            LOG(WARNING) << "Process " << _pid << " timed out after "
+                         << _limits.timeoutSeconds << "s, terminating";
+            signal_group(_pid, SIGTERM);
+            _timedOut = true;
+            _deadline = now + to_duration(_limits.killGraceSeconds);
+        } else {
+            LOG(WARNING) << "Process " << _pid << " ignored SIGTERM, killing";
+            signal_group(_pid, SIGKILL);
+            _deadline = std::chrono::steady_clock::time_point::max();
+        }
+    }
+    if (_deadline == std::chrono::steady_clock::time_point::max()) {
+        return -1;
+    }
+    // round up to not wake up right before the deadline
+    return static_cast<int>(
+             std::chrono::duration_cast<std::chrono::milliseconds>(_deadline -
+                                                                   now)
+               .count()) +
+           1;
+}
+
+void
+Process::run()
+{
+    start();
+    const auto cmd = _cmd.join(" ");
 
 #if LINTER_CACHE_HAVE_PIDFD_OPEN
 
-        auto pid_fd = static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
-        if (pid_fd < 0) {
-            LOG(ERROR) << "Failed to obtain fd for pid: " << strerror(errno);
-            throw ProcessError(cmd, -1);
+    auto pid_fd = static_cast<int>(syscall(SYS_pidfd_open, _pid, 0));
+    if (pid_fd < 0) {
+        LOG(ERROR) << "Failed to obtain fd for pid: " << strerror(errno);
+        finish();
+        throw ProcessError(cmd, -1);
+    }
+
+    // poll() ignores negative fds of streams not being captured
+    std::array<struct pollfd, 3> polls;
+    polls[0].fd = pid_fd;
+    polls[1].fd = _stdoutFd;
+    polls[2].fd = _stderrFd;
+
+    bool child_alive = true;
+    while (child_alive) {
+        for (auto& entry : polls) {
+            entry.events = POLLIN;
+            entry.revents = 0;
         }
 
-        bool child_alive = true;
-        while (child_alive) {
-            std::array<struct pollfd, 3> polls;
-            polls[0].fd = pid_fd;
-            polls[0].events = POLLIN;
-            polls[0].revents = 0;
-            polls[1].fd = stdout_fd[0];
-            polls[1].events = POLLIN;
-            polls[1].revents = 0;
-            polls[2].fd = stderr_fd[0];
-            polls[2].events = POLLIN;
-            polls[2].revents = 0;
-
-            const auto idx = poll(polls.data(), polls.size(), -1);
-            if (idx < 0) {
-                if (EINTR == errno) {
-                    continue;
-                }
-                child_alive = false;
+        const auto idx = poll(polls.data(), polls.size(), enforceTimeout());
+        if (idx < 0) {
+            if (EINTR == errno) {
+                continue;
             }
-            if (polls[0].revents & POLLIN) {
-                child_alive = false;
+            child_alive = false;
+        }
+        if (polls[0].revents & POLLIN) {
+            child_alive = false;
+        }
+        drain();
+
+        // a pipe closed by the child would wake us up over and over
+        // again while waiting for it to exit, stop polling once drained
+        for (size_t i = 1; i < polls.size(); ++i) {
+            if (polls[i].revents & (POLLHUP | POLLERR)) {
+                polls[i].fd = -1;
             }
-            drain_fds();
         }
+    }
 
-        close(pid_fd);
+    close(pid_fd);
 
 #elif LINTER_CACHE_HAVE_KEVENT
 
-        std::array<struct kevent, 3> events;
-        EV_SET(&events[0],
-               pid,
-               EVFILT_PROC,
-               EV_ENABLE | EV_ADD | EV_CLEAR,
-               NOTE_EXIT,
-               0,
-               nullptr);
-        EV_SET(&events[1], stderr_fd[0], EVFILT_READ, EV_ADD, 0, 0, nullptr);
-        EV_SET(&events[2], stdout_fd[0], EVFILT_READ, EV_ADD, 0, 0, nullptr);
-
-        int kq = kqueue();
-        if (kq < 0) {
-            LOG(ERROR) << "Failed to create kqueue: " << strerror(errno);
+    std::array<struct kevent, 3> events;
+    size_t num_events = 0;
+    EV_SET(&events[num_events++],
+           _pid,
+           EVFILT_PROC,
+           EV_ENABLE | EV_ADD | EV_CLEAR,
+           NOTE_EXIT,
+           0,
+           nullptr);
+    if (_stderrFd >= 0) {
+        EV_SET(
+          &events[num_events++], _stderrFd, EVFILT_READ, EV_ADD, 0, 0, nullptr);
+    }
+    if (_stdoutFd >= 0) {
+        EV_SET(
+          &events[num_events++], _stdoutFd, EVFILT_READ, EV_ADD, 0, 0, nullptr);
+    }
+
+    int kq = kqueue();
+    if (kq < 0) {
+        LOG(ERROR) << "Failed to create kqueue: " << strerror(errno);
+        finish();
+        throw ProcessError(cmd, -1);
+    }
+
+    std::array<struct kevent, events.size()> tevents;
+    bool child_alive = true;
+    while (child_alive) {
+        const auto wait = enforceTimeout();
+        struct timespec timeout;
+        timeout.tv_sec = wait / 1000;
+        timeout.tv_nsec = (wait % 1000) * 1000000L;
+        auto nev = kevent(kq,
+                          events.data(),
+                          static_cast<int>(num_events),
+                          tevents.data(),
+                          tevents.size(),
+                          wait < 0 ? nullptr : &timeout);
+        if (nev < 0) {
+            LOG(ERROR) << "Failed to wait on kqueue: " << strerror(errno);
+            close(kq);
+            finish();
             throw ProcessError(cmd, -1);
         }
-
-        std::array<struct kevent, events.size()> tevents;
-        bool child_alive = true;
-        while (child_alive) {
-            auto nev = kevent(kq,
-                              events.data(),
-                              events.size(),
-                              tevents.data(),
-                              tevents.size(),
-                              nullptr);
-            if (nev < 0) {
-                LOG(ERROR) << "Failed to wait on kqueue: " << strerror(errno);
+        drain();
+        for (int i = 0; i < nev; ++i) {
+            if (tevents[i].flags & EV_ERROR) {
+                LOG(ERROR) << "Error in kqueue: "
+                           << strerror(static_cast<int>(tevents[i].data));
+                close(kq);
+                finish();
                 throw ProcessError(cmd, -1);
             }
-            drain_fds();
-            for (int i = 0; i < nev; ++i) {
-                if (tevents[i].flags & EV_ERROR) {
-                    LOG(ERROR) << "Error in kqueue: "
-                               << strerror(static_cast<int>(tevents[i].data));
-                    throw ProcessError(cmd, -1);
-                }
-                if (tevents[i].ident == pid) {
-                    // break when the child has ended
-                    child_alive = false;
-                    break;
-                }
+            if (tevents[i].ident == static_cast<uintptr_t>(_pid)) {
+                // break when the child has ended
+                child_alive = false;
+                break;
             }
         }
+    }
+    close(kq);
 
 #else
     #error "Need either pidfd_open() or kevent() support"
 
 #endif
-        int exitcode = -1;
-        if (wait(&exitcode) == pid) {
-            drain_fds();
-
-            close(stdout_fd[0]);
-            close(stderr_fd[0]);
-
-            if (WIFEXITED(exitcode) && WEXITSTATUS(exitcode) == EXIT_SUCCESS) {
-                // all good
-            } else {
-                throw ProcessError(cmd, WEXITSTATUS(exitcode));
-            }
-        }
+    finish();
+    if (_exitCode != EXIT_SUCCESS) {
+        throw ProcessError(cmd, _exitCode);
     }
 }
@@ -52,13 +52,19 @@ Process::run()
     const auto cmd = _cmd.join(" ");
     _stdout.clear();
     _stderr.clear();
+    _usage = Usage();
 
     if (_cmd.empty()) {
         LOG(ERROR) << "Empty command: '" << cmd << "'";
         throw ProcessError(cmd, -1);
     }
 
+    // popen() offers no way to pass an environment, modify our own instead
+    Environment env(_env);
+    env.apply();
+    _started = std::chrono::steady_clock::now();
     auto* stdoutHandle = popen(cmd.c_str(), "r");
+    env.reset();
     if (nullptr == stdoutHandle) {
         throw ProcessError(cmd, -1);
     }
@@ -78,6 +84,11 @@ Process::run()
         std::cout << buffer.data() << std::flush;
     }
     _exitCode = pclose(stdoutHandle);
+    // only the wall time is known without access to the child
+    _usage.wallSeconds = std::chrono::duration<double>(
+                           std::chrono::steady_clock::now() - _started)
+                           .count();
+    forwardToSinks();
     if (0 != _exitCode) {
         throw ProcessError(cmd, _exitCode);
     }
@@ -26,6 +26,7 @@
 #include <array>
 #include <vector>
 #include <exception>
+#include <stdexcept>
 #if LINTER_CACHE_HAVE_GETPID
     #include <sys/types.h>
     #include <unistd.h>
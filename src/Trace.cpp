@@ -0,0 +1,227 @@
+/*
+ * Trace.cpp
+ *
+ * Copyright (c) 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <sstream>
+#include <thread>
+
+#include "config.h"
+
+#if LINTER_CACHE_HAVE_OPEN
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+#include "Environment.h"
+#include "Logging.h"
+#include "MappedFile.h"
+#include "Trace.h"
+#include "Util.h"
+
+const char* Trace::kEnvTrace = "LINTER_CACHE_TRACE";
+const char* Trace::kSaveCorrelation = "traceCorrelation";
+
+static constexpr char kSuffix[] = ".trace.json";
+
+static std::string
+escape(const std::string& value)
+{
+    std::string escaped;
+    escaped.reserve(value.size());
+    for (const auto c : value) {
+        if ('"' == c || '\\' == c) {
+            escaped += '\\';
+            escaped += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char code[8];
+            std::snprintf(code, sizeof(code), "\\u%04x", c);
+            escaped += code;
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+// small numbers read better in the timeline than hashed thread ids
+static int
+thread_number()
+{
+    static std::atomic<int> s_next{ 1 };
+    thread_local const int number = s_next++;
+    return number;
+}
+
+Trace&
+Trace::defaultInstance()
+{
+    static Trace s_instance(Environment::get(kEnvTrace));
+    return s_instance;
+}
+
+Trace::Trace(const std::string& dirpath)
+  : _fd(-1)
+{
+    if (dirpath.empty()) {
+        return;
+    }
+#if LINTER_CACHE_HAVE_OPEN
+    Util::make_dirs(dirpath);
+    // pids get reused during long builds, appending keeps both
+    const auto path =
+      dirpath + "/" + std::to_string(Util::process_id()) + kSuffix;
+    _fd = open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    if (_fd < 0) {
+        LOG(WARNING) << "Failed to open trace '" << path << "'";
+    }
+#else
+    LOG(WARNING) << "Tracing is not supported on this platform";
+#endif
+}
+
+Trace::~Trace()
+{
+#if LINTER_CACHE_HAVE_OPEN
+    if (_fd >= 0) {
+        close(_fd);
+    }
+#endif
+}
+
+void
+Trace::write(const std::string& event)
+{
+#if LINTER_CACHE_HAVE_OPEN
+    // one event per line and write so that threads never interleave
+    const auto line = event + ",\n";
+    if (::write(_fd, line.data(), line.size()) < 0) {
+        LOG(WARNING) << "Failed to write trace event";
+    }
+#else
+    (void)event;
+#endif
+}
+
+void
+Trace::setProcessName(const std::string& name)
+{
+    if (!enabled()) {
+        return;
+    }
+    std::ostringstream event;
+    event << R"({"name":"process_name","ph":"M","pid":)"
+          << Util::process_id() << R"(,"tid":0,"args":{"name":")"
+          << escape(name) << R"("}})";
+    write(event.str());
+}
+
+std::string
+Trace::newCorrelation()
+{
+    static std::atomic<unsigned> s_serial{ 0 };
+    return std::to_string(Util::process_id()) + "-" +
+           std::to_string(now()) + "-" + std::to_string(s_serial++);
+}
+
+void
+Trace::complete(const char* name,
+                int64_t startUs,
+                int64_t durationUs,
+                const std::string& detail)
+{
+    if (!enabled()) {
+        return;
+    }
+    std::ostringstream event;
+    event << R"({"name":")" << name << R"(","cat":"linter-cache","ph":"X")"
+          << R"(,"ts":)" << startUs << R"(,"dur":)" << durationUs
+          << R"(,"pid":)" << Util::process_id() << R"(,"tid":)"
+          << thread_number() << R"(,"args":{"correlation":")"
+          << escape(_correlation) << '"';
+    if (!detail.empty()) {
+        event << R"(,"detail":")" << escape(detail) << '"';
+    }
+    event << "}}";
+    write(event.str());
+}
+
+int64_t
+Trace::now()
+{
+    // wall clock time so that the processes line up
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+size_t
+Trace::merge(const std::string& dirpath, std::ostream& output)
+{
+    static constexpr size_t kSuffixSize = sizeof(kSuffix) - 1;
+
+    size_t merged = 0;
+    bool first = true;
+    output << "{\"traceEvents\":[\n";
+    for (const auto& name : Util::list_dir(dirpath)) {
+        if (name.size() <= kSuffixSize ||
+            0 != name.compare(name.size() - kSuffixSize, kSuffixSize, kSuffix)) {
+            continue;
+        }
+        MappedFile file(dirpath + "/" + name);
+        if (!file) {
+            continue;
+        }
+        ++merged;
+
+        // every complete line is an event followed by a comma
+        const std::string contents(file.data(), file.size());
+        size_t begin = 0;
+        for (auto end = contents.find('\n'); end != std::string::npos;
+             begin = end + 1, end = contents.find('\n', begin)) {
+            if (end - begin < 2 || '{' != contents[begin] ||
+                ',' != contents[end - 1]) {
+                continue;
+            }
+            output << (first ? "" : ",\n");
+            output.write(contents.data() + begin,
+                         static_cast<std::streamsize>(end - begin - 1));
+            first = false;
+        }
+    }
+    output << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    return merged;
+}
+
+TraceSpan::TraceSpan(const char* name, std::string detail)
+  : _name(name)
+  , _detail(std::move(detail))
+  , _start(Trace::defaultInstance().enabled() ? Trace::now() : 0)
+{}
+
+TraceSpan::~TraceSpan()
+{
+    auto& trace = Trace::defaultInstance();
+    if (trace.enabled()) {
+        trace.complete(_name, _start, Trace::now() - _start, _detail);
+    }
+}
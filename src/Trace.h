@@ -0,0 +1,91 @@
+/*
+ * Trace.h
+ *
+ * Copyright (c) 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Writes spans in the trace event format understood by chrome://tracing
+// and Perfetto when `LINTER_CACHE_TRACE` names a directory. Every process
+// appends to a file of its own, use merge() to get a single timeline
+class Trace
+{
+public:
+    static const char* kEnvTrace;
+    // the key used to pass the correlation id via SavedArguments
+    static const char* kSaveCorrelation;
+
+    static Trace& defaultInstance();
+
+    // traces to dirpath, stays disabled when empty
+    explicit Trace(const std::string& dirpath);
+    Trace(const Trace&) = delete;
+    Trace& operator=(const Trace&) = delete;
+    ~Trace();
+
+    inline bool enabled() const { return _fd >= 0; }
+
+    // names this process in the timeline
+    void setProcessName(const std::string& name);
+
+    // identifies all spans of all processes working on the same source
+    inline void setCorrelation(const std::string& id) { _correlation = id; }
+    inline const std::string& correlation() const { return _correlation; }
+    static std::string newCorrelation();
+
+    // appends a complete event, times are microseconds since the epoch
+    void complete(const char* name,
+                  int64_t startUs,
+                  int64_t durationUs,
+                  const std::string& detail);
+
+    static int64_t now();
+
+    // writes the traces of all processes found in dirpath as one JSON
+    // document, returns the number of files merged
+    static size_t merge(const std::string& dirpath, std::ostream& output);
+
+private:
+    void write(const std::string& event);
+
+    int _fd;
+    std::string _correlation;
+};
+
+// records the time until leaving the scope as a span
+class TraceSpan
+{
+public:
+    explicit TraceSpan(const char* name, std::string detail = std::string());
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+    ~TraceSpan();
+
+private:
+    const char* _name;
+    std::string _detail;
+    int64_t _start;
+};
+
+#endif // TRACE_H_
@@ -21,11 +21,15 @@
 
 #include <vector>
 #include <climits>
+#include <cstdio>
 #include <cstdlib>
 
 #include "config.h"
 
 #include "Util.h"
+#include "Environment.h"
+#include "StringList.h"
+#include "Trace.h"
 
 #if LINTER_CACHE_HAVE_GET_FILE_ATTRIBUTES
     #define WIN32_LEAN_AND_MEAN
@@ -35,6 +39,21 @@
     #include <sys/stat.h>
     #include <unistd.h>
 #endif
+#if LINTER_CACHE_HAVE_MKDIR
+    #include <sys/stat.h>
+    #include <cerrno>
+#endif
+#if LINTER_CACHE_HAVE_OPENDIR
+    #include <dirent.h>
+#endif
+#if LINTER_CACHE_HAVE_GETCWD || LINTER_CACHE_HAVE_GETPID
+    #include <unistd.h>
+#endif
+#if LINTER_CACHE_HAVE_GET_CURRENT_PROCESS_ID &&                                \
+  !LINTER_CACHE_HAVE_GET_FILE_ATTRIBUTES
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#endif
 
 bool
 Util::is_file(const std::string& filepath)
@@ -90,6 +109,112 @@ Util::resolve_path(const std::string& filepath)
 #endif
 }
 
+bool
+Util::file_info(const std::string& filepath, FileInfo& info)
+{
+#if LINTER_CACHE_HAVE_GET_FILE_ATTRIBUTES
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesExA(filepath.c_str(), GetFileExInfoStandard, &data)) {
+        return false;
+    }
+    info.size = (static_cast<uint64_t>(data.nFileSizeHigh) << 32) |
+                data.nFileSizeLow;
+    // FILETIME is given in 100ns intervals
+    info.mtime = static_cast<int64_t>(
+      ((static_cast<uint64_t>(data.ftLastWriteTime.dwHighDateTime) << 32) |
+       data.ftLastWriteTime.dwLowDateTime) *
+      100);
+    info.inode = 0;
+    info.device = 0;
+    return true;
+#elif LINTER_CACHE_HAVE_STAT
+    struct stat result;
+    if (0 != stat(filepath.c_str(), &result)) {
+        return false;
+    }
+    info.size = static_cast<uint64_t>(result.st_size);
+    #if __APPLE__
+    info.mtime = static_cast<int64_t>(result.st_mtimespec.tv_sec) *
+                   1000000000LL +
+                 result.st_mtimespec.tv_nsec;
+    #else
+    info.mtime = static_cast<int64_t>(result.st_mtim.tv_sec) * 1000000000LL +
+                 result.st_mtim.tv_nsec;
+    #endif
+    info.inode = static_cast<uint64_t>(result.st_ino);
+    info.device = static_cast<uint64_t>(result.st_dev);
+    return true;
+#else
+    #error "Cannot stat on this platform"
+#endif
+}
+
+std::string
+Util::normalize_path(const std::string& filepath)
+{
+    // fast path for paths which are normalized already
+    if (!filepath.empty() && '/' == filepath.front() &&
+        std::string::npos == filepath.find("/.") &&
+        std::string::npos == filepath.find("//") &&
+        std::string::npos == filepath.find('\\') && '/' != filepath.back()) {
+        return filepath;
+    }
+
+    std::string input = replace_all(filepath, "\\", "/");
+    const auto isAbsolute =
+      (!input.empty() && '/' == input.front()) ||
+      (input.size() > 1 && ':' == input[1]);
+    if (!isAbsolute) {
+#if LINTER_CACHE_HAVE_GETCWD
+        std::vector<char> buffer(PATH_MAX);
+        if (getcwd(buffer.data(), buffer.size())) {
+            input = std::string(buffer.data()) + "/" + input;
+        }
+#elif LINTER_CACHE_HAVE_GET_FILE_ATTRIBUTES
+        std::vector<char> buffer(MAX_PATH);
+        auto len = GetCurrentDirectoryA(buffer.size(), buffer.data());
+        if (len > 0 && len < buffer.size()) {
+            input = replace_all(std::string(buffer.data(), len), "\\", "/") +
+                    "/" + input;
+        }
+#else
+    #error "Cannot determine the working directory on this platform"
+#endif
+    }
+
+    // keep any drive letter or leading slash and collapse the rest
+    std::string prefix;
+    if (input.size() > 1 && ':' == input[1]) {
+        prefix = input.substr(0, 2);
+        input = input.substr(2);
+    }
+    std::vector<std::string> components;
+    size_t start = 0;
+    while (start <= input.size()) {
+        auto end = input.find('/', start);
+        if (std::string::npos == end) {
+            end = input.size();
+        }
+        const auto component = input.substr(start, end - start);
+        if (component.empty() || "." == component) {
+            // skip
+        } else if (".." == component) {
+            if (!components.empty()) {
+                components.pop_back();
+            }
+        } else {
+            components.push_back(component);
+        }
+        start = end + 1;
+    }
+
+    std::string out = prefix;
+    for (const auto& component : components) {
+        out += "/" + component;
+    }
+    return out.empty() ? "/" : out;
+}
+
 std::string
 Util::replace_all(std::string input,
                   const std::string& old_value,
@@ -107,6 +232,7 @@ std::string
 Util::find_applicable_config(const std::string& conf_name,
                              const std::string& filepath)
 {
+    TraceSpan span("find config", filepath);
     const auto input = resolve_path(filepath);
     auto end = input.find_last_of("/\\");
     while (end > 0 && end != std::string::npos) {
@@ -122,5 +248,171 @@ Util::find_applicable_config(const std::string& conf_name,
 std::string
 Util::preproc_file_header(const std::string& filepath)
 {
-    return "\n# 1 \"" + filepath + "\" 1\n";
+    // escape the same way compilers do so that the marker can be parsed
+    auto escaped = replace_all(filepath, "\\", "\\\\");
+    escaped = replace_all(escaped, "\"", "\\\"");
+    return "\n# 1 \"" + escaped + "\" 1\n";
+}
+
+bool
+Util::rename_file(const std::string& from, const std::string& to)
+{
+#if LINTER_CACHE_HAVE_GET_FILE_ATTRIBUTES
+    return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING);
+#else
+    return 0 == std::rename(from.c_str(), to.c_str());
+#endif
+}
+
+bool
+Util::write_file_atomically(const std::string& filepath,
+                            const std::string& contents)
+{
+    const auto temporary =
+      filepath + "." + std::to_string(process_id()) + ".tmp";
+    auto* output = fopen(temporary.c_str(), "wb");
+    if (!output) {
+        return false;
+    }
+    bool written =
+      contents.size() == fwrite(contents.data(), 1, contents.size(), output);
+    written = (0 == fclose(output)) && written;
+    if (!written || !rename_file(temporary, filepath)) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+StringList
+Util::list_dir(const std::string& dirpath)
+{
+    StringList entries;
+#if LINTER_CACHE_HAVE_OPENDIR
+    auto* dir = opendir(dirpath.c_str());
+    if (!dir) {
+        return entries;
+    }
+    while (const auto* entry = readdir(dir)) {
+        const std::string name = entry->d_name;
+        if (name != "." && name != "..") {
+            entries.push_back(name);
+        }
+    }
+    closedir(dir);
+#elif LINTER_CACHE_HAVE_GET_FILE_ATTRIBUTES
+    WIN32_FIND_DATAA data;
+    auto handle = FindFirstFileA((dirpath + "\\*").c_str(), &data);
+    if (INVALID_HANDLE_VALUE == handle) {
+        return entries;
+    }
+    do {
+        const std::string name = data.cFileName;
+        if (name != "." && name != "..") {
+            entries.push_back(name);
+        }
+    } while (FindNextFileA(handle, &data));
+    FindClose(handle);
+#endif
+    return entries;
+}
+
+bool
+Util::make_dirs(const std::string& dirpath)
+{
+    if (dirpath.empty()) {
+        return false;
+    }
+
+    // create all parents first, skipping the root
+    auto end = dirpath.find_first_of("/\\", 1);
+    while (true) {
+        const auto current = dirpath.substr(0, end);
+#if LINTER_CACHE_HAVE_MKDIR
+        if (0 != mkdir(current.c_str(), 0755) && EEXIST != errno) {
+            return false;
+        }
+#elif LINTER_CACHE_HAVE_CREATE_DIRECTORY
+        if (!CreateDirectoryA(current.c_str(), nullptr) &&
+            ERROR_ALREADY_EXISTS != GetLastError()) {
+            return false;
+        }
+#else
+    #error "Cannot create directories on this platform"
+#endif
+        if (std::string::npos == end) {
+            break;
+        }
+        end = dirpath.find_first_of("/\\", end + 1);
+    }
+    return true;
+}
+
+std::string
+Util::cache_dir()
+{
+    auto dir = Environment::get("LINTER_CACHE_DIR");
+    if (!dir.empty()) {
+        return dir;
+    }
+
+    // follow the lookup performed by ccache itself
+    dir = Environment::get("CCACHE_DIR");
+    if (dir.empty()) {
+        dir = Environment::get("XDG_CACHE_HOME");
+        if (dir.empty()) {
+#if _WIN32
+            dir = Environment::get("LOCALAPPDATA");
+#else
+            dir = Environment::get("HOME") + "/.cache";
+#endif
+        }
+        dir += "/ccache";
+    }
+    return dir + "/linter-cache";
+}
+
+unsigned long
+Util::process_id()
+{
+#if LINTER_CACHE_HAVE_GETPID
+    return static_cast<unsigned long>(getpid());
+#elif LINTER_CACHE_HAVE_GET_CURRENT_PROCESS_ID
+    return static_cast<unsigned long>(GetCurrentProcessId());
+#else
+    #error "Cannot determine the process id"
+#endif
+}
+
+std::string
+Util::find_program(const std::string& program)
+{
+    if (program.find_first_of("/\\") != std::string::npos) {
+        return is_file(program) ? program : std::string();
+    }
+
+#if _WIN32
+    const char separator = ';';
+    const StringList suffixes = { "", ".exe" };
+#else
+    const char separator = ':';
+    const StringList suffixes = { "" };
+#endif
+    const auto path = Environment::get("PATH");
+    size_t start = 0;
+    while (start <= path.size()) {
+        auto end = path.find(separator, start);
+        if (std::string::npos == end) {
+            end = path.size();
+        }
+        const auto dir = end > start ? path.substr(start, end - start) : ".";
+        for (const auto& suffix : suffixes) {
+            const auto candidate = dir + "/" + program + suffix;
+            if (is_file(candidate)) {
+                return candidate;
+            }
+        }
+        start = end + 1;
+    }
+    return std::string();
 }
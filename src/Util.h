@@ -22,13 +22,38 @@
 #ifndef UTIL_H_
 #define UTIL_H_
 
+#include <cstdint>
 #include <string>
 
+#include "StringList.h"
+
 class Util
 {
 public:
     Util() = delete;
 
+    struct FileInfo
+    {
+        uint64_t size = 0;
+        int64_t mtime = 0; // in nanoseconds
+        uint64_t inode = 0;
+        uint64_t device = 0;
+
+        inline bool operator==(const FileInfo& other) const
+        {
+            return size == other.size && mtime == other.mtime &&
+                   inode == other.inode && device == other.device;
+        }
+        inline bool operator!=(const FileInfo& other) const
+        {
+            return !(*this == other);
+        }
+    };
+
+    // queries size, modification time and identity of the given filepath,
+    // returns false if the filepath does not exist
+    static bool file_info(const std::string& filepath, FileInfo& info);
+
     // true when the given filepath points to a regular file
     static bool is_file(const std::string& filepath);
 
@@ -41,6 +66,10 @@ public:
     // resolves the given path making it absolute without any symlinks
     static std::string resolve_path(const std::string& filepath);
 
+    // makes the given path absolute and removes any `.` or `..` components
+    // without touching the filesystem, i.e. symlinks are kept as is
+    static std::string normalize_path(const std::string& filepath);
+
     // searchs the parent directory of filepath and any parent directories
     // above for a config file with the given name and returns its path
     static std::string find_applicable_config(const std::string& conf_name,
@@ -49,6 +78,34 @@ public:
     // generates an annotation as created by the preprocessor when including
     // the given filepath
     static std::string preproc_file_header(const std::string& filepath);
+
+    // moves the file at `from` to `to` replacing any existing file
+    // atomically so that concurrent readers see either of both
+    static bool rename_file(const std::string& from, const std::string& to);
+
+    // writes contents to a private file first and moves it in place so
+    // that concurrent readers see either the old or the new contents
+    static bool write_file_atomically(const std::string& filepath,
+                                      const std::string& contents);
+
+    // the names of all entries in the given directory except for `.` and
+    // `..`, empty when the directory cannot be read
+    static StringList list_dir(const std::string& dirpath);
+
+    // creates the given directory including any missing parents,
+    // returns true when the directory exists afterwards
+    static bool make_dirs(const std::string& dirpath);
+
+    // returns the directory used to persist state across invocations,
+    // this is `LINTER_CACHE_DIR` or a subdirectory of the ccache dir
+    static std::string cache_dir();
+
+    // returns program if it names a file or searches it in `PATH`,
+    // returns an empty string when it could not be found
+    static std::string find_program(const std::string& program);
+
+    // the id of the current process
+    static unsigned long process_id();
 };
 
 #endif // UTIL_H_
@@ -19,19 +19,32 @@
  * limitations under the License.
  */
 
+#include <functional>
 #include <memory>
 #include <iostream>
+#include <set>
+#include <sstream>
 
 #include "CommandlineArguments.h"
+#include "CompileCommands.h"
 #include "Environment.h"
 #include "Subprocess.h"
 
 #include "Cache.h"
+#include "DirectCache.h"
+#include "History.h"
+#include "JobPool.h"
+#include "Jobserver.h"
 #include "Linter.h"
 #include "LinterClangTidy.h"
 #include "Logging.h"
+#include "Metrics.h"
+#include "Trace.h"
+#include "Util.h"
 
 static constexpr char kMode[] = "Mode";
+static constexpr char kEnvJobs[] = "LINTER_CACHE_JOBS";
+static constexpr int kStdoutFd = 1;
 
 static std::unique_ptr<Linter>
 createLinter(Mode mode,
@@ -47,20 +60,166 @@ createLinter(Mode mode,
     }
 }
 
+static StringList
+sourcesFromDatabase(const CommandlineArguments& args)
+{
+    if (args.compilerDatabase.empty()) {
+        throw std::runtime_error(
+          "--all requires a compiler database given via -p");
+    }
+
+    // skip duplicate entries, a file listed with different commands only
+    // needs to be linted once as clang-tidy will process all of them
+    StringList sources;
+    std::set<std::string> files;
+    CompileCommands compilerDatabase(args.compilerDatabase);
+    compilerDatabase.parse([&](const CompileCommands::Entry& entry) {
+        if (files.insert(entry.file).second) {
+            sources.push_back(entry.file);
+        } else {
+            LOG(TRACE) << "Skipping duplicate entry for " << entry.file;
+        }
+        return true;
+    });
+    LOG(TRACE) << "Found " << sources.size() << " sources in '"
+               << args.compilerDatabase << "'";
+    return sources;
+}
+
+static int
+invokedInParallel(const CommandlineArguments& args,
+                  const StringList& sources,
+                  int jobs)
+{
+    // the cache writes hits and diagnostics straight to stdout and stderr,
+    // hence every source gets linted by a dedicated invocation of ourselves
+    // running the regular pipeline so that its output can be captured. All
+    // of them get supervised by this thread, see JobPool::runCommands()
+    StringList forwarded = { args.self };
+    if (!args.ccache.empty()) {
+        forwarded += "--ccache=" + args.ccache;
+    }
+    if (!args.clangTidy.empty()) {
+        forwarded += "--clang-tidy=" + args.clangTidy;
+    }
+    if (!args.timeout.empty()) {
+        forwarded += "--timeout=" + args.timeout;
+    }
+    if (!args.memoryLimit.empty()) {
+        forwarded += "--memory-limit=" + args.memoryLimit;
+    }
+    if (!args.cpuLimit.empty()) {
+        forwarded += "--cpu-limit=" + args.cpuLimit;
+    }
+    if (args.explainMiss) {
+        forwarded += "--explain-miss";
+    }
+    forwarded += args.remainingArgs;
+
+    History history;
+    JobPool pool(static_cast<size_t>(jobs));
+    for (const auto& source : sources) {
+        pool.add(source, history.duration(source), forwarded + source);
+    }
+
+    const auto exitCode = pool.run(std::cout, std::cerr);
+    if (0 == exitCode && !args.objectfile.empty()) {
+        NamedFile objectfile(args.objectfile);
+        objectfile.writeText("ok-");
+    }
+    return exitCode;
+}
+
+// writes to the file given via -o or to stdout
+static int
+printMerged(const CommandlineArguments& args,
+            const std::function<void(std::ostream&)>& merge)
+{
+    if (args.objectfile.empty()) {
+        merge(std::cout);
+        return 0;
+    }
+    std::ostringstream merged;
+    merge(merged);
+    NamedFile objectfile(args.objectfile);
+    return objectfile.writeText(merged.str()) ? 0 : 1;
+}
+
 static int
 invokedFromCommandline(const CommandlineArguments& args, Environment& env)
 {
+    if (args.stats) {
+        History().report(std::cout);
+        return 0;
+    }
+    if (!args.exportMetrics.empty()) {
+        std::ostringstream text;
+        Metrics().exportText(text);
+        // the collector may read at any time, never expose a partial file
+        if (!Util::write_file_atomically(args.exportMetrics, text.str())) {
+            throw std::runtime_error("Failed to write metrics to '" +
+                                     args.exportMetrics + "'");
+        }
+        return 0;
+    }
+    if (!args.mergeLogs.empty()) {
+        return printMerged(args, [&args](std::ostream& output) {
+            Logging::merge(args.mergeLogs, output);
+        });
+    }
+    if (!args.mergeTrace.empty()) {
+        return printMerged(args, [&args](std::ostream& output) {
+            Trace::merge(args.mergeTrace, output);
+        });
+    }
+
+    auto jobs = args.jobs;
+    if (jobs < 0) {
+        // default to all cores when linting a whole database
+        jobs = env.get(kEnvJobs, args.all ? 0 : 1);
+    }
+    if (args.all) {
+        return invokedInParallel(args, sourcesFromDatabase(args), jobs);
+    }
+    if (1 != jobs && args.sources.size() > 1) {
+        return invokedInParallel(args, args.sources, jobs);
+    }
+
+    // the limits reach the linter via ccache invoking us again
+    if (!args.timeout.empty()) {
+        env.set(Process::kEnvTimeout, args.timeout);
+    }
+    if (!args.memoryLimit.empty()) {
+        env.set(Process::kEnvMemoryLimit, args.memoryLimit);
+    }
+    if (!args.cpuLimit.empty()) {
+        env.set(Process::kEnvCpuLimit, args.cpuLimit);
+    }
+
+    // make counts this process as a job already, the linter running
+    // within it must not take another token from the jobserver
+    if (Jobserver(env).external()) {
+        env.set(Jobserver::kEnvHeld, 1);
+    }
+
     auto linter = createLinter(args.mode, args, env);
     Cache cache(args.ccache, env);
 
+    auto& trace = Trace::defaultInstance();
+    trace.setProcessName("linter-cache");
     for (const auto& source : args.sources) {
-        SavedArguments saved;
+        // the processes started by ccache pick up the correlation
+        trace.setCorrelation(Trace::newCorrelation());
+        Logging::defaultInstance().setCorrelation(trace.correlation());
+        TraceSpan span("source", source);
 
+        SavedArguments saved;
         linter->prepare(source, args, saved, env);
         saved.set(kMode, modeToString(args.mode));
+        saved.set(Trace::kSaveCorrelation, trace.correlation());
         saved.save(env);
 
-        cache.execute(args, *linter, args.objectfile, source);
+        cache.execute(args, *linter, args.objectfile, source, env);
     }
 
     return 0;
@@ -73,19 +232,34 @@ invokedFromCcache(const SavedArguments& saved,
 {
     auto linter = createLinter(modeFromString(saved.get(kMode)), args, env);
 
+    Trace::defaultInstance().setProcessName(
+      args.preprocess ? "linter-cache -E" : "linter-cache lint");
+    TraceSpan span(args.preprocess ? "preprocess step" : "lint step");
+
     std::string output;
     if (args.preprocess) {
-        linter->preprocess(saved, output);
+        // stream the output instead of collecting it, it may be huge
+        std::unique_ptr<FdSink> sink;
         if (args.objectfile.empty()) {
-            LOG(TRACE) << "Preprocessing to stdout:\n" << output;
-            std::cout << output << std::endl;
+            LOG(TRACE) << "Preprocessing to stdout";
+            std::cout << std::flush;
+            sink = std::make_unique<FdSink>(kStdoutFd);
         } else {
-            LOG(TRACE) << "Preprocessing to '" << args.objectfile << "':\n"
-                       << output;
-            NamedFile objectfile(args.objectfile);
-            objectfile.writeText(output);
+            LOG(TRACE) << "Preprocessing to '" << args.objectfile << "'";
+            sink = std::make_unique<FileSink>(args.objectfile);
+        }
+        if (Environment::get(DirectCache::kEnvDependencies).empty()) {
+            linter->preprocess(saved, *sink);
+        } else {
+            DirectCache::Recorder recorder(*sink);
+            linter->preprocess(saved, recorder);
+            recorder.finish();
+        }
+        if (args.objectfile.empty()) {
+            sink->write("\n", 1);
         }
     } else {
+        Cache::markMiss();
         linter->execute(saved, output);
         if (!args.objectfile.empty()) {
             LOG(TRACE) << "Linting to '" << args.objectfile << "':\n" << output;
@@ -101,12 +275,24 @@ int
 main(int argc, char* argv[]) // NOLINT(bugprone-exception-escape)
 {
     try {
+        const auto started = Trace::now();
         CommandlineArguments args(argc, argv);
+        const auto parsed = Trace::now();
         Environment env;
         LOG(TRACE) << "Invoked as " << StringList(argv, argc);
 
         SavedArguments saved;
         saved.load(env);
+        const auto loaded = Trace::now();
+
+        // reported late to carry the correlation passed by our parent
+        auto& trace = Trace::defaultInstance();
+        if (saved) {
+            trace.setCorrelation(saved.get(Trace::kSaveCorrelation));
+            Logging::defaultInstance().setCorrelation(trace.correlation());
+            trace.complete("load arguments", parsed, loaded - parsed, {});
+        }
+        trace.complete("parse arguments", started, parsed - started, {});
 
         if (saved) {
             return invokedFromCcache(saved, args, env);
@@ -116,7 +302,8 @@ main(int argc, char* argv[]) // NOLINT(bugprone-exception-escape)
     } catch (ProcessError& error) {
         LOG(ERROR) << "ProcessError " << error.exitCode() << ": "
                    << error.what();
-        return 1;
+        // forward the exit code of the linter, e.g. for cached failures
+        return error.exitCode() > 0 ? error.exitCode() : 1;
     } catch (std::exception& e) {
         LOG(ERROR) << "Unhandled exception thrown: " << e.what();
         return 1;
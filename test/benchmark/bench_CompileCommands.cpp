@@ -0,0 +1,178 @@
+/*
+ * bench_CompileCommands.cpp
+ *
+ * Copyright (c) 2022 - 2023 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compares the lookup of flags in a compile db using the line scanner
+// linter-cache used originally against the streaming parser and the
+// memory mapped index. Run with the number of entries to generate
+// and the number of lookups to perform as optional arguments
+
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+
+#include "CompileCommands.h"
+#include "CompileCommandsIndex.h"
+#include "Environment.h"
+#include "TemporaryFile.h"
+
+// the original implementation matching lines by substring
+static CompileCommands::Flags
+lineScannerFlagsForFile(const std::string& database,
+                        const std::string& sourcefile)
+{
+    StringList lines;
+    for (const auto& line : NamedFile(database).readLines()) {
+        if (line.find(sourcefile) != std::string::npos) {
+            lines.push_back(line);
+        }
+    }
+
+    std::string compiler;
+    StringList flags;
+    bool skip = false;
+    for (const auto& line : lines) {
+        auto start = line.find("command\": \"");
+        if (start != std::string::npos) {
+            start += 11;
+            auto end = line.find_first_of(" \"", start);
+            while (end != std::string::npos) {
+                const auto len = end - start;
+                if (len > 0) {
+                    const auto item = line.substr(start, len);
+                    if (skip) {
+                        skip = false;
+                    } else if ("-o" == item || "-c" == item) {
+                        skip = true;
+                    } else if (compiler.empty()) {
+                        compiler = item;
+                    } else {
+                        flags.push_back(item);
+                    }
+                }
+                start = end + 1;
+                end = line.find_first_of(" \"", start);
+            }
+            break;
+        }
+    }
+    CompileCommands::Flags result;
+    result.compiler = compiler;
+    result.options = flags;
+    return result;
+}
+
+static std::string
+sourceName(size_t idx)
+{
+    return "/work/project/src/module" + std::to_string(idx % 100) + "/file" +
+           std::to_string(idx) + ".cpp";
+}
+
+static std::string
+generateDatabase(size_t entries)
+{
+    std::string json = "[\n";
+    for (size_t i = 0; i < entries; ++i) {
+        const auto source = sourceName(i);
+        json += "{\n  \"directory\": \"/work/project/build\",\n"
+                "  \"command\": \"/usr/bin/c++ -DMODULE=" +
+                std::to_string(i % 100) +
+                " -I/work/project/include -I/work/project/src "
+                "-isystem /work/project/external/include -O2 -g -std=c++17 "
+                "-Wall -Wextra -o CMakeFiles/file" +
+                std::to_string(i) + ".o -c " + source +
+                "\",\n  \"file\": \"" + source + "\"\n}";
+        json += (i + 1 < entries) ? ",\n" : "\n";
+    }
+    return json + "]\n";
+}
+
+static double
+measure(const std::function<void()>& function)
+{
+    const auto start = std::chrono::steady_clock::now();
+    function();
+    const std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+int
+main(int argc, char* argv[])
+{
+    const size_t entries = argc > 1 ? std::atoi(argv[1]) : 50000;
+    const size_t lookups = argc > 2 ? std::atoi(argv[2]) : 20;
+
+    TemporaryFile database;
+    database.writeText(generateDatabase(entries));
+    std::cout << "Database with " << entries << " entries, " << lookups
+              << " lookups each" << std::endl;
+
+    size_t found = 0;
+    auto report = [&](const char* name, double milliseconds) {
+        std::cout << std::setw(20) << std::left << name << std::setw(10)
+                  << std::right << std::fixed << std::setprecision(2)
+                  << milliseconds / lookups << " ms/lookup (" << found << "/"
+                  << lookups << " found)" << std::endl;
+        found = 0;
+    };
+
+    report("line scanner", measure([&] {
+               for (size_t i = 0; i < lookups; ++i) {
+                   const auto flags = lineScannerFlagsForFile(
+                     database.filename(), sourceName(i * entries / lookups));
+                   found += flags.compiler.empty() ? 0 : 1;
+               }
+           }));
+
+    Environment env;
+    env.set("LINTER_CACHE_NO_INDEX", "1");
+    env.apply();
+    report("streaming parser", measure([&] {
+               for (size_t i = 0; i < lookups; ++i) {
+                   CompileCommands db(database.filename());
+                   const auto flags =
+                     db.flagsForFile(sourceName(i * entries / lookups));
+                   found += flags.compiler.empty() ? 0 : 1;
+               }
+           }));
+    env.reset();
+
+    const auto indexBuild = measure([&] {
+        CompileCommands db(database.filename());
+        CompileCommandsIndex index(db, database.filename());
+    });
+    std::cout << std::setw(20) << std::left << "index build" << std::setw(10)
+              << std::right << indexBuild << " ms once" << std::endl;
+    report("index", measure([&] {
+               for (size_t i = 0; i < lookups; ++i) {
+                   CompileCommands db(database.filename());
+                   const auto flags =
+                     db.flagsForFile(sourceName(i * entries / lookups));
+                   found += flags.compiler.empty() ? 0 : 1;
+               }
+           }));
+
+    NamedFile(CompileCommandsIndex::indexPath(database.filename())).unlink();
+    return 0;
+}
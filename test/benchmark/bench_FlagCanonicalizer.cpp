@@ -0,0 +1,147 @@
+/*
+ * bench_FlagCanonicalizer.cpp
+ *
+ * Copyright (c) 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Reports the hit rate when linting several configurations of the same
+// build tree one after another, once hashing the flags as given and once
+// after canonicalization. Pass the compile_commands.json of every build
+// directory, e.g. of Debug, RelWithDebInfo and ASan builds. Without any
+// arguments such a tree gets generated from typical CMake flags
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "CompileCommands.h"
+#include "Digest.h"
+#include "FlagCanonicalizer.h"
+
+struct Configuration
+{
+    std::string name;
+    std::vector<CompileCommands::Entry> entries;
+};
+
+static std::vector<Configuration>
+generateTree(size_t sources)
+{
+    // mirrors the flags CMake uses for its default build types
+    const std::vector<std::pair<std::string, std::string>> types = {
+        { "Debug", "-g -O0" },
+        { "RelWithDebInfo", "-O2 -g -DNDEBUG" },
+        { "Release", "-O3 -DNDEBUG" },
+        { "ASan", "-g -O1 -fsanitize=address -fno-omit-frame-pointer" },
+        { "Debug-Ninja", "-g -fdiagnostics-color=always -O0" },
+    };
+
+    std::vector<Configuration> tree;
+    for (const auto& type : types) {
+        Configuration configuration;
+        configuration.name = type.first;
+        for (size_t i = 0; i < sources; ++i) {
+            const auto source = "src/file" + std::to_string(i) + ".cpp";
+            const auto object =
+              "CMakeFiles/lib.dir/file" + std::to_string(i) + ".cpp.o";
+            CompileCommands::Entry entry;
+            entry.directory = "/build/" + type.first;
+            entry.file = "/src/" + source;
+            entry.command = "/usr/bin/c++ -DLIB_EXPORTS -I/src/include " +
+                            type.second + " -std=gnu++17 -fPIC -MD -MT " +
+                            object + " -MF " + object + ".d -o " + object +
+                            " -c /src/" + source;
+            configuration.entries.push_back(entry);
+        }
+        tree.push_back(configuration);
+    }
+    return tree;
+}
+
+static std::string
+keyOf(const CompileCommands::Entry& entry, const StringList& options)
+{
+    Digest digest;
+    digest.update(entry.file);
+    for (const auto& option : options) {
+        digest.update(option);
+    }
+    return digest.hex();
+}
+
+int
+main(int argc, char* argv[])
+{
+    std::vector<Configuration> tree;
+    for (int i = 1; i < argc; ++i) {
+        tree.push_back({ argv[i], CompileCommands(argv[i]).entries() });
+    }
+    if (tree.empty()) {
+        tree = generateTree(500);
+    }
+
+    const auto canonicalizer = FlagCanonicalizer::fromEnvironment();
+    std::set<std::string> rawKeys;
+    std::set<std::string> canonicalKeys;
+    size_t total = 0;
+    size_t rawHits = 0;
+    size_t canonicalHits = 0;
+    std::chrono::steady_clock::duration spent{};
+
+    std::cout << std::setw(40) << std::left << "configuration" << std::setw(8)
+              << std::right << "sources" << std::setw(10) << "as given"
+              << std::setw(12) << "canonical" << std::endl;
+    for (const auto& configuration : tree) {
+        size_t raw = 0;
+        size_t canonical = 0;
+        for (const auto& entry : configuration.entries) {
+            const auto flags = CompileCommands::flagsForEntry(entry);
+            raw += !rawKeys.insert(keyOf(entry, flags.options)).second;
+
+            const auto start = std::chrono::steady_clock::now();
+            const auto options = canonicalizer.apply(flags.options);
+            spent += std::chrono::steady_clock::now() - start;
+            canonical += !canonicalKeys.insert(keyOf(entry, options)).second;
+        }
+        const auto sources = configuration.entries.size();
+        std::cout << std::setw(40) << std::left << configuration.name
+                  << std::setw(8) << std::right << sources << std::fixed
+                  << std::setprecision(1) << std::setw(9)
+                  << (sources ? 100.0 * raw / sources : 0) << '%'
+                  << std::setw(11)
+                  << (sources ? 100.0 * canonical / sources : 0) << '%'
+                  << std::endl;
+        total += sources;
+        rawHits += raw;
+        canonicalHits += canonical;
+    }
+
+    const std::chrono::duration<double, std::micro> micros = spent;
+    std::cout << std::setw(40) << std::left << "total" << std::setw(8)
+              << std::right << total << std::setw(9)
+              << (total ? 100.0 * rawHits / total : 0) << '%' << std::setw(11)
+              << (total ? 100.0 * canonicalHits / total : 0) << '%'
+              << std::endl;
+    std::cout << "canonicalization took " << std::setprecision(2)
+              << (total ? micros.count() / total : 0) << " us/command"
+              << std::endl;
+    return 0;
+}
@@ -0,0 +1,103 @@
+/*
+ * bench_Logging.cpp
+ *
+ * Copyright (c) 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures the cost of the messages logged by a linter-cache process
+// invoked by ccache to lint a source, including the linter output which
+// can be megabytes. Compares logging being disabled against the former
+// approach of streaming into a stream with badbit set and against writing
+// to /dev/null. Run with the iterations and the KiB of output as arguments
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "Environment.h"
+#include "Logging.h"
+#include "StringList.h"
+
+// the messages of invokedFromCcache() for a source getting linted
+#define HOT_PATH(log)                                                          \
+    log(TRACE) << "Invoked as " << args;                                       \
+    log(TRACE) << "Linter is clang-tidy";                                      \
+    log(TRACE) << "LinterClangTidy: Running " << args;                         \
+    log(INFO) << "LinterClangTidy: Finished, wall 1.0s";                       \
+    log(TRACE) << "Linting to '" << objectfile << "':\n" << output
+
+static double
+measure(size_t iterations, const std::function<void()>& function)
+{
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        function();
+    }
+    const std::chrono::duration<double, std::micro> elapsed =
+      std::chrono::steady_clock::now() - start;
+    return elapsed.count() / iterations;
+}
+
+static void
+report(const char* name, double elapsed)
+{
+    std::cout << std::setw(10) << std::left << name << std::setw(12)
+              << std::right << std::fixed << std::setprecision(3) << elapsed
+              << " us/invocation" << std::endl;
+}
+
+int
+main(int argc, char* argv[])
+{
+    const size_t iterations = argc > 1 ? std::atoi(argv[1]) : 1000;
+    const size_t kilobytes = argc > 2 ? std::atoi(argv[2]) : 1024;
+
+    const StringList args = { "linter-cache", "--clang-tidy=clang-tidy",
+                              "-p",           "_build",
+                              "-c",           "src/main.cpp",
+                              "-o",           "main.cpp.o" };
+    const std::string objectfile = "CMakeFiles/linter-cache.dir/main.cpp.o";
+    const std::string output(kilobytes * 1024, 'x');
+    std::cout << iterations << " iterations with " << kilobytes
+              << " KiB of linter output" << std::endl;
+
+    // configures the default instance used by LOG() as disabled
+    Environment env;
+    env.unset("LINTER_CACHE_DEBUG");
+    env.unset("LINTER_CACHE_LOGFILE");
+    env.apply();
+    Logging::defaultInstance();
+    report("disabled", measure(iterations, [&] { HOT_PATH(LOG); }));
+
+    std::ofstream badbit;
+    badbit.setstate(std::ios::badbit);
+#define LOG_BADBIT(level) badbit
+    report("badbit", measure(iterations, [&] { HOT_PATH(LOG_BADBIT); }));
+
+    env.set("LINTER_CACHE_LOGFILE", "/dev/null");
+    env.apply();
+    Logging devnull;
+#define LOG_DEVNULL(level) LogMessage(Logging::Level::level, devnull).stream()
+    report("/dev/null", measure(iterations, [&] { HOT_PATH(LOG_DEVNULL); }));
+
+    return 0;
+}
@@ -0,0 +1,79 @@
+/*
+ * bench_Subprocess.cpp
+ *
+ * Copyright (c) 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compares the latency of running a trivial child process via fork()
+// against posix_spawnp(). As fork() needs to copy the page tables of
+// the parent, the parent optionally touches the given number of MiB
+// first. Run with the number of spawns and the MiB as optional arguments
+
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "Environment.h"
+#include "Subprocess.h"
+
+static double
+measure(const std::function<void()>& function)
+{
+    const auto start = std::chrono::steady_clock::now();
+    function();
+    const std::chrono::duration<double, std::micro> elapsed =
+      std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+int
+main(int argc, char* argv[])
+{
+    const size_t spawns = argc > 1 ? std::atoi(argv[1]) : 200;
+    const size_t megabytes = argc > 2 ? std::atoi(argv[2]) : 256;
+
+    // a resident heap comparable to a database index or scanned headers
+    std::vector<char> resident(megabytes * 1024 * 1024, 1);
+    std::cout << spawns << " spawns of 'true' with " << megabytes
+              << " MiB resident" << std::endl;
+
+    Environment env;
+    for (const auto* backend : { "fork", "spawn" }) {
+        env.set(Process::kEnvSpawn, backend);
+        env.apply();
+        for (const auto flags : { int(Process::NONE),
+                                  Process::CAPTURE_STDOUT |
+                                    Process::CAPTURE_STDERR }) {
+            const auto elapsed = measure([&] {
+                for (size_t i = 0; i < spawns; ++i) {
+                    Process process({ "true" }, flags);
+                    process.run();
+                }
+            });
+            std::cout << std::setw(6) << std::left << backend << std::setw(10)
+                      << (flags ? "captured" : "inherited") << std::setw(10)
+                      << std::right << std::fixed << std::setprecision(1)
+                      << elapsed / spawns << " us/spawn" << std::endl;
+        }
+    }
+
+    return resident.empty() || resident.back() == 1 ? 0 : 1;
+}
@@ -360,6 +360,38 @@ class TestClangTidy(unittest.TestCase):
         self.assertIn("readability-magic-numbers", proc.stdout, f"stderr: '{proc.stderr}'\nstdout: '{proc.stdout}'")
         self.assertEqual(0, stats.cache_hits, msg=stats.print())
 
+    def test_error_caching(self):
+        _cleanup()
+        self._prepare_buildtree()
+
+        stats = CCacheStats()
+
+        # a failing run should be cached including its output
+        contents = self.TESTED_FILE.read_text()
+        edited = contents.replace('// insert unused variable here', 'int error = 404;')
+        self.TESTED_FILE.write_text(edited)
+        stats.zero()
+        first = self._run(check=False)
+        self.assertNotEqual(0, first.returncode)
+        self.assertEqual(1, stats.cacheable, msg=stats.print())
+        self.assertEqual(0, stats.cache_hits, msg=stats.print())
+
+        # and replayed with the same exit code on a hit
+        stats.zero()
+        second = self._run(check=False)
+        self.assertEqual(first.returncode, second.returncode)
+        self.assertEqual(first.stdout, second.stdout)
+        self.assertIn("readability-magic-numbers", second.stdout, f"stderr: '{second.stderr}'\nstdout: '{second.stdout}'")
+        self.assertEqual(1, stats.cacheable, msg=stats.print())
+        self.assertEqual(1, stats.cache_hits, msg=stats.print())
+
+        # unless disabled
+        stats.zero()
+        third = self._run(extra_env={'LINTER_CACHE_NO_FAILURE_CACHING': '1'}, check=False)
+        self.assertEqual(first.returncode, third.returncode)
+        self.assertIn("readability-magic-numbers", third.stdout, f"stderr: '{third.stderr}'\nstdout: '{third.stdout}'")
+        self.assertEqual(0, stats.cache_hits, msg=stats.print())
+
     def test_with_extra_args(self):
         _cleanup()
         self._prepare_buildtree()
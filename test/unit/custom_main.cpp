@@ -21,8 +21,10 @@
 
 #include <iostream>
 #include <cstring>
+#include <csignal>
 #include <chrono>
 #include <thread>
+#include <vector>
 
 #include "OutputGenerator.h"
 
@@ -47,6 +49,15 @@ main(int argc, char* argv[])
         if (0 == std::strcmp(argv[i], "--sleep")) {
             std::this_thread::sleep_for(std::chrono::seconds(atoi(argv[++i])));
         }
+        if (0 == std::strcmp(argv[i], "--ignore-term")) {
+            std::signal(SIGTERM, SIG_IGN);
+        }
+        if (0 == std::strcmp(argv[i], "--allocate")) {
+            // touch every byte so that it is actually resident
+            std::vector<char> memory(
+              static_cast<size_t>(atoi(argv[++i])) * 1024 * 1024, 1);
+            std::cout << memory.size() << std::flush;
+        }
         if (0 == std::strcmp(argv[i], "--exit")) {
             return atoi(argv[++i]);
         }
@@ -162,3 +162,52 @@ TEST(CommandlineArguments, Preprocess_Msvc)
     ASSERT_TRUE(args2.preprocess);
     ASSERT_STREQ("C:/foobar", args2.objectfile.c_str());
 }
+
+TEST(CommandlineArguments, Jobs)
+{
+    std::vector<char const*> argv = { "cache-tidy", "foobar.cpp" };
+    {
+        CommandlineArguments args(argv.size(), argv.data());
+        ASSERT_EQ(-1, args.jobs);
+    }
+
+    argv = { "cache-tidy", "-j", "4", "foobar.cpp" };
+    {
+        CommandlineArguments args(argv.size(), argv.data());
+        ASSERT_EQ(4, args.jobs);
+        ASSERT_EQ(StringList({ "foobar.cpp" }), args.sources);
+        ASSERT_EQ(StringList(), args.remainingArgs);
+    }
+
+    argv = { "cache-tidy", "-j8", "--jobs=0" };
+    {
+        CommandlineArguments args(argv.size(), argv.data());
+        ASSERT_EQ(0, args.jobs);
+        ASSERT_EQ(StringList(), args.remainingArgs);
+    }
+
+    // like make a bare -j means all cores and leaves the sources alone
+    argv = { "cache-tidy", "-j", "a.cpp", "b.cpp" };
+    {
+        CommandlineArguments args(argv.size(), argv.data());
+        ASSERT_EQ(0, args.jobs);
+        ASSERT_EQ(StringList({ "a.cpp", "b.cpp" }), args.sources);
+    }
+
+    argv = { "cache-tidy", "--jobs=four", "a.cpp" };
+    ASSERT_THROW(CommandlineArguments(argv.size(), argv.data()),
+                 std::runtime_error);
+    argv = { "cache-tidy", "--jobs=", "a.cpp" };
+    ASSERT_THROW(CommandlineArguments(argv.size(), argv.data()),
+                 std::runtime_error);
+}
+
+TEST(CommandlineArguments, All)
+{
+    std::vector<char const*> argv = { "cache-tidy", "--all", "-p", "_build" };
+
+    CommandlineArguments args(argv.size(), argv.data());
+    ASSERT_TRUE(args.all);
+    ASSERT_EQ(StringList(), args.sources);
+    ASSERT_EQ(StringList({ "-p", "_build" }), args.remainingArgs);
+}
@@ -22,6 +22,8 @@
 #include <gtest/gtest.h>
 
 #include "CompileCommands.h"
+#include "Environment.h"
+#include "TemporaryFile.h"
 #include "paths_in_tests.h"
 
 static const StringList mainFlags = {
@@ -34,21 +36,79 @@ static const std::string compiler =
   "/Applications/Xcode.app/Contents/Developer/Toolchains/"
   "XcodeDefault.xctoolchain/usr/bin/c++";
 
-TEST(CompileCommands, MatchLinesRelative)
+// works on a copy so that no index gets written into the source tree
+class CompileCommandsTest : public testing::Test
 {
-    CompileCommands db(kCompileCommandsJson);
+protected:
+    void SetUp() override
+    {
+        _database.writeText(NamedFile(kCompileCommandsJson).readText());
+    }
+
+    void TearDown() override
+    {
+        NamedFile(_database.filename() + ".lcindex").unlink();
+    }
+
+    TemporaryFile _database;
+};
+
+TEST_F(CompileCommandsTest, MatchLinesRelative)
+{
+    CompileCommands db(_database.filename());
 
     auto flags = db.flagsForFile("src/main.cpp");
     ASSERT_EQ(mainFlags, flags.options);
     ASSERT_EQ(compiler, flags.compiler);
 }
 
-TEST(CompileCommands, MatchLinesAbsolute)
+TEST_F(CompileCommandsTest, MatchLinesAbsolute)
 {
-    CompileCommands db(kCompileCommandsJson);
+    CompileCommands db(_database.filename());
 
     auto flags = db.flagsForFile("/Volumes/Development/build/clang-ninja-debug/"
                                  "test/clang-tidy/src/main.cpp");
     ASSERT_EQ(mainFlags, flags.options);
     ASSERT_EQ(compiler, flags.compiler);
 }
+
+TEST_F(CompileCommandsTest, Entries)
+{
+    CompileCommands db(_database.filename());
+
+    auto entries = db.entries();
+    ASSERT_EQ(2, entries.size());
+    ASSERT_EQ("/Volumes/Development/build/clang-ninja-debug/"
+              "test/clang-tidy/src/hello_world.cpp",
+              entries[0].file);
+    ASSERT_EQ("/Volumes/Development/build/clang-ninja-debug/"
+              "test/clang-tidy/build",
+              entries[1].directory);
+    ASSERT_EQ(0, entries[1].command.find(compiler));
+}
+
+TEST(CompileCommands, MatchExactly)
+{
+    TemporaryFile database;
+    database.writeText(
+      R"([{"directory": "/work", "file": "src/xa.cpp", "command": "cc -DXA -c src/xa.cpp"},)"
+      R"({"directory": "/work", "file": "src/a.cpp", "arguments": ["cc", "-DA", "-c", "src/a.cpp"]}])");
+
+    for (const auto* noIndex : { "1", "" }) {
+        Environment env;
+        env.set("LINTER_CACHE_NO_INDEX", noIndex);
+        env.apply();
+        CompileCommands db(database.filename());
+
+        auto flags = db.flagsForFile("/work/src/a.cpp");
+        ASSERT_EQ("cc", flags.compiler);
+        ASSERT_EQ(StringList({ "-DA" }), flags.options);
+        flags = db.flagsForFile("src/a.cpp");
+        ASSERT_EQ(StringList({ "-DA" }), flags.options);
+        flags = db.flagsForFile("/work/src/xa.cpp");
+        ASSERT_EQ(StringList({ "-DXA" }), flags.options);
+        flags = db.flagsForFile("/work/src/b.cpp");
+        ASSERT_TRUE(flags.compiler.empty());
+    }
+    NamedFile(database.filename() + ".lcindex").unlink();
+}
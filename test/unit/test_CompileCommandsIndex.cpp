@@ -0,0 +1,132 @@
+/*
+ * test_CompileCommandsIndex.cpp
+ *
+ * Copyright (c) 2022 - 2023 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <fstream>
+
+#include <gtest/gtest.h>
+
+#include "CompileCommandsIndex.h"
+#include "TemporaryFile.h"
+#include "Util.h"
+
+static std::string
+databaseWith(const std::string& aFlag)
+{
+    return "[\n"
+           "{\n"
+           "  \"directory\": \"/work/build\",\n"
+           "  \"command\": \"/usr/bin/c++ -DXA -o xa.o -c /work/src/xa.cpp\",\n"
+           "  \"file\": \"/work/src/xa.cpp\"\n"
+           "},\n"
+           "{\n"
+           "  \"directory\": \"/work/build\",\n"
+           "  \"command\": \"/usr/bin/c++ " +
+           aFlag +
+           " -o a.o -c ../src/a.cpp\",\n"
+           "  \"file\": \"../src/a.cpp\"\n"
+           "}\n"
+           "]\n";
+}
+
+class CompileCommandsIndexTest : public testing::Test
+{
+protected:
+    void SetUp() override { _database.writeText(databaseWith("-DA")); }
+
+    void TearDown() override
+    {
+        NamedFile(CompileCommandsIndex::indexPath(_database.filename()))
+          .unlink();
+    }
+
+    TemporaryFile _database;
+};
+
+TEST_F(CompileCommandsIndexTest, Lookup)
+{
+    CompileCommands db(_database.filename());
+    CompileCommandsIndex index(db, _database.filename());
+    ASSERT_TRUE(index);
+    ASSERT_TRUE(Util::is_file(
+      CompileCommandsIndex::indexPath(_database.filename())));
+
+    CompileCommands::Flags flags;
+    ASSERT_TRUE(index.lookup("/work/src/a.cpp", flags));
+    ASSERT_EQ("/usr/bin/c++", flags.compiler);
+    ASSERT_EQ(StringList({ "-DA" }), flags.options);
+    ASSERT_EQ("/work/build", flags.directory);
+    ASSERT_EQ("a.o", flags.output);
+
+    ASSERT_TRUE(index.lookup("/work/build/../src/./xa.cpp", flags));
+    ASSERT_EQ(StringList({ "-DXA" }), flags.options);
+
+    // relative paths match on path boundaries only
+    ASSERT_TRUE(index.lookup("src/a.cpp", flags));
+    ASSERT_EQ(StringList({ "-DA" }), flags.options);
+    ASSERT_FALSE(index.lookup("/work/src/b.cpp", flags));
+}
+
+TEST_F(CompileCommandsIndexTest, Rebuild)
+{
+    CompileCommands db(_database.filename());
+    CompileCommands::Flags flags;
+    {
+        CompileCommandsIndex index(db, _database.filename());
+        ASSERT_TRUE(index.lookup("/work/src/a.cpp", flags));
+        ASSERT_EQ(StringList({ "-DA" }), flags.options);
+    }
+
+    // a changed size is enough to detect the modification
+    _database.writeText(databaseWith("-DA_CHANGED"));
+    CompileCommandsIndex index(db, _database.filename());
+    ASSERT_TRUE(index.lookup("/work/src/a.cpp", flags));
+    ASSERT_EQ(StringList({ "-DA_CHANGED" }), flags.options);
+}
+
+TEST_F(CompileCommandsIndexTest, Corrupted)
+{
+    CompileCommands db(_database.filename());
+    ASSERT_TRUE(CompileCommandsIndex(db, _database.filename()));
+
+    // offsets pointing past the end must not be followed
+    const auto indexPath = CompileCommandsIndex::indexPath(_database.filename());
+    {
+        // overwrite all slots right behind the header
+        std::fstream index(indexPath,
+                           std::ios::in | std::ios::out | std::ios::binary);
+        index.seekp(56);
+        const std::string garbage(16 * 32, '\xff');
+        index.write(garbage.data(), garbage.size());
+        ASSERT_TRUE(index);
+    }
+
+    // the lookup notices and parses the compile db instead
+    auto flags =
+      CompileCommands(_database.filename()).flagsForFile("/work/src/a.cpp");
+    ASSERT_EQ(StringList({ "-DA" }), flags.options);
+    ASSERT_FALSE(Util::is_file(indexPath));
+
+    // for the next process to rebuild it
+    CompileCommandsIndex index(db, _database.filename());
+    ASSERT_TRUE(index);
+    ASSERT_TRUE(index.lookup("/work/src/a.cpp", flags));
+    ASSERT_EQ(StringList({ "-DA" }), flags.options);
+}
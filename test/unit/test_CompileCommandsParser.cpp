@@ -0,0 +1,110 @@
+/*
+ * test_CompileCommandsParser.cpp
+ *
+ * Copyright (c) 2022 - 2023 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "CompileCommandsParser.h"
+
+using Entry = CompileCommandsParser::Entry;
+
+static std::vector<Entry>
+parseAll(const std::string& json, bool* ok = nullptr)
+{
+    std::vector<Entry> entries;
+    auto parsed = CompileCommandsParser::parse(
+      json.data(), json.size(), [&entries](const Entry& entry) {
+          entries.push_back(entry);
+          return true;
+      });
+    if (ok) {
+        *ok = parsed;
+    }
+    return entries;
+}
+
+TEST(CompileCommandsParser, Compact)
+{
+    bool ok = false;
+    auto entries = parseAll(
+      R"([{"directory":"/b","file":"a.cpp","command":"cc -c a.cpp","output":"a.o"},)"
+      R"({"file":"/s/x.cpp","arguments":["cc","-DX=\"1 2\"","-c","x.cpp"]}])",
+      &ok);
+    ASSERT_TRUE(ok);
+    ASSERT_EQ(2, entries.size());
+    ASSERT_EQ("/b", entries[0].directory);
+    ASSERT_EQ("/b/a.cpp", entries[0].file);
+    ASSERT_EQ("cc -c a.cpp", entries[0].command);
+    ASSERT_TRUE(entries[0].arguments.empty());
+    ASSERT_EQ("/s/x.cpp", entries[1].file);
+    ASSERT_EQ(StringList({ "cc", "-DX=\"1 2\"", "-c", "x.cpp" }),
+              entries[1].arguments);
+}
+
+TEST(CompileCommandsParser, Escapes)
+{
+    auto entries =
+      parseAll("[ {\n \"file\": \"C:\\\\src\\\\\\u00e4.cpp\",\n"
+               " \"command\": \"cl \\/nologo\", \"extra\": [1, {\"a\": "
+               "null}, true] } ]");
+    ASSERT_EQ(1, entries.size());
+    ASSERT_EQ("C:\\src\\\xc3\xa4.cpp", entries[0].file);
+    ASSERT_EQ("cl /nologo", entries[0].command);
+}
+
+TEST(CompileCommandsParser, Malformed)
+{
+    bool ok = true;
+    parseAll(R"([{"file": "a.cpp", "command": "cc)", &ok);
+    ASSERT_FALSE(ok);
+    parseAll(R"({"file": "a.cpp"})", &ok);
+    ASSERT_FALSE(ok);
+    parseAll("[]", &ok);
+    ASSERT_TRUE(ok);
+}
+
+TEST(CompileCommandsParser, StopEarly)
+{
+    const std::string json = R"([{"file":"/a.cpp"},{"file":"/b.cpp"}])";
+    size_t count = 0;
+    ASSERT_TRUE(CompileCommandsParser::parse(
+      json.data(), json.size(), [&count](const Entry&) {
+          ++count;
+          return false;
+      }));
+    ASSERT_EQ(1, count);
+}
+
+TEST(CompileCommandsParser, SplitShell)
+{
+    ASSERT_EQ(StringList({ "c++", "-DA=\"x y\"", "-DB=it's", "a b.cpp" }),
+              CompileCommandsParser::splitCommand(
+                R"(c++  -DA="\"x y\"" -DB=it\'s 'a b.cpp')", false));
+    ASSERT_EQ(StringList({ "c++", "-I/a\\b" }),
+              CompileCommandsParser::splitCommand(R"(c++ "-I/a\\b")", false));
+}
+
+TEST(CompileCommandsParser, SplitWindows)
+{
+    ASSERT_EQ(StringList({ "cl.exe", "/IC:\\some dir\\", "-DA=\"1\"", "x.cpp" }),
+              CompileCommandsParser::splitCommand(
+                R"(cl.exe "/IC:\some dir\\" -DA=\"1\" x.cpp)", true));
+}
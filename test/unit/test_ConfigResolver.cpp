@@ -0,0 +1,110 @@
+/*
+ * test_ConfigResolver.cpp
+ *
+ * Copyright (c) 2022 - 2023 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "ConfigResolver.h"
+#include "NamedFile.h"
+#include "TemporaryFile.h"
+#include "Util.h"
+
+namespace {
+
+struct ConfigResolverTest : public ::testing::Test
+{
+    void SetUp() override
+    {
+        _root = Util::normalize_path(_base.filename() + ".d");
+        Util::make_dirs(_root + "/sub/deeper");
+        _memo = _root + "/memo.txt";
+        write(".clang-tidy", "Checks: '-*'\n");
+        write("sub/.clang-tidy", "InheritParentConfig: true\nChecks: 'a'\n");
+        _source = write("sub/deeper/main.cpp", "int main() {}\n");
+    }
+
+    std::string write(const std::string& path, const std::string& contents)
+    {
+        NamedFile file(_root + "/" + path);
+        file.writeText(contents);
+        return file.filename();
+    }
+
+    TemporaryFile _base;
+    std::string _root;
+    std::string _memo;
+    std::string _source;
+};
+
+} // namespace
+
+TEST(ConfigResolver, InheritsParent)
+{
+    ASSERT_TRUE(ConfigResolver::inheritsParent("InheritParentConfig: true"));
+    ASSERT_TRUE(ConfigResolver::inheritsParent(
+      "---\nChecks: '-*'\n  InheritParentConfig:   True # comment\n"));
+    ASSERT_FALSE(ConfigResolver::inheritsParent("InheritParentConfig: false"));
+    ASSERT_FALSE(ConfigResolver::inheritsParent("Checks: '-*'\n"));
+    ASSERT_FALSE(ConfigResolver::inheritsParent(
+      "# InheritParentConfig: true\nChecks: '-*'\n"));
+}
+
+TEST_F(ConfigResolverTest, Chain)
+{
+    ConfigResolver resolver(".clang-tidy", _memo);
+    const auto config = resolver.resolve(_source, {});
+    ASSERT_EQ(StringList({ _root + "/sub/.clang-tidy", _root + "/.clang-tidy" }),
+              config.chain);
+    ASSERT_EQ(32u, config.digest.size());
+
+    // the arguments are part of the digest
+    ASSERT_NE(config.digest, resolver.resolve(_source, { "-checks=*" }).digest);
+}
+
+TEST_F(ConfigResolverTest, Memoized)
+{
+    const auto first = ConfigResolver(".clang-tidy", _memo).resolve(_source, {});
+    ASSERT_TRUE(Util::is_file(_memo));
+    ASSERT_EQ(first.digest,
+              ConfigResolver(".clang-tidy", _memo).resolve(_source, {}).digest);
+
+    // changing a parent config invalidates the memo
+    write(".clang-tidy", "Checks: '-*,bugprone-*'\n");
+    const auto second =
+      ConfigResolver(".clang-tidy", _memo).resolve(_source, {});
+    ASSERT_NE(first.digest, second.digest);
+
+    // as does adding a closer config
+    write("sub/deeper/.clang-tidy", "Checks: 'b'\n");
+    const auto third = ConfigResolver(".clang-tidy", _memo).resolve(_source, {});
+    ASSERT_EQ(StringList({ _root + "/sub/deeper/.clang-tidy" }), third.chain);
+}
+
+TEST_F(ConfigResolverTest, Explicit)
+{
+    ConfigResolver resolver(".clang-tidy", _memo);
+    const auto file = write("explicit.yaml", "Checks: 'c'\n");
+    ASSERT_EQ(StringList({ file }),
+              resolver.resolve(_source, { "--config-file=" + file }).chain);
+    ASSERT_EQ(StringList({ file }),
+              resolver.resolve(_source, { "-config-file", file }).chain);
+    ASSERT_TRUE(
+      resolver.resolve(_source, { "--config={Checks: 'd'}" }).chain.empty());
+}
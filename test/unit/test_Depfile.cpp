@@ -0,0 +1,111 @@
+/*
+ * test_Depfile.cpp
+ *
+ * Copyright (c) 2022 - 2023 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "Depfile.h"
+#include "TemporaryFile.h"
+#include "Util.h"
+
+static CompileCommands::Flags
+flagsWith(const StringList& options)
+{
+    CompileCommands::Flags flags;
+    flags.compiler = "/usr/bin/c++";
+    flags.options = options;
+    flags.directory = "/work/build";
+    flags.output = "src/main.cpp.o";
+    return flags;
+}
+
+TEST(Depfile, PathFor)
+{
+    ASSERT_EQ("", Depfile::pathFor(flagsWith({ "-DA" })));
+    ASSERT_EQ("/work/build/src/main.cpp.o.d",
+              Depfile::pathFor(
+                flagsWith({ "-MD", "-MT", "src/main.cpp.o", "-MF",
+                            "src/main.cpp.o.d" })));
+    ASSERT_EQ("/work/build/main.d",
+              Depfile::pathFor(flagsWith({ "-MMD", "-MF../build/main.d" })));
+    ASSERT_EQ("/work/build/src/main.cpp.d",
+              Depfile::pathFor(flagsWith({ "-MD" })));
+    ASSERT_EQ("/tmp/main.d",
+              Depfile::pathFor(flagsWith({ "-Wp,-MD,/tmp/main.d" })));
+}
+
+TEST(Depfile, MsvcStyle)
+{
+    auto flags = flagsWith({ "-MD" });
+    ASSERT_FALSE(Depfile::msvcStyle(flags));
+    flags.compiler = "/usr/bin/clang";
+    ASSERT_FALSE(Depfile::msvcStyle(flags));
+    flags.compiler = "C:\\VS\\bin\\CL.EXE";
+    ASSERT_TRUE(Depfile::msvcStyle(flags));
+    flags.compiler = "/usr/bin/clang-cl";
+    ASSERT_TRUE(Depfile::msvcStyle(flags));
+    flags.compiler = "/usr/bin/clang";
+    flags.options.push_back("--driver-mode=cl");
+    ASSERT_TRUE(Depfile::msvcStyle(flags));
+}
+
+TEST(Depfile, WithoutDepfileOptions)
+{
+    ASSERT_EQ(StringList({ "-DA", "-Iinclude" }),
+              Depfile::withoutDepfileOptions({ "-DA",
+                                               "-MD",
+                                               "-MT",
+                                               "main.o",
+                                               "-MFmain.d",
+                                               "-Iinclude",
+                                               "-MP",
+                                               "-Wp,-MMD,main.d" }));
+}
+
+TEST(Depfile, Parse)
+{
+    ASSERT_EQ(StringList({ "../src/main.cpp", "/usr/include/stdio.h",
+                           "../src/with space.h", "C:\\src\\win.h" }),
+              Depfile::parse("src/main.cpp.o: ../src/main.cpp \\\n"
+                             "  /usr/include/stdio.h \\\r\n"
+                             "  ../src/with\\ space.h C:\\src\\win.h\n"
+                             "/usr/include/stdio.h:\n"
+                             "../src/main.cpp:\n"));
+}
+
+TEST(Depfile, Fresh)
+{
+    TemporaryFile source;
+    source.writeText("int main() {}");
+    TemporaryFile written;
+    written.writeText("main.o: " + source.filename() + "\n");
+
+    Depfile depfile(written.filename(), "/work/build");
+    ASSERT_TRUE(depfile);
+    ASSERT_EQ(StringList({ source.filename() }), depfile.dependencies());
+    ASSERT_TRUE(depfile.fresh());
+
+    source.unlink();
+    ASSERT_FALSE(depfile.fresh());
+
+    Depfile missing(source.filename(), "/work/build");
+    ASSERT_FALSE(missing);
+    ASSERT_FALSE(missing.fresh());
+}
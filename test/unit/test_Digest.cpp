@@ -0,0 +1,68 @@
+/*
+ * test_Digest.cpp
+ *
+ * Copyright (c) 2022 - 2023 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "Digest.h"
+#include "TemporaryFile.h"
+
+TEST(Digest, Reference)
+{
+    // reference values of MurmurHash3_x64_128 with a seed of zero
+    ASSERT_EQ("00000000000000000000000000000000", Digest().hex());
+    const std::string fox = "The quick brown fox jumps over the lazy dog";
+    ASSERT_EQ("e34bbc7bbc071b6c7a433ca9c49a9347",
+              Digest().update(fox.data(), fox.size()).hex());
+}
+
+TEST(Digest, Incremental)
+{
+    const std::string data = "a somewhat longer text spanning multiple blocks";
+    const auto expected = Digest().update(data.data(), data.size()).hex();
+    for (size_t split = 0; split <= data.size(); ++split) {
+        Digest digest;
+        digest.update(data.data(), split);
+        digest.update(data.data() + split, data.size() - split);
+        ASSERT_EQ(expected, digest.hex()) << "split at " << split;
+    }
+}
+
+TEST(Digest, Strings)
+{
+    ASSERT_NE(Digest().update("ab").update("c").hex(),
+              Digest().update("a").update("bc").hex());
+}
+
+TEST(Digest, File)
+{
+    TemporaryFile file;
+    std::string empty;
+    ASSERT_TRUE(Digest::file(file.filename(), empty));
+    ASSERT_EQ(Digest().hex(), empty);
+
+    file.writeText("contents");
+    std::string hex;
+    ASSERT_TRUE(Digest::file(file.filename(), hex));
+    ASSERT_EQ(Digest().update("contents", 8).hex(), hex);
+
+    file.unlink();
+    ASSERT_FALSE(Digest::file(file.filename(), hex));
+}
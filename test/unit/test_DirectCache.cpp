@@ -0,0 +1,134 @@
+/*
+ * test_DirectCache.cpp
+ *
+ * Copyright (c) 2022 - 2023 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "DirectCache.h"
+#include "Environment.h"
+#include "TemporaryFile.h"
+#include "Util.h"
+
+namespace {
+
+struct DirectCacheTest : public ::testing::Test
+{
+    void SetUp() override
+    {
+        _directory = Util::normalize_path(storage.filename() + ".d");
+        header.writeText("#pragma once\n");
+    }
+
+    TemporaryFile storage;
+    TemporaryFile header;
+    std::string _directory;
+};
+
+} // namespace
+
+TEST(DirectCache, FilesFromPreprocessed)
+{
+    const auto files = DirectCache::filesFromPreprocessed(
+      "# 0 \"/src/main.cpp\"\n"
+      "# 0 \"<built-in>\"\n"
+      "#line 1 \"C:\\\\src\\\\header.h\"\n"
+      "# 1 \"/src/main.cpp\" 2\n"
+      "int main() { return 0; }\n"
+      "  # 1 \"/not/a/marker\"\n"
+      "# 5 \"/src/other.h\" 1 3 4");
+    ASSERT_EQ(StringList({ "/src/main.cpp", "C:\\src\\header.h",
+                           "/src/other.h" }),
+              files);
+}
+
+TEST_F(DirectCacheTest, Lookup)
+{
+    DirectCache cache(_directory);
+    DirectCache::Result result;
+    ASSERT_FALSE(cache.lookup("0123456789abcdef", result));
+
+    std::string dependencies;
+    ASSERT_TRUE(DirectCache::addDependency(dependencies, header.filename()));
+    ASSERT_FALSE(DirectCache::addDependency(dependencies, "/does/not/exist"));
+
+    DirectCache::Result stored;
+    stored.output = "some\nwarnings";
+    stored.errorOutput = "";
+    stored.objectContents = "ok-";
+    ASSERT_TRUE(cache.store("0123456789abcdef", dependencies, stored));
+
+    ASSERT_TRUE(cache.lookup("0123456789abcdef", result));
+    ASSERT_EQ(stored.output, result.output);
+    ASSERT_EQ(stored.errorOutput, result.errorOutput);
+    ASSERT_EQ(stored.objectContents, result.objectContents);
+
+    header.writeText("#pragma once\n// edited\n");
+    ASSERT_FALSE(cache.lookup("0123456789abcdef", result));
+}
+
+TEST_F(DirectCacheTest, Unresolved)
+{
+    DirectCache cache(_directory);
+    std::string dependencies;
+    ASSERT_TRUE(DirectCache::addDependency(dependencies, header.filename()));
+    dependencies += "? /does/not/exist\n";
+    ASSERT_FALSE(cache.store("fedcba9876543210", dependencies, {}));
+}
+
+TEST_F(DirectCacheTest, RecordDependencies)
+{
+    TemporaryFile recorded;
+    recorded.unlink();
+    {
+        Environment env;
+        env.set(DirectCache::kEnvDependencies, recorded.filename());
+        env.apply();
+        DirectCache::recordDependencies("# 1 \"" + header.filename() + "\"\n");
+    }
+
+    std::string expected;
+    ASSERT_TRUE(DirectCache::addDependency(expected, header.filename()));
+    ASSERT_EQ(expected, recorded.readText());
+}
+
+TEST_F(DirectCacheTest, Recorder)
+{
+    TemporaryFile recorded;
+    recorded.unlink();
+    CaptureSink passed;
+    const std::string preprocessed =
+      "int a;\n# 1 \"" + header.filename() + "\"\nint b; # 2 \"no\"\n";
+    {
+        Environment env;
+        env.set(DirectCache::kEnvDependencies, recorded.filename());
+        env.apply();
+        DirectCache::Recorder recorder(passed);
+        // split the marker across writes
+        for (size_t i = 0; i < preprocessed.size(); i += 5) {
+            recorder.write(preprocessed.substr(i, 5));
+        }
+        recorder.finish();
+    }
+
+    ASSERT_EQ(preprocessed, passed.contents());
+    std::string expected;
+    ASSERT_TRUE(DirectCache::addDependency(expected, header.filename()));
+    ASSERT_EQ(expected, recorded.readText());
+}
@@ -21,6 +21,8 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+
 #include "Environment.h"
 
 TEST(Environment, Get)
@@ -44,6 +46,10 @@ TEST(Environment, Set)
     auto value = env.get("NO_SUCH_VAR");
     ASSERT_TRUE(value.empty());
     env.set("NO_SUCH_VAR", "foo");
+    ASSERT_STREQ("foo", env.value("NO_SUCH_VAR").c_str());
+    // only an overlay until explicitly applied
+    ASSERT_TRUE(env.get("NO_SUCH_VAR").empty());
+    env.apply();
     value = env.get("NO_SUCH_VAR");
     ASSERT_FALSE(value.empty());
     ASSERT_STREQ("foo", value.c_str());
@@ -59,6 +65,7 @@ TEST(Environment, Integer)
     auto value = env.get("TEST_INT_VAR", 1);
     ASSERT_EQ(value, 1);
     env.set("TEST_INT_VAR", 24);
+    env.apply();
     value = env.get("TEST_INT_VAR", 1);
     ASSERT_EQ(value, 24);
     env.reset();
@@ -73,9 +80,43 @@ TEST(Environment, Double)
     auto value = env.get("TEST_FLOAT_VAR", 1.0);
     ASSERT_EQ(value, 1.0);
     env.set("TEST_FLOAT_VAR", 23.456);
+    env.apply();
     value = env.get("TEST_FLOAT_VAR", 1.0);
     ASSERT_EQ(value, 23.456);
     env.reset();
     value = env.get("TEST_FLOAT_VAR", 1.0);
     ASSERT_EQ(value, 1.0);
 }
+
+TEST(Environment, Merged)
+{
+    Environment env;
+    env.set("TEST_OVERLAY_VAR", "overlay");
+    env.unset("PATH");
+    ASSERT_TRUE(env.value("PATH").empty());
+    ASSERT_FALSE(env.get("PATH").empty());
+
+    const auto merged = env.merged();
+    ASSERT_NE(merged.end(),
+              std::find(merged.begin(), merged.end(), "TEST_OVERLAY_VAR=overlay"));
+    for (const auto& entry : merged) {
+        ASSERT_NE(0u, entry.rfind("PATH=", 0)) << entry;
+    }
+}
+
+TEST(Environment, Copy)
+{
+    Environment outer;
+    outer.set("TEST_COPY_VAR", "outer");
+    {
+        Environment inner(outer);
+        inner.set("TEST_COPY_VAR", "inner");
+        ASSERT_STREQ("outer", outer.value("TEST_COPY_VAR").c_str());
+
+        // a copy does not restore anything applied by the original
+        outer.apply();
+    }
+    ASSERT_STREQ("outer", Environment::get("TEST_COPY_VAR").c_str());
+    outer.reset();
+    ASSERT_TRUE(Environment::get("TEST_COPY_VAR").empty());
+}
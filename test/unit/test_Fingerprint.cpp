@@ -0,0 +1,109 @@
+/*
+ * test_Fingerprint.cpp
+ *
+ * Copyright (c) 2022 - 2023 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+#include "Fingerprint.h"
+#include "TemporaryFile.h"
+
+TEST(Fingerprint, Unchanged)
+{
+    TemporaryFile header;
+    header.writeText("#pragma once");
+
+    Fingerprint previous;
+    previous.setList("flags", { "-DFOO", "-O2" });
+    previous.setFiles("headers", { header.filename() });
+
+    Fingerprint current;
+    current.setList("flags", { "-DFOO", "-O2" });
+    current.setFiles("headers", { header.filename() }, &previous);
+    ASSERT_TRUE(current.differences(previous).empty());
+}
+
+TEST(Fingerprint, Differences)
+{
+    TemporaryFile header;
+    TemporaryFile removed;
+    TemporaryFile added;
+    header.writeText("#pragma once");
+
+    Fingerprint previous;
+    previous.setList("flags", { "-DFOO", "-O2" });
+    previous.setList("args", { "--quiet", "--fix" });
+    previous.setFiles("headers", { header.filename(), removed.filename() });
+
+    header.writeText("#pragma once\nint changed;");
+    Fingerprint current;
+    current.setList("flags", { "-DBAR", "-O2" });
+    current.setList("args", { "--fix", "--quiet" });
+    current.setFiles(
+      "headers", { header.filename(), added.filename() }, &previous);
+
+    // files get reported in the order of their paths
+    auto differences = current.differences(previous);
+    std::sort(differences.begin() + 3, differences.end());
+    StringList files = { "headers: removed '" + removed.filename() + "'",
+                         "headers: added '" + added.filename() + "'",
+                         "headers: modified '" + header.filename() + "'" };
+    std::sort(files.begin(), files.end());
+    ASSERT_EQ(StringList({ "args: changed order of '--fix --quiet'",
+                           "flags: removed '-DFOO'",
+                           "flags: added '-DBAR'" }) +
+                files,
+              differences);
+}
+
+TEST(Fingerprint, Storage)
+{
+    TemporaryFile header;
+    header.writeText("#pragma once");
+    TemporaryFile storage;
+
+    Fingerprint fingerprint;
+    fingerprint.setList("flags", { "-DFOO", "-I/path with spaces" });
+    fingerprint.setList("args", {});
+    fingerprint.setFiles("headers", { header.filename() });
+    ASSERT_TRUE(fingerprint.save(storage.filename()));
+
+    Fingerprint loaded;
+    ASSERT_TRUE(loaded.load(storage.filename()));
+    ASSERT_TRUE(loaded.differences(fingerprint).empty());
+    ASSERT_EQ(fingerprint.serialize(), loaded.serialize());
+
+    storage.writeText("garbage");
+    ASSERT_FALSE(loaded.load(storage.filename()));
+}
+
+TEST(Fingerprint, Add)
+{
+    Fingerprint previous;
+    previous.setList("flags", { "-DFOO" });
+    previous.setList("args", { "--quiet" });
+
+    Fingerprint current;
+    current.setList("flags", { "-DBAR" });
+    current.add(previous);
+    ASSERT_EQ(StringList({ "flags: removed '-DFOO'", "flags: added '-DBAR'" }),
+              current.differences(previous));
+}
@@ -0,0 +1,117 @@
+/*
+ * test_FlagCanonicalizer.cpp
+ *
+ * Copyright (c) 2022 - 2023 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "Environment.h"
+#include "FlagCanonicalizer.h"
+
+TEST(FlagCanonicalizer, Matches)
+{
+    ASSERT_TRUE(FlagCanonicalizer::matches("-O2", "-O2"));
+    ASSERT_FALSE(FlagCanonicalizer::matches("-O2", "-O3"));
+    ASSERT_TRUE(FlagCanonicalizer::matches("-fsanitize=*", "-fsanitize=address"));
+    ASSERT_TRUE(FlagCanonicalizer::matches("-W*,-MD,*", "-Wp,-MD,a.d"));
+    ASSERT_FALSE(FlagCanonicalizer::matches("-MF*", "-MD"));
+    ASSERT_TRUE(FlagCanonicalizer::matches("*", ""));
+}
+
+TEST(FlagCanonicalizer, Configurations)
+{
+    FlagCanonicalizer canonicalizer;
+    const StringList debug = { "-g", "-O0", "-fPIC", "-Iinclude", "-DDEBUG",
+                               "-MD", "-MT", "a.o", "-MF", "a.o.d" };
+    const StringList asan = { "-DDEBUG",
+                              "-O1",
+                              "-g",
+                              "-fsanitize=address",
+                              "-fno-omit-frame-pointer",
+                              "-I",
+                              "include",
+                              "-fdiagnostics-color=always" };
+    ASSERT_EQ(StringList({ "-Iinclude", "-DDEBUG" }),
+              canonicalizer.apply(debug));
+    ASSERT_EQ(StringList({ "-I", "include", "-DDEBUG" }),
+              canonicalizer.apply(asan));
+}
+
+TEST(FlagCanonicalizer, Ordering)
+{
+    FlagCanonicalizer canonicalizer;
+    ASSERT_EQ(StringList({ "-Ia",
+                           "-isystem",
+                           "b",
+                           "-Ic",
+                           "-include",
+                           "pch.h",
+                           "-DA",
+                           "-UA",
+                           "-DB=1",
+                           "-DZ" }),
+              canonicalizer.apply({ "-DZ",
+                                    "-Ia",
+                                    "-DA",
+                                    "-isystem",
+                                    "b",
+                                    "-D",
+                                    "B=1",
+                                    "-Ic",
+                                    "-UA",
+                                    "-Ia",
+                                    "-isystemb",
+                                    "-include",
+                                    "pch.h",
+                                    "-DZ" }));
+}
+
+TEST(FlagCanonicalizer, Lists)
+{
+    const StringList options = { "-g", "-O2", "-Iinclude", "-std=c++17",
+                                 "-fsanitize=address", "-DNDEBUG" };
+    ASSERT_EQ(StringList({ "-Iinclude", "-fsanitize=address", "-DNDEBUG" }),
+              FlagCanonicalizer(FlagCanonicalizer::defaultIgnored() +
+                                  StringList({ "-std=*" }),
+                                { "-fsanitize=*" })
+                .apply(options));
+    ASSERT_EQ(StringList({ "-O2", "-Iinclude", "-DNDEBUG" }),
+              FlagCanonicalizer({}, {}, { "-I*", "-D*", "-O*" }).apply(options));
+}
+
+TEST(FlagCanonicalizer, Environment)
+{
+    Environment env;
+    env.set(FlagCanonicalizer::kEnvIgnore, "-std=* -W*");
+    env.set(FlagCanonicalizer::kEnvKeep, "-O2");
+    env.apply();
+    ASSERT_EQ(StringList({ "-O2" }),
+              FlagCanonicalizer::fromEnvironment().apply(
+                { "-g", "-O2", "-std=c++17", "-Wall" }));
+
+    env.set(FlagCanonicalizer::kEnvDisable, 1);
+    env.apply();
+    ASSERT_EQ(StringList({ "-g", "-O2" }),
+              FlagCanonicalizer::fromEnvironment().apply({ "-g", "-O2" }));
+
+    env.unset(FlagCanonicalizer::kEnvIgnore);
+    env.unset(FlagCanonicalizer::kEnvKeep);
+    env.unset(FlagCanonicalizer::kEnvDisable);
+    env.apply();
+}
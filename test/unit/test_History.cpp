@@ -0,0 +1,158 @@
+/*
+ * test_History.cpp
+ *
+ * Copyright (c) 2022 - 2023 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <sstream>
+
+#include "History.h"
+#include "TemporaryFile.h"
+
+#include "paths_in_tests.h"
+
+namespace {
+
+History::Entry
+entry(const std::string& source, double seconds, bool hit = false)
+{
+    History::Entry entry;
+    entry.sourcefile = source;
+    entry.seconds = seconds;
+    entry.hit = hit;
+    return entry;
+}
+
+} // namespace
+
+TEST(History, Unknown)
+{
+    TemporaryFile storage;
+    History history(storage.filename());
+
+    ASSERT_LT(history.duration(kMainCpp), 0);
+    ASSERT_EQ(0, history.peakRss(kMainCpp));
+}
+
+TEST(History, Record)
+{
+    TemporaryFile storage;
+    {
+        History history(storage.filename());
+        history.record(entry(kMainCpp, 1.5));
+        ASSERT_DOUBLE_EQ(1.5, history.duration(kMainCpp));
+        history.record(entry(kMainCpp, 2.5));
+        ASSERT_DOUBLE_EQ(2.5, history.duration(kMainCpp));
+    }
+
+    // the last recorded value wins and sources resolve the same
+    History history(storage.filename());
+    ASSERT_DOUBLE_EQ(2.5, history.duration(kRelativeMainCpp));
+    ASSERT_LT(history.duration(kTestUtilCpp), 0);
+}
+
+TEST(History, Entries)
+{
+    TemporaryFile storage;
+    History history(storage.filename());
+
+    auto miss = entry(kMainCpp, 3.0);
+    miss.peakRssKb = 2048;
+    miss.exitCode = 2;
+    history.record(miss);
+    history.record(entry(kRelativeMainCpp, 0.5, true));
+
+    std::vector<History::Entry> entries;
+    history.forEach(
+      [&](const History::Entry& entry) { entries.push_back(entry); });
+    ASSERT_EQ(2u, entries.size());
+    ASSERT_EQ(entries[0].sourcefile, entries[1].sourcefile);
+    ASSERT_EQ(entries[0].key, entries[1].key);
+    ASSERT_DOUBLE_EQ(3.0, entries[0].seconds);
+    ASSERT_FALSE(entries[0].hit);
+    ASSERT_EQ(2048, entries[0].peakRssKb);
+    ASSERT_EQ(2, entries[0].exitCode);
+    ASSERT_GT(entries[0].timestamp, 0);
+    ASSERT_TRUE(entries[1].hit);
+
+    // hits do not tell anything about the memory needed
+    ASSERT_EQ(2048, History(storage.filename()).peakRss(kMainCpp));
+}
+
+TEST(History, Report)
+{
+    TemporaryFile storage;
+    History history(storage.filename());
+    history.record(entry(kMainCpp, 4.0));
+    history.record(entry(kMainCpp, 1.0, true));
+    history.record(entry(kMainCpp, 1.0, true));
+    history.record(entry(kTestUtilCpp, 2.0));
+
+    std::stringstream report;
+    history.report(report);
+    const auto text = report.str();
+    ASSERT_NE(std::string::npos, text.find("Runs: 4, hits: 2, misses: 2"))
+      << text;
+    ASSERT_NE(std::string::npos, text.find("Hit rate: 50.0%")) << text;
+    ASSERT_NE(std::string::npos, text.find("saved by hits: 6.0s")) << text;
+    // the slowest source comes first
+    ASSERT_LT(text.find("main.cpp"), text.find("test_Util.cpp")) << text;
+}
+
+TEST(History, Compact)
+{
+    TemporaryFile storage;
+    {
+        History history(storage.filename());
+        auto miss = entry(kMainCpp, 3.0);
+        miss.peakRssKb = 2048;
+        history.record(miss);
+        history.record(entry(kTestUtilCpp, 1.0));
+    }
+
+    // grow the history way beyond its limit by repeating the last record
+    std::string records;
+    {
+        std::ifstream input(storage.filename(), std::ios::binary);
+        records.assign(std::istreambuf_iterator<char>(input),
+                       std::istreambuf_iterator<char>());
+    }
+    ASSERT_EQ(512u, records.size());
+    const auto last = records.substr(256);
+    {
+        std::ofstream output(storage.filename(),
+                             std::ios::binary | std::ios::app);
+        for (size_t i = 0; i < 40000; ++i) {
+            output << last;
+        }
+    }
+
+    History history(storage.filename());
+    ASSERT_DOUBLE_EQ(1.0, history.duration(kTestUtilCpp));
+    size_t count = 0;
+    history.forEach([&](const History::Entry&) { ++count; });
+    ASSERT_LT(count, 40000u);
+
+    // the latest record of every source survives
+    History compacted(storage.filename());
+    ASSERT_DOUBLE_EQ(3.0, compacted.duration(kMainCpp));
+    ASSERT_EQ(2048, compacted.peakRss(kMainCpp));
+}
@@ -0,0 +1,67 @@
+/*
+ * test_Identity.cpp
+ *
+ * Copyright (c) 2022 - 2023 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "Identity.h"
+#include "NamedFile.h"
+#include "TemporaryFile.h"
+#include "Util.h"
+
+TEST(Identity, Missing)
+{
+    TemporaryFile storage;
+    Identity identity(storage.filename() + ".d");
+    ASSERT_EQ("", identity.fileFor("/does/not/exist", false));
+    ASSERT_EQ("", identity.fileFor("does-not-exist-in-path", false));
+}
+
+TEST(Identity, Changes)
+{
+    TemporaryFile storage;
+    TemporaryFile executable;
+    executable.writeText("version 1");
+    Identity identity(storage.filename() + ".d");
+
+    const auto filepath = identity.fileFor(executable.filename(), false);
+    ASSERT_FALSE(filepath.empty());
+    const auto first = NamedFile(filepath).readText();
+    ASSERT_NE(std::string::npos,
+              first.find("path " + Util::resolve_path(executable.filename())));
+    ASSERT_EQ(filepath, identity.fileFor(executable.filename(), false));
+    ASSERT_EQ(first, NamedFile(filepath).readText());
+
+    executable.writeText("version 2.0");
+    ASSERT_EQ(filepath, identity.fileFor(executable.filename(), false));
+    ASSERT_NE(first, NamedFile(filepath).readText());
+}
+
+TEST(Identity, Version)
+{
+    // cmake is known to be available in the path
+    TemporaryFile storage;
+    Identity identity(storage.filename() + ".d");
+
+    const auto filepath = identity.fileFor("cmake", true);
+    ASSERT_FALSE(filepath.empty());
+    ASSERT_NE(std::string::npos,
+              NamedFile(filepath).readText().find("cmake version"));
+}
@@ -0,0 +1,151 @@
+/*
+ * test_IncludeScanner.cpp
+ *
+ * Copyright (c) 2022 - 2023 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "Digest.h"
+#include "IncludeScanner.h"
+#include "NamedFile.h"
+#include "TemporaryFile.h"
+#include "Util.h"
+
+namespace {
+
+struct IncludeScannerTest : public ::testing::Test
+{
+    void SetUp() override
+    {
+        _root = Util::normalize_path(_base.filename() + ".d");
+        Util::make_dirs(_root + "/src");
+        Util::make_dirs(_root + "/inc/lib");
+    }
+
+    std::string write(const std::string& path, const std::string& contents)
+    {
+        NamedFile file(_root + "/" + path);
+        file.writeText(contents);
+        return file.filename();
+    }
+
+    TemporaryFile _base;
+    std::string _root;
+};
+
+} // namespace
+
+TEST(IncludeScanner, ParseIncludes)
+{
+    const std::string source = "#include \"quoted.h\"\n"
+                               "  #  include <angled.h>\n"
+                               "#include_next <next.h>\n"
+                               "#import \"imported.h\"\n"
+                               "// #include \"commented.h\"\n"
+                               "#define INCLUDE \"defined.h\"\n"
+                               "#include \"unterminated.h\n";
+    std::vector<IncludeScanner::Include> includes;
+    ASSERT_TRUE(
+      IncludeScanner::parseIncludes(source.data(), source.size(), includes));
+    ASSERT_EQ(4u, includes.size());
+    ASSERT_EQ("quoted.h", includes[0].name);
+    ASSERT_FALSE(includes[0].angled);
+    ASSERT_EQ("angled.h", includes[1].name);
+    ASSERT_TRUE(includes[1].angled);
+    ASSERT_EQ("next.h", includes[2].name);
+    ASSERT_TRUE(includes[2].next);
+    ASSERT_FALSE(includes[1].next);
+    ASSERT_EQ("imported.h", includes[3].name);
+
+    const std::string computed = "#include INCLUDE\n";
+    ASSERT_FALSE(IncludeScanner::parseIncludes(
+      computed.data(), computed.size(), includes));
+}
+
+TEST(IncludeScanner, SearchOrder)
+{
+    IncludeScanner scanner({ "-DFOO",
+                             "-isystem",
+                             "sys",
+                             "-Iangled",
+                             "-iquote",
+                             "quoted",
+                             "-idirafter",
+                             "after",
+                             "-I",
+                             "angled2",
+                             "/Iwin" });
+    ASSERT_EQ(StringList({ "quoted" }), scanner.quoteDirs());
+    ASSERT_EQ(StringList({ "angled", "angled2", "win", "sys", "after" }),
+              scanner.angledDirs());
+}
+
+TEST_F(IncludeScannerTest, Scan)
+{
+    const auto source = write("src/main.cpp",
+                              "#include \"local.h\"\n"
+                              "#include <lib/api.h>\n"
+                              "#include <vector>\n");
+    const auto local = write("src/local.h", "#pragma once\n");
+    const auto api = write("inc/lib/api.h", "#include \"detail.h\"\n");
+    const auto detail = write("inc/lib/detail.h", "#include \"local.h\"\n");
+
+    IncludeScanner scanner({ "-I", _root + "/inc" }, 4);
+    ASSERT_TRUE(scanner.scan(source));
+    ASSERT_EQ(3u, scanner.headers().size());
+    ASSERT_EQ(1u, scanner.headers().count(local));
+    ASSERT_EQ(1u, scanner.headers().count(api));
+    ASSERT_EQ(1u, scanner.headers().count(detail));
+    // local.h is not in reach of detail.h
+    ASSERT_EQ(std::set<std::string>({ "local.h", "vector" }),
+              scanner.missing());
+
+    std::string digest;
+    ASSERT_TRUE(Digest::file(api, digest));
+    ASSERT_EQ(digest, scanner.headers().at(api));
+}
+
+TEST_F(IncludeScannerTest, Computed)
+{
+    const auto source = write("src/computed.cpp", "#include \"computed.h\"\n");
+    write("src/computed.h", "#include HEADER\n");
+
+    IncludeScanner scanner({});
+    ASSERT_FALSE(scanner.scan(source));
+}
+
+TEST_F(IncludeScannerTest, IncludeNext)
+{
+    Util::make_dirs(_root + "/wrap");
+    const auto source =
+      write("src/main.cpp", "#include <stdlib.h>\n#include_next <first.h>\n");
+    const auto wrapper =
+      write("wrap/stdlib.h", "#include_next <stdlib.h>\n");
+    const auto real = write("inc/stdlib.h", "#pragma once\n");
+    const auto first = write("wrap/first.h", "#pragma once\n");
+
+    IncludeScanner scanner({ "-I", _root + "/wrap", "-I", _root + "/inc" });
+    ASSERT_TRUE(scanner.scan(source));
+    // the wrapper gets past itself, the source includes it regularly
+    ASSERT_EQ(3u, scanner.headers().size());
+    ASSERT_EQ(1u, scanner.headers().count(wrapper));
+    ASSERT_EQ(1u, scanner.headers().count(real));
+    ASSERT_EQ(1u, scanner.headers().count(first));
+    ASSERT_TRUE(scanner.missing().empty());
+}
@@ -0,0 +1,128 @@
+/*
+ * test_JobPool.cpp
+ *
+ * Copyright (c) 2022 - 2023 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <sstream>
+#include <thread>
+
+#include "JobPool.h"
+#include "custom_main.h"
+
+TEST(JobPool, ExitCodes)
+{
+    JobPool pool(4);
+    for (int i = 0; i < 8; ++i) {
+        pool.add(std::to_string(i), -1, [i] {
+            JobPool::Result result;
+            result.exitCode = (i == 3 || i == 5) ? i : 0;
+            return result;
+        });
+    }
+
+    std::ostringstream output;
+    std::ostringstream errorOutput;
+    ASSERT_EQ(3, pool.run(output, errorOutput));
+    ASSERT_EQ(8, pool.results().size());
+    ASSERT_EQ(5, pool.results()[5].exitCode);
+    ASSERT_EQ(0, pool.results()[7].exitCode);
+}
+
+TEST(JobPool, Concurrency)
+{
+    std::atomic<int> running{ 0 };
+    std::atomic<int> peak{ 0 };
+
+    JobPool pool(3);
+    for (int i = 0; i < 12; ++i) {
+        pool.add(std::to_string(i), -1, [&] {
+            peak = std::max(peak.load(), ++running);
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            --running;
+            return JobPool::Result();
+        });
+    }
+
+    std::ostringstream output;
+    std::ostringstream errorOutput;
+    ASSERT_EQ(0, pool.run(output, errorOutput));
+    ASSERT_LE(peak.load(), 3);
+    ASSERT_GT(peak.load(), 1);
+}
+
+TEST(JobPool, LongestFirstInOnePiece)
+{
+    JobPool pool(1);
+    pool.add("short", 1.0, [] {
+        JobPool::Result result;
+        result.output = "short\n";
+        result.errorOutput = "short-err\n";
+        return result;
+    });
+    pool.add("long", 10.0, [] {
+        JobPool::Result result;
+        result.output = "long\n";
+        return result;
+    });
+    pool.add("unknown", -1, [] {
+        JobPool::Result result;
+        result.output = "unknown\n";
+        return result;
+    });
+
+    std::ostringstream output;
+    std::ostringstream errorOutput;
+    ASSERT_EQ(0, pool.run(output, errorOutput));
+    ASSERT_EQ("long\nunknown\nshort\n", output.str());
+    ASSERT_EQ("short-err\n", errorOutput.str());
+}
+
+TEST(JobPool, Exception)
+{
+    JobPool pool(2);
+    pool.add("throws", -1, []() -> JobPool::Result {
+        throw std::runtime_error("failed");
+    });
+
+    std::ostringstream output;
+    std::ostringstream errorOutput;
+    ASSERT_EQ(1, pool.run(output, errorOutput));
+    ASSERT_NE(std::string::npos, errorOutput.str().find("failed"));
+}
+
+TEST(JobPool, Commands)
+{
+    JobPool pool(2);
+    pool.add("slow", 5.0, { kCustomMainPath, "--sleep", "1", "--stdout", "slow\n" });
+    pool.add("fails", 1.0, { kCustomMainPath, "--stderr", "bad\n", "--exit", "4" });
+    pool.add("quick", 2.0, { kCustomMainPath, "--stdout", "quick\n" });
+
+    std::ostringstream output;
+    std::ostringstream errorOutput;
+    ASSERT_EQ(4, pool.run(output, errorOutput));
+    ASSERT_EQ(3, pool.results().size());
+    ASSERT_EQ("slow\n", pool.results()[0].output);
+    ASSERT_EQ(4, pool.results()[1].exitCode);
+    // the slow command keeps running while the others complete
+    ASSERT_EQ("quick\nslow\n", output.str());
+    ASSERT_EQ("bad\n", errorOutput.str());
+}
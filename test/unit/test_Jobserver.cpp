@@ -0,0 +1,127 @@
+/*
+ * test_Jobserver.cpp
+ *
+ * Copyright (c) 2022 - 2023 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "config.h"
+
+#include "Jobserver.h"
+#include "TemporaryFile.h"
+#include "Util.h"
+
+#if LINTER_CACHE_HAVE_POLL && LINTER_CACHE_HAVE_FLOCK
+
+    #include <fcntl.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+
+TEST(Jobserver, Fifo)
+{
+    TemporaryFile base;
+    const auto fifo = base.filename() + ".fifo";
+    ASSERT_EQ(0, mkfifo(fifo.c_str(), 0600));
+    const auto fd = open(fifo.c_str(), O_RDWR | O_NONBLOCK);
+    ASSERT_LE(0, fd);
+    ASSERT_EQ(2, write(fd, "++", 2));
+
+    Environment env;
+    env.set("MAKEFLAGS", "-j3 --jobserver-auth=fifo:" + fifo);
+    Jobserver jobserver(env);
+    ASSERT_TRUE(jobserver.external());
+    {
+        auto first = jobserver.tryAcquire();
+        auto second = jobserver.tryAcquire();
+        ASSERT_TRUE(first);
+        ASSERT_TRUE(second);
+        ASSERT_FALSE(jobserver.tryAcquire());
+
+        first.release();
+        ASSERT_TRUE(jobserver.acquire());
+    }
+
+    // all tokens went back
+    char tokens[4];
+    ASSERT_EQ(2, read(fd, tokens, sizeof(tokens)));
+    close(fd);
+    unlink(fifo.c_str());
+}
+
+TEST(Jobserver, Pipe)
+{
+    int fds[2];
+    ASSERT_EQ(0, pipe(fds));
+    ASSERT_EQ(1, write(fds[1], "+", 1));
+
+    Environment env;
+    env.set("MAKEFLAGS",
+            " -j2 --jobserver-auth=" + std::to_string(fds[0]) + "," +
+              std::to_string(fds[1]));
+    Jobserver jobserver(env);
+    ASSERT_TRUE(jobserver.external());
+    {
+        auto token = jobserver.tryAcquire();
+        ASSERT_TRUE(token);
+        ASSERT_FALSE(jobserver.tryAcquire());
+    }
+    ASSERT_TRUE(jobserver.tryAcquire());
+    // the descriptors shared with other jobs are left as they were
+    ASSERT_EQ(0, fcntl(fds[0], F_GETFL) & O_NONBLOCK);
+    close(fds[0]);
+    close(fds[1]);
+
+    // recipes not marked by '+' do not inherit the descriptors
+    Jobserver closed(env);
+    ASSERT_FALSE(closed.external());
+}
+
+TEST(Jobserver, Slots)
+{
+    TemporaryFile base;
+    const auto dir = base.filename() + ".d";
+
+    Environment env;
+    env.unset("MAKEFLAGS");
+    env.set("XDG_RUNTIME_DIR", dir);
+    env.set(Jobserver::kEnvSlots, 2);
+    Jobserver jobserver(env);
+    ASSERT_FALSE(jobserver.external());
+
+    auto first = jobserver.tryAcquire();
+    auto second = jobserver.tryAcquire();
+    ASSERT_TRUE(first);
+    ASSERT_TRUE(second);
+    ASSERT_FALSE(jobserver.tryAcquire());
+    second.release();
+    ASSERT_TRUE(jobserver.acquire());
+}
+
+TEST(Jobserver, Held)
+{
+    Environment env;
+    env.set("MAKEFLAGS", "-j1");
+    env.set(Jobserver::kEnvHeld, 1);
+    env.set(Jobserver::kEnvSlots, 0);
+    Jobserver jobserver(env);
+    ASSERT_FALSE(jobserver.acquire());
+    ASSERT_FALSE(jobserver.tryAcquire());
+}
+
+#endif
@@ -0,0 +1,64 @@
+/*
+ * test_LintResult.cpp
+ *
+ * Copyright (c) 2022 - 2023 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "LintResult.h"
+
+TEST(LintResult, Success)
+{
+    LintResult result;
+    ASSERT_EQ("ok-", result.serialize());
+    ASSERT_FALSE(LintResult::parse(result.serialize(), result));
+}
+
+TEST(LintResult, Failure)
+{
+    LintResult result;
+    result.exitCode = 2;
+    result.output = "main.cpp:1:1: warning: readability-magic-numbers\n";
+    result.errorOutput = "1 warning treated as error\n";
+
+    LintResult parsed;
+    ASSERT_TRUE(LintResult::parse(result.serialize(), parsed));
+    ASSERT_EQ(result.exitCode, parsed.exitCode);
+    ASSERT_EQ(result.output, parsed.output);
+    ASSERT_EQ(result.errorOutput, parsed.errorOutput);
+}
+
+TEST(LintResult, Malformed)
+{
+    LintResult parsed;
+    ASSERT_FALSE(LintResult::parse("", parsed));
+    ASSERT_FALSE(LintResult::parse("fail-", parsed));
+    ASSERT_FALSE(LintResult::parse("fail-1\n", parsed));
+    ASSERT_FALSE(LintResult::parse("fail-1 10\nshort", parsed));
+    ASSERT_TRUE(LintResult::parse("fail-1 0\n", parsed));
+    ASSERT_EQ(1, parsed.exitCode);
+}
+
+TEST(LintResult, Cacheable)
+{
+    ASSERT_FALSE(LintResult::cacheable(0));
+    ASSERT_TRUE(LintResult::cacheable(1));
+    ASSERT_FALSE(LintResult::cacheable(-1));
+    ASSERT_FALSE(LintResult::cacheable(128 + 9));
+}
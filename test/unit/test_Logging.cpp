@@ -21,19 +21,30 @@
 
 #include <gtest/gtest.h>
 
+#include <sstream>
+#include <thread>
+#include <vector>
+
 #include "Logging.h"
+#include "NamedFile.h"
 #include "TemporaryFile.h"
 #include "Environment.h"
+#include "Util.h"
 
 TEST(Logging, Debug)
 {
 
     Environment env;
     env.set("LINTER_CACHE_DEBUG", 1);
+    env.apply();
 
     Logging logging;
     auto test_for_level = [&logging](Logging::Level level,
                                      const char* message) {
+        if (level < Logging::kMinimumLevel) {
+            // compiled out, see LINTER_CACHE_MIN_LOG_LEVEL
+            return;
+        }
         testing::internal::CaptureStderr();
         LogMessage(level, logging).stream() << message;
         auto captured = testing::internal::GetCapturedStderr();
@@ -52,10 +63,14 @@ TEST(Logging, Logfile)
 
     Environment env;
     env.set("LINTER_CACHE_LOGFILE", logfile.filename());
+    env.apply();
 
     Logging logging;
     auto test_for_level = [&logging, &logfile](Logging::Level level,
                                                const char* message) {
+        if (level < Logging::kMinimumLevel) {
+            return;
+        }
         LogMessage(level, logging).stream() << message;
         auto captured = logfile.readText();
         ASSERT_NE(std::string::npos, captured.find(message));
@@ -71,6 +86,7 @@ TEST(Logging, None)
     Environment env;
     env.unset("LINTER_CACHE_LOGFILE");
     env.unset("LINTER_CACHE_DEBUG");
+    env.apply();
 
     Logging logging;
     auto test_for_level = [&logging](Logging::Level level,
@@ -82,3 +98,139 @@ TEST(Logging, None)
     test_for_level(Logging::Level::INFO, "Note that!");
     test_for_level(Logging::Level::TRACE, "State is good");
 }
+
+TEST(Logging, Level)
+{
+    TemporaryFile logfile;
+
+    Environment env;
+    env.set("LINTER_CACHE_LOGFILE", logfile.filename());
+    env.set("LINTER_CACHE_LOG_LEVEL", "warning");
+    env.apply();
+
+    Logging logging;
+    ASSERT_FALSE(logging.enabled(Logging::Level::TRACE));
+    ASSERT_FALSE(logging.enabled(Logging::Level::INFO));
+    ASSERT_EQ(Logging::Level::WARNING >= Logging::kMinimumLevel,
+              logging.enabled(Logging::Level::WARNING));
+    LogMessage(Logging::Level::ERROR, logging).stream() << "Some error";
+    LogMessage(Logging::Level::WARNING, logging).stream() << "Some warning";
+    LogMessage(Logging::Level::INFO, logging).stream() << "Note that!";
+    LogMessage(Logging::Level::TRACE, logging).stream() << "State is good";
+
+    auto captured = logfile.readText();
+    ASSERT_NE(std::string::npos, captured.find("Some error"));
+    ASSERT_EQ(Logging::Level::WARNING >= Logging::kMinimumLevel,
+              std::string::npos != captured.find("Some warning"));
+    ASSERT_EQ(std::string::npos, captured.find("Note that!"));
+    ASSERT_EQ(std::string::npos, captured.find("State is good"));
+
+    env.unset("LINTER_CACHE_LOG_LEVEL");
+    env.apply();
+}
+
+TEST(Logging, ShortCircuit)
+{
+    int evaluated = 0;
+    LOG_IF(ERROR, false) << "Evaluated " << ++evaluated;
+    ASSERT_EQ(0, evaluated);
+
+    TemporaryFile logfile;
+
+    Environment env;
+    env.set("LINTER_CACHE_LOGFILE", logfile.filename());
+    env.set("LINTER_CACHE_LOG_LEVEL", "error");
+    env.apply();
+
+    // disabled at runtime, LOG() is LOG_TO() the default instance
+    Logging logging;
+    LOG_TO(logging, TRACE) << "Evaluated " << ++evaluated;
+    LOG_TO(logging, WARNING) << "Evaluated " << ++evaluated;
+    ASSERT_EQ(0, evaluated);
+    LOG_TO(logging, ERROR) << "Evaluated " << ++evaluated;
+    ASSERT_EQ(1, evaluated);
+    ASSERT_NE(std::string::npos, logfile.readText().find("Evaluated 1"));
+
+    env.unset("LINTER_CACHE_LOG_LEVEL");
+    env.apply();
+}
+
+TEST(Logging, Threads)
+{
+    static constexpr int kThreads = 4;
+    static constexpr int kMessages = 200;
+
+    TemporaryFile logfile;
+
+    Environment env;
+    env.set("LINTER_CACHE_LOGFILE", logfile.filename());
+    env.apply();
+
+    Logging logging;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&logging, t] {
+            for (int i = 0; i < kMessages; ++i) {
+                LogMessage(Logging::Level::INFO, logging).stream()
+                  << "thread " << t << " message " << i << " done";
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    std::istringstream captured(logfile.readText());
+    int lines = 0;
+    for (std::string line; std::getline(captured, line); ++lines) {
+        ASSERT_NE(std::string::npos, line.find(" INFO: thread ")) << line;
+        ASSERT_EQ(line.size() - 5, line.find(" done")) << line;
+    }
+    ASSERT_EQ(kThreads * kMessages, lines);
+}
+
+TEST(Logging, Record)
+{
+    TemporaryFile logfile;
+
+    Environment env;
+    env.set("LINTER_CACHE_LOGFILE", logfile.filename());
+    env.apply();
+
+    Logging logging;
+    logging.setCorrelation("42-1");
+    LogMessage(Logging::Level::WARNING, logging).stream() << "First\nSecond";
+
+    const auto captured = logfile.readText();
+    // 2023-01-01T00:00:00.000000Z <pid> <correlation>  WARN: <message>
+    ASSERT_EQ('T', captured[10]) << captured;
+    ASSERT_EQ('Z', captured[26]) << captured;
+    ASSERT_EQ(captured.substr(27),
+              " " + std::to_string(Util::process_id()) +
+                " 42-1  WARN: First\nSecond\n");
+}
+
+TEST(Logging, Merge)
+{
+    TemporaryFile base;
+    const auto dir = base.filename() + ".d";
+    Util::make_dirs(dir);
+
+    NamedFile(dir + "/log-11.txt")
+      .writeText("2023-01-01T00:00:01.000000Z 11 - TRACE: b\n"
+                 "2023-01-01T00:00:03.000000Z 11 - TRACE: d\n  continued\n");
+    NamedFile(dir + "/log-12.txt")
+      .writeText("2023-01-01T00:00:00.000000Z 12 - TRACE: a\n"
+                 "2023-01-01T00:00:02.000000Z 12 - TRACE: c");
+    NamedFile(dir + "/log-other.txt")
+      .writeText("2023-01-01T00:00:00.500000Z 13 - TRACE: ignored\n");
+
+    std::ostringstream merged;
+    ASSERT_EQ(2, Logging::merge(dir + "/log-" + Logging::kPidPattern + ".txt",
+                                merged));
+    ASSERT_EQ("2023-01-01T00:00:00.000000Z 12 - TRACE: a\n"
+              "2023-01-01T00:00:01.000000Z 11 - TRACE: b\n"
+              "2023-01-01T00:00:02.000000Z 12 - TRACE: c\n"
+              "2023-01-01T00:00:03.000000Z 11 - TRACE: d\n  continued\n",
+              merged.str());
+}
@@ -0,0 +1,126 @@
+/*
+ * test_MemoryBudget.cpp
+ *
+ * Copyright (c) 2022 - 2023 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "config.h"
+
+#include "MemoryBudget.h"
+#include "NamedFile.h"
+#include "TemporaryFile.h"
+#include "Util.h"
+
+namespace {
+
+struct MemoryBudgetTest : public ::testing::Test
+{
+    void SetUp() override
+    {
+        _dir = _base.filename() + ".d";
+        Util::make_dirs(_dir);
+    }
+
+    // the history only keeps existing sources
+    std::string source(const std::string& name, long peakKb = 0)
+    {
+        NamedFile file(_dir + "/" + name);
+        if (!Util::is_file(file.filename())) {
+            file.writeText("int main() {}\n");
+        }
+        if (peakKb > 0) {
+            History::Entry entry;
+            entry.sourcefile = file.filename();
+            entry.peakRssKb = peakKb;
+            History(_dir + "/history.bin").record(entry);
+        }
+        return file.filename();
+    }
+
+    TemporaryFile _base;
+    std::string _dir;
+};
+
+} // namespace
+
+TEST_F(MemoryBudgetTest, Estimate)
+{
+    const auto a = source("a.cpp");
+    MemoryBudget budget(_dir, 0);
+    ASSERT_EQ(MemoryBudget::kDefaultEstimateKb, budget.estimate(a));
+    budget.record(a, 4096);
+    ASSERT_EQ(4096, budget.estimate(a));
+    budget.record(a, 0);
+    ASSERT_EQ(4096, budget.estimate(a));
+
+    // observations get persisted by the history
+    source("a.cpp", 2048);
+    ASSERT_EQ(2048, MemoryBudget(_dir, 0).estimate(a));
+}
+
+TEST_F(MemoryBudgetTest, Disabled)
+{
+    MemoryBudget budget(_dir, 0);
+    ASSERT_FALSE(budget.reserve(source("a.cpp")));
+}
+
+#if LINTER_CACHE_HAVE_FLOCK
+
+TEST_F(MemoryBudgetTest, Reserve)
+{
+    const auto a = source("a.cpp", 1500);
+    const auto b = source("b.cpp", 1000);
+    const auto c = source("c.cpp", 500);
+    MemoryBudget budget(_dir, 2000);
+
+    auto first = budget.reserve(a);
+    ASSERT_TRUE(first);
+    ASSERT_FALSE(budget.tryReserve(b));
+    auto second = budget.tryReserve(c);
+    ASSERT_TRUE(second);
+
+    // other processes share the reservations
+    MemoryBudget other(_dir, 2000);
+    ASSERT_FALSE(other.tryReserve(c));
+    first.release();
+    ASSERT_TRUE(other.tryReserve(b));
+}
+
+TEST_F(MemoryBudgetTest, ExceedingAlone)
+{
+    const auto huge = source("huge.cpp", 5000);
+    MemoryBudget budget(_dir, 1000);
+    auto first = budget.tryReserve(huge);
+    ASSERT_TRUE(first);
+    ASSERT_FALSE(budget.tryReserve(huge));
+}
+
+TEST_F(MemoryBudgetTest, DropsDead)
+{
+    // no process will ever have this pid
+    NamedFile reservations(_dir + "/memory-reservations.txt");
+    reservations.writeText("2147483647.0\t900\n");
+
+    const auto a = source("a.cpp", 500);
+    MemoryBudget budget(_dir, 1000);
+    ASSERT_TRUE(budget.tryReserve(a));
+}
+
+#endif
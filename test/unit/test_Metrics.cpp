@@ -0,0 +1,90 @@
+/*
+ * test_Metrics.cpp
+ *
+ * Copyright (c) 2022 - 2023 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+#include "Metrics.h"
+#include "TemporaryFile.h"
+
+TEST(Metrics, Shared)
+{
+    TemporaryFile storage;
+    Metrics first(storage.filename());
+    Metrics second(storage.filename());
+    ASSERT_TRUE(first);
+
+    first.add(Metrics::Counter::HITS);
+    second.add(Metrics::Counter::HITS, 2);
+    first.addSeconds(Metrics::Counter::LINT_MICROS, 1.5);
+    ASSERT_EQ(3, first.get(Metrics::Counter::HITS));
+    ASSERT_EQ(3, second.get(Metrics::Counter::HITS));
+    ASSERT_EQ(0, second.get(Metrics::Counter::MISSES));
+    ASSERT_EQ(1500000, second.get(Metrics::Counter::LINT_MICROS));
+
+    // values survive all processes
+    ASSERT_EQ(3, Metrics(storage.filename()).get(Metrics::Counter::HITS));
+}
+
+TEST(Metrics, Incompatible)
+{
+    TemporaryFile storage;
+    storage.writeText("something else");
+    Metrics metrics(storage.filename());
+    ASSERT_FALSE(metrics);
+    metrics.add(Metrics::Counter::RUNS);
+    ASSERT_EQ(0, metrics.get(Metrics::Counter::RUNS));
+}
+
+TEST(Metrics, Timer)
+{
+    TemporaryFile storage;
+    Metrics metrics(storage.filename());
+    {
+        Metrics::Timer timer(metrics,
+                             Metrics::Counter::PREPROCESS_RUNS,
+                             Metrics::Counter::PREPROCESS_MICROS);
+    }
+    ASSERT_EQ(1, metrics.get(Metrics::Counter::PREPROCESS_RUNS));
+}
+
+TEST(Metrics, Export)
+{
+    TemporaryFile storage;
+    Metrics metrics(storage.filename());
+    metrics.add(Metrics::Counter::MISSES, 7);
+    metrics.add(Metrics::Counter::RUN_MICROS, 2000042);
+
+    std::ostringstream text;
+    metrics.exportText(text);
+    const auto exported = text.str();
+    EXPECT_NE(std::string::npos,
+              exported.find("# TYPE linter_cache_misses_total counter\n"
+                            "linter_cache_misses_total 7\n"))
+      << exported;
+    EXPECT_NE(std::string::npos,
+              exported.find("\nlinter_cache_run_seconds_total 2.000042\n"))
+      << exported;
+    EXPECT_NE(std::string::npos,
+              exported.find("\nlinter_cache_hits_total 0\n"))
+      << exported;
+}
@@ -0,0 +1,104 @@
+/*
+ * test_OutputSink.cpp
+ *
+ * Copyright (c) 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "OutputSink.h"
+#include "Subprocess.h"
+#include "TemporaryFile.h"
+#include "custom_main.h"
+
+TEST(OutputSink, Tee)
+{
+    CaptureSink first;
+    CaptureSink second;
+    TeeSink tee(first, second);
+    tee.write("Hello ");
+    tee.write("World");
+    ASSERT_EQ("Hello World", first.contents());
+    ASSERT_EQ("Hello World", second.contents());
+    ASSERT_LT(tee.fd(), 0);
+}
+
+TEST(OutputSink, RingBuffer)
+{
+    RingBufferSink ring(8);
+    ring.write("abc");
+    ASSERT_EQ("abc", ring.contents());
+    ring.write("defgh");
+    ASSERT_EQ("abcdefgh", ring.contents());
+    ASSERT_EQ(0u, ring.discarded());
+    ring.write("ijk");
+    ASSERT_EQ("defghijk", ring.contents());
+    ASSERT_EQ(3u, ring.discarded());
+    ring.write("0123456789");
+    ASSERT_EQ("23456789", ring.contents());
+    ASSERT_EQ(13u, ring.discarded());
+    ring.write("x");
+    ASSERT_EQ("3456789x", ring.contents());
+}
+
+TEST(OutputSink, File)
+{
+    TemporaryFile file;
+    file.writeText("previous contents");
+    {
+        FileSink sink(file.filename());
+        ASSERT_GE(sink.fd(), 0);
+        sink.write("written");
+    }
+    ASSERT_EQ("written", file.readText());
+    ASSERT_THROW(FileSink("/does/not/exist/file"), std::runtime_error);
+}
+
+TEST(OutputSink, ProcessToFile)
+{
+    TemporaryFile file;
+    {
+        FileSink sink(file.filename());
+        sink.write("before\n");
+        Process process({ kCustomMainPath, "--stdout", "child\n" });
+        process.setOutputSink(&sink);
+        ASSERT_NO_THROW(process.run());
+        ASSERT_TRUE(process.output().empty());
+        sink.write("after\n");
+    }
+    ASSERT_EQ("before\nchild\nafter\n", file.readText());
+}
+
+TEST(OutputSink, ProcessToCapture)
+{
+    CaptureSink output;
+    RingBufferSink errors(4);
+    Process process({ kCustomMainPath,
+                      "--stdout",
+                      "captured",
+                      "--stderr",
+                      "truncated",
+                      "--exit",
+                      "2" });
+    process.setOutputSink(&output);
+    process.setErrorOutputSink(&errors);
+    ASSERT_THROW(process.run(), ProcessError);
+    ASSERT_EQ("captured", output.contents());
+    ASSERT_EQ("ated", errors.contents());
+    ASSERT_TRUE(process.errorOutput().empty());
+}
@@ -0,0 +1,115 @@
+/*
+ * test_ProcessReactor.cpp
+ *
+ * Copyright (c) 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <vector>
+
+#include "OutputGenerator.h"
+#include "ProcessReactor.h"
+#include "custom_main.h"
+
+static constexpr int kCaptureAll =
+  Process::CAPTURE_STDOUT | Process::CAPTURE_STDERR;
+
+TEST(ProcessReactor, Concurrent)
+{
+    ProcessReactor reactor;
+    std::vector<std::string> outputs(4);
+    std::vector<int> exitCodes(4, -1);
+
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < outputs.size(); ++i) {
+        reactor.start(
+          std::make_unique<Process>(StringList{ kCustomMainPath,
+                                                "--stdout",
+                                                "out" + std::to_string(i),
+                                                "--sleep",
+                                                "1",
+                                                "--stderr",
+                                                "err",
+                                                "--exit",
+                                                std::to_string(i) },
+                                    kCaptureAll),
+          [&, i](Process& process) {
+              outputs[i] = process.output();
+              exitCodes[i] = process.exitCode();
+              ASSERT_EQ("err", process.errorOutput());
+          });
+    }
+    ASSERT_EQ(4u, reactor.running());
+    reactor.run();
+    const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+    ASSERT_EQ(0u, reactor.running());
+    for (size_t i = 0; i < outputs.size(); ++i) {
+        ASSERT_EQ("out" + std::to_string(i), outputs[i]);
+        ASSERT_EQ(static_cast<int>(i), exitCodes[i]);
+    }
+#if !defined(_WIN32)
+    // all of them were sleeping at the same time
+    ASSERT_LT(elapsed.count(), 3.0);
+#endif
+}
+
+TEST(ProcessReactor, StartFromCompletion)
+{
+    ProcessReactor reactor;
+    static constexpr size_t kOutputLen = 240000;
+    int remaining = 3;
+    std::string output;
+
+    std::function<void(Process&)> completion = [&](Process& process) {
+        output = process.output();
+        if (--remaining > 0) {
+            reactor.start(
+              std::make_unique<Process>(
+                StringList{ kCustomMainPath,
+                            "--generate-stdout",
+                            std::to_string(kOutputLen) },
+                kCaptureAll),
+              completion);
+        }
+    };
+    reactor.start(
+      std::make_unique<Process>(StringList{ kCustomMainPath }, kCaptureAll),
+      completion);
+    reactor.run();
+
+    ASSERT_EQ(0, remaining);
+    ASSERT_EQ(generateStringWithLength(kOutputLen), output);
+}
+
+TEST(ProcessReactor, Dispatch)
+{
+    ProcessReactor reactor;
+    bool completed = false;
+    reactor.start(std::make_unique<Process>(
+                    StringList{ kCustomMainPath, "--sleep", "1" }, kCaptureAll),
+                  [&](Process&) { completed = true; });
+#if !defined(_WIN32)
+    reactor.dispatch(0);
+    ASSERT_FALSE(completed);
+#endif
+    reactor.dispatch();
+    ASSERT_TRUE(completed);
+}
@@ -22,6 +22,7 @@
 #include <gtest/gtest.h>
 
 #include "Subprocess.h"
+#include "Environment.h"
 #include "OutputGenerator.h"
 #include "custom_main.h"
 
@@ -178,3 +179,123 @@ TEST(Process, CaptureReallyLong)
     ASSERT_EQ(expectedOutput.size(), process.output().size());
     ASSERT_EQ(expectedOutput, process.output());
 }
+
+TEST(Process, RunMissing)
+{
+    Process process({ "linter-cache-does-not-exist" },
+                    Process::CAPTURE_STDERR);
+    ASSERT_THROW(process.run(), ProcessError);
+}
+
+TEST(Process, CaptureBothForked)
+{
+    static constexpr char kOutput[] = "Some info message :)";
+    static constexpr char kErrput[] = "Oh my !!";
+
+    Environment env;
+    env.set(Process::kEnvSpawn, "fork");
+    env.apply();
+    Process process(
+      { kCustomMainPath, "--stdout", kOutput, "--stderr", kErrput },
+      Process::CAPTURE_STDERR | Process::CAPTURE_STDOUT);
+    ASSERT_NO_THROW(process.run());
+    ASSERT_STREQ(kOutput, process.output().c_str());
+    ASSERT_STREQ(kErrput, process.errorOutput().c_str());
+
+    Process failing({ kCustomMainPath, "--exit", "3" });
+    try {
+        failing.run();
+        FAIL() << "expected a failure";
+    } catch (const ProcessError& error) {
+        ASSERT_EQ(3, error.exitCode());
+    }
+}
+
+TEST(Process, Environment)
+{
+    Environment env;
+    env.set("LINTER_CACHE_TEST_VAR", "value");
+    Process process({ "cmake", "-E", "environment" },
+                    Process::CAPTURE_STDOUT,
+                    env);
+    ASSERT_NO_THROW(process.run());
+    ASSERT_NE(std::string::npos,
+              process.output().find("LINTER_CACHE_TEST_VAR=value"));
+    ASSERT_TRUE(Environment::get("LINTER_CACHE_TEST_VAR").empty());
+}
+
+TEST(Process, Usage)
+{
+    static constexpr size_t kOutputLen = 4 * 1024 * 1024;
+
+    Environment env;
+    env.set(Process::kEnvPerfCounters, "1");
+    Process process({ kCustomMainPath,
+                      "--generate-stdout",
+                      std::to_string(kOutputLen),
+                      "--sleep",
+                      "1" },
+                    Process::CAPTURE_STDOUT,
+                    env);
+    ASSERT_NO_THROW(process.run());
+    auto const& usage = process.usage();
+    ASSERT_GE(usage.wallSeconds, 1.0);
+    ASSERT_LT(usage.wallSeconds, 30.0);
+    ASSERT_GE(usage.userSeconds, 0.0);
+    ASSERT_GE(usage.systemSeconds, 0.0);
+#if !defined(_WIN32)
+    ASSERT_GT(usage.maxResidentKb, 0);
+#endif
+    // counters are optional and depend on the permissions
+    ASSERT_GE(usage.cycles, -1);
+    ASSERT_GE(usage.instructions, -1);
+}
+
+#if !defined(_WIN32)
+
+TEST(Process, Timeout)
+{
+    Process::Limits limits;
+    limits.timeoutSeconds = 0.5;
+    Process process({ kCustomMainPath, "--sleep", "10" });
+    process.setLimits(limits);
+    try {
+        process.run();
+        FAIL() << "expected a timeout";
+    } catch (const ProcessError& error) {
+        ASSERT_EQ(Process::kExitTimeout, error.exitCode());
+    }
+    ASSERT_TRUE(process.timedOut());
+    ASSERT_LT(process.usage().wallSeconds, 5.0);
+}
+
+TEST(Process, TimeoutKill)
+{
+    Process::Limits limits;
+    limits.timeoutSeconds = 0.5;
+    limits.killGraceSeconds = 0.5;
+    Process process({ kCustomMainPath, "--ignore-term", "--sleep", "10" });
+    process.setLimits(limits);
+    ASSERT_THROW(process.run(), ProcessError);
+    ASSERT_TRUE(process.timedOut());
+    ASSERT_EQ(Process::kExitTimeout, process.exitCode());
+    ASSERT_LT(process.usage().wallSeconds, 5.0);
+}
+
+TEST(Process, MemoryLimit)
+{
+    Process::Limits limits;
+    limits.memoryBytes = 64 * 1024 * 1024;
+    Process process({ kCustomMainPath, "--allocate", "256" },
+                    Process::CAPTURE_STDOUT | Process::CAPTURE_STDERR);
+    process.setLimits(limits);
+    ASSERT_THROW(process.run(), ProcessError);
+    ASSERT_FALSE(process.timedOut());
+    ASSERT_NE(0, process.exitCode());
+
+    Process unlimited({ kCustomMainPath, "--allocate", "256" },
+                      Process::CAPTURE_STDOUT);
+    ASSERT_NO_THROW(unlimited.run());
+}
+
+#endif
@@ -0,0 +1,78 @@
+/*
+ * test_Trace.cpp
+ *
+ * Copyright (c) 2022 - 2023 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+#include "NamedFile.h"
+#include "TemporaryFile.h"
+#include "Trace.h"
+#include "Util.h"
+
+TEST(Trace, Disabled)
+{
+    Trace trace("");
+    ASSERT_FALSE(trace.enabled());
+    trace.complete("ignored", Trace::now(), 1, {});
+}
+
+TEST(Trace, Merge)
+{
+    TemporaryFile base;
+    const auto dir = base.filename() + ".d";
+    {
+        Trace trace(dir);
+        ASSERT_TRUE(trace.enabled());
+        trace.setProcessName("linter-cache");
+        trace.setCorrelation("42-1");
+        trace.complete("first", 1000, 10, "a \"quoted\"\\path");
+        trace.complete("second", 1020, 5, {});
+    }
+    // a truncated event of a crashed process must not break the document
+    {
+        NamedFile other(dir + "/1.trace.json");
+        other.writeText(R"({"name":"other","ph":"X","ts":1,"dur":1},)"
+                        "\n"
+                        R"({"name":"trunc)");
+    }
+
+    std::ostringstream merged;
+    ASSERT_EQ(2, Trace::merge(dir, merged));
+    const auto json = merged.str();
+    EXPECT_EQ(0, json.find("{\"traceEvents\":[")) << json;
+    EXPECT_NE(std::string::npos, json.find(R"("name":"process_name")"));
+    EXPECT_NE(std::string::npos,
+              json.find(R"("correlation":"42-1","detail":"a \"quoted\"\\path")"))
+      << json;
+    EXPECT_NE(std::string::npos, json.find(R"("name":"second")"));
+    EXPECT_NE(std::string::npos, json.find(R"("name":"other")"));
+    EXPECT_EQ(std::string::npos, json.find("trunc"));
+    EXPECT_EQ(std::string::npos, json.find(",\n]"));
+}
+
+TEST(Trace, Correlation)
+{
+    const auto first = Trace::newCorrelation();
+    const auto second = Trace::newCorrelation();
+    ASSERT_NE(first, second);
+    ASSERT_EQ(0, first.find(std::to_string(Util::process_id()) + "-"));
+}
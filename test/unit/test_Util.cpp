@@ -65,3 +65,22 @@ TEST(Util, FindApplicableConfig)
     ASSERT_TRUE(
       Util::find_applicable_config(".no-such-tool", kTestUtilCpp).c_str());
 }
+
+TEST(Util, NormalizePath)
+{
+    ASSERT_EQ("/foo/bar.cpp", Util::normalize_path("/foo/./baz/../bar.cpp"));
+    ASSERT_EQ("/foo/bar.cpp", Util::normalize_path("//foo//bar.cpp"));
+    ASSERT_EQ(kMainCpp, Util::normalize_path(kRelativeMainCpp));
+}
+
+TEST(Util, FileInfo)
+{
+    Util::FileInfo info;
+    ASSERT_FALSE(Util::file_info("/never/exists", info));
+
+    TemporaryFile temporary;
+    temporary.writeText("foo");
+    ASSERT_TRUE(Util::file_info(temporary.filename(), info));
+    ASSERT_EQ(3, info.size);
+    ASSERT_NE(0, info.mtime);
+}